@@ -0,0 +1,306 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 the nof-rep authors.
+ */
+
+/*
+ * Reader for the live latency counters the nvmf target publishes in
+ * /dev/shm/spdk_tgt_latency.<pid> when built with TARGET_LATENCY_LOG.
+ * It only maps the segment read-only, so it never touches the reactors.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/latency_shm.h"
+#include "spdk/util.h"
+
+static char g_shm_name[64];
+static uint64_t g_interval_ms = 1000;
+static uint64_t g_count = 0;
+static bool g_per_slot = false;
+static volatile bool g_exit = false;
+
+struct stage_snapshot {
+	uint64_t	io_num;
+	uint64_t	total_ns;
+	uint64_t	buckets[SPDK_LATENCY_SHM_NUM_BUCKETS];
+};
+
+struct shm_snapshot {
+	struct stage_snapshot	total[SPDK_LATENCY_SHM_NUM_STAGES];
+	struct stage_snapshot	slot[SPDK_LATENCY_SHM_MAX_SLOTS][SPDK_LATENCY_SHM_NUM_STAGES];
+	char			name[SPDK_LATENCY_SHM_MAX_SLOTS][SPDK_LATENCY_SHM_SLOT_NAME_LEN];
+	uint32_t		num_slots;
+};
+
+static void
+usage(char *program_name)
+{
+	printf("%s options\n", program_name);
+	printf("\t[-s shm name (e.g. /spdk_tgt_latency.1234)]\n");
+	printf("\t[-p pid of the target, used when -s is not given]\n");
+	printf("\t[-i sample interval in ms (default: 1000)]\n");
+	printf("\t[-n number of samples (default: 0 (until interrupted))]\n");
+	printf("\t[-t print every thread slot in addition to the totals]\n");
+	printf("\t[-h show this usage]\n");
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	int op;
+	long value;
+
+	while ((op = getopt(argc, argv, "s:p:i:n:th")) != -1) {
+		switch (op) {
+		case 's':
+			snprintf(g_shm_name, sizeof(g_shm_name), "%s", optarg);
+			break;
+		case 'p':
+			value = strtol(optarg, NULL, 10);
+			if (value <= 0) {
+				fprintf(stderr, "invalid pid %s\n", optarg);
+				return -EINVAL;
+			}
+			snprintf(g_shm_name, sizeof(g_shm_name), "%s.%ld", SPDK_LATENCY_SHM_NAME_PREFIX, value);
+			break;
+		case 'i':
+			value = strtol(optarg, NULL, 10);
+			if (value <= 0) {
+				fprintf(stderr, "invalid interval %s\n", optarg);
+				return -EINVAL;
+			}
+			g_interval_ms = value;
+			break;
+		case 'n':
+			value = strtol(optarg, NULL, 10);
+			if (value < 0) {
+				fprintf(stderr, "invalid count %s\n", optarg);
+				return -EINVAL;
+			}
+			g_count = value;
+			break;
+		case 't':
+			g_per_slot = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+		default:
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	if (g_shm_name[0] == '\0') {
+		fprintf(stderr, "either -s or -p must be specified\n");
+		usage(argv[0]);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * A slot that cannot be read consistently (its writer keeps updating it) keeps the
+ *  values of the previous snapshot, so that the next delta does not underflow.
+ */
+static void
+take_snapshot(const struct spdk_latency_shm_file *file, struct shm_snapshot *snap,
+	      const struct shm_snapshot *prev)
+{
+	struct spdk_latency_shm_slot slot;
+	uint32_t i, s, b, num_slots;
+
+	memset(snap, 0, sizeof(*snap));
+
+	num_slots = spdk_min(__atomic_load_n(&file->num_slots, __ATOMIC_ACQUIRE), file->max_slots);
+	for (i = 0; i < num_slots; i++) {
+		if (spdk_latency_shm_read_slot(file, i, &slot) != 0) {
+			memcpy(snap->name[i], prev->name[i], sizeof(snap->name[i]));
+			memcpy(snap->slot[i], prev->slot[i], sizeof(snap->slot[i]));
+			for (s = 0; s < SPDK_LATENCY_SHM_NUM_STAGES; s++) {
+				snap->total[s].io_num += prev->slot[i][s].io_num;
+				snap->total[s].total_ns += prev->slot[i][s].total_ns;
+				for (b = 0; b < SPDK_LATENCY_SHM_NUM_BUCKETS; b++) {
+					snap->total[s].buckets[b] += prev->slot[i][s].buckets[b];
+				}
+			}
+			continue;
+		}
+
+		memcpy(snap->name[i], slot.name, sizeof(snap->name[i]));
+		for (s = 0; s < SPDK_LATENCY_SHM_NUM_STAGES; s++) {
+			snap->slot[i][s].io_num = slot.stage[s].io_num;
+			snap->slot[i][s].total_ns = slot.stage[s].total_ns;
+			snap->total[s].io_num += slot.stage[s].io_num;
+			snap->total[s].total_ns += slot.stage[s].total_ns;
+			for (b = 0; b < SPDK_LATENCY_SHM_NUM_BUCKETS; b++) {
+				snap->slot[i][s].buckets[b] = slot.stage[s].buckets[b];
+				snap->total[s].buckets[b] += slot.stage[s].buckets[b];
+			}
+		}
+	}
+	snap->num_slots = num_slots;
+}
+
+/* Upper bound of the bucket holding the given percentile, in us. */
+static double
+delta_percentile(const struct stage_snapshot *cur, const struct stage_snapshot *prev,
+		 uint64_t io_num, double percentile)
+{
+	uint64_t threshold, so_far = 0;
+	uint32_t b;
+
+	threshold = (uint64_t)(io_num * percentile / 100.0);
+	for (b = 0; b < SPDK_LATENCY_SHM_NUM_BUCKETS; b++) {
+		so_far += cur->buckets[b] - prev->buckets[b];
+		if (so_far > threshold) {
+			break;
+		}
+	}
+	if (b == SPDK_LATENCY_SHM_NUM_BUCKETS) {
+		b--;
+	}
+
+	return (double)(2ULL << b) / 1000.0;
+}
+
+static void
+print_stage(const char *name, enum spdk_latency_shm_stage stage,
+	    const struct stage_snapshot *cur, const struct stage_snapshot *prev, double seconds)
+{
+	uint64_t io_num, total_ns;
+
+	io_num = cur->io_num - prev->io_num;
+	total_ns = cur->total_ns - prev->total_ns;
+	if (io_num == 0) {
+		return;
+	}
+
+	printf("%-24s %-8s %12.2f %10.2f %10.2f %10.2f %10.2f\n", name,
+	       spdk_latency_shm_stage_name(stage), io_num / seconds,
+	       (double)total_ns / io_num / 1000.0,
+	       delta_percentile(cur, prev, io_num, 50.0),
+	       delta_percentile(cur, prev, io_num, 99.0),
+	       delta_percentile(cur, prev, io_num, 99.9));
+}
+
+static void
+print_delta(const struct shm_snapshot *cur, const struct shm_snapshot *prev, double seconds)
+{
+	uint32_t i, s;
+
+	printf("%-24s %-8s %12s %10s %10s %10s %10s\n", "thread", "stage", "IOPS",
+	       "avg(us)", "p50(us)", "p99(us)", "p99.9(us)");
+	for (s = 0; s < SPDK_LATENCY_SHM_NUM_STAGES; s++) {
+		print_stage("total", s, &cur->total[s], &prev->total[s], seconds);
+	}
+
+	if (!g_per_slot) {
+		printf("\n");
+		return;
+	}
+
+	for (i = 0; i < cur->num_slots; i++) {
+		for (s = 0; s < SPDK_LATENCY_SHM_NUM_STAGES; s++) {
+			/* A slot claimed during this interval has an all-zero previous copy. */
+			print_stage(cur->name[i], s, &cur->slot[i][s], &prev->slot[i][s], seconds);
+		}
+	}
+	printf("\n");
+}
+
+static void
+sig_handler(int signo)
+{
+	g_exit = true;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_latency_shm_file *file;
+	struct shm_snapshot *cur, *prev, *tmp;
+	struct timespec ts_prev, ts_cur;
+	struct stat st;
+	uint64_t samples = 0;
+	double seconds;
+	int fd, rc;
+
+	rc = parse_args(argc, argv);
+	if (rc != 0) {
+		return 1;
+	}
+
+	fd = shm_open(g_shm_name, O_RDONLY, 0600);
+	if (fd < 0) {
+		fprintf(stderr, "could not open shm %s: %s\n", g_shm_name, strerror(errno));
+		return 1;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*file)) {
+		fprintf(stderr, "shm %s is too small\n", g_shm_name);
+		close(fd);
+		return 1;
+	}
+
+	file = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (file == MAP_FAILED) {
+		fprintf(stderr, "could not mmap shm %s\n", g_shm_name);
+		close(fd);
+		return 1;
+	}
+
+	if (__atomic_load_n(&file->magic, __ATOMIC_ACQUIRE) != SPDK_LATENCY_SHM_MAGIC ||
+	    file->version != SPDK_LATENCY_SHM_VERSION ||
+	    file->num_stages != SPDK_LATENCY_SHM_NUM_STAGES ||
+	    file->file_size > (uint64_t)st.st_size) {
+		fprintf(stderr, "shm %s is not a compatible latency segment\n", g_shm_name);
+		rc = 1;
+		goto out;
+	}
+
+	cur = calloc(1, sizeof(*cur));
+	prev = calloc(1, sizeof(*prev));
+	if (cur == NULL || prev == NULL) {
+		free(cur);
+		free(prev);
+		rc = 1;
+		goto out;
+	}
+
+	signal(SIGINT, sig_handler);
+	signal(SIGTERM, sig_handler);
+
+	printf("Reading latency counters of pid %d from /dev/shm%s every %" PRIu64 " ms\n",
+	       (int)file->pid, g_shm_name, g_interval_ms);
+
+	/* cur is still all zeroes and stands in for the missing previous snapshot */
+	take_snapshot(file, prev, cur);
+	clock_gettime(CLOCK_MONOTONIC, &ts_prev);
+
+	while (!g_exit && (g_count == 0 || samples < g_count)) {
+		usleep(g_interval_ms * 1000);
+
+		take_snapshot(file, cur, prev);
+		clock_gettime(CLOCK_MONOTONIC, &ts_cur);
+		seconds = (ts_cur.tv_sec - ts_prev.tv_sec) +
+			  (ts_cur.tv_nsec - ts_prev.tv_nsec) / (double)SPDK_SEC_TO_NSEC;
+
+		print_delta(cur, prev, seconds);
+		fflush(stdout);
+
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+		ts_prev = ts_cur;
+		samples++;
+	}
+
+	free(cur);
+	free(prev);
+	rc = 0;
+out:
+	munmap(file, st.st_size);
+	close(fd);
+	return rc;
+}
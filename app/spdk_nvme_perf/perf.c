@@ -72,6 +72,8 @@ struct ns_entry {
 		struct {
 			struct spdk_nvme_ctrlr	*ctrlr;
 			struct spdk_nvme_ns	*ns;
+			/* 固定大小 IO 的预构建命令，未启用 --io-template 时为 NULL */
+			struct spdk_nvme_ns_io_template	*io_tmpl;
 		} nvme;
 #ifdef SPDK_CONFIG_URING
 		struct {
@@ -183,6 +185,8 @@ struct perf_task {
 	struct iovec		md_iov;
 	uint64_t		submit_tsc;
 	bool			is_read;
+	/* 数据缓冲区位于控制器的 CMB 中 */
+	bool			dev_mem_buf;
 	struct spdk_dif_ctx	dif_ctx;
 #if HAVE_LIBAIO
 	struct iocb		iocb;
@@ -324,6 +328,10 @@ static unsigned int g_io_completed_num = 0;
 	}
 
 static bool g_dump_transport_stats;
+static bool g_batch_completions;
+static bool g_adaptive_polling;
+static bool g_io_template;
+static bool g_cmb_buffers;
 static pthread_mutex_t g_stats_mutex;
 
 #define MAX_ALLOWED_PCI_DEVICE_NUM 128
@@ -853,6 +861,18 @@ register_files(int argc, char **argv)
 #endif
 
 static void io_complete(void *ctx, const struct spdk_nvme_cpl *cpl);
+static void io_complete_batch(void *ctx, struct spdk_nvme_cpl_batch_entry *entries,
+			      uint32_t num_entries);
+
+static void
+task_free_buf(struct perf_task *task, void *buf)
+{
+	if (task->dev_mem_buf) {
+		spdk_nvme_ctrlr_free_dev_mem(task->ns_ctx->entry->u.nvme.ctrlr, buf);
+	} else {
+		spdk_dma_free(buf);
+	}
+}
 
 static void
 nvme_setup_payload(struct perf_task *task, uint8_t pattern)
@@ -865,17 +885,26 @@ nvme_setup_payload(struct perf_task *task, uint8_t pattern)
 	 * it's same with g_io_size_bytes for namespace without metadata.
 	 */
 	max_io_size_bytes = g_io_size_bytes + g_max_io_md_size * g_max_io_size_blocks;
-	buf = spdk_dma_zmalloc(max_io_size_bytes, g_io_align, NULL);
+	buf = NULL;
+	if (g_cmb_buffers) {
+		/* CMB 中的写数据不需要控制器再从主机内存 DMA，空间不足时退回主机内存 */
+		buf = spdk_nvme_ctrlr_alloc_dev_mem(task->ns_ctx->entry->u.nvme.ctrlr,
+						    SPDK_NVME_DEV_MEM_CMB, max_io_size_bytes);
+		task->dev_mem_buf = buf != NULL;
+	}
 	if (buf == NULL) {
-		fprintf(stderr, "task->buf spdk_dma_zmalloc failed\n");
-		exit(1);
+		buf = spdk_dma_zmalloc(max_io_size_bytes, g_io_align, NULL);
+		if (buf == NULL) {
+			fprintf(stderr, "task->buf spdk_dma_zmalloc failed\n");
+			exit(1);
+		}
 	}
 	memset(buf, pattern, max_io_size_bytes);
 
 	rc = nvme_perf_allocate_iovs(task, buf, max_io_size_bytes);
 	if (rc < 0) {
 		fprintf(stderr, "perf task failed to allocate iovs\n");
-		spdk_dma_free(buf);
+		task_free_buf(task, buf);
 		exit(1);
 	}
 
@@ -885,7 +914,7 @@ nvme_setup_payload(struct perf_task *task, uint8_t pattern)
 		task->md_iov.iov_len = max_io_md_size;
 		if (task->md_iov.iov_base == NULL) {
 			fprintf(stderr, "task->md_buf spdk_dma_zmalloc failed\n");
-			spdk_dma_free(task->iovs[0].iov_base);
+			task_free_buf(task, task->iovs[0].iov_base);
 			free(task->iovs);
 			exit(1);
 		}
@@ -941,12 +970,12 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
     // 如果被排队，task 本轮最后一次提交也会再次更新 submit_time
     clock_gettime(CLOCK_REALTIME, &task->submit_time);
 
-	pthread_mutex_lock(&log_mutex);
+	struct latency_ns_log *ns_log = latency_ns_log_begin();
 	struct timespec sub_time;
 	timespec_sub(&sub_time, &task->submit_time, &task->create_time);
-	timespec_add(&(latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.latency_time), &(latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.latency_time), &sub_time);
-	latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.io_num++;
-	pthread_mutex_unlock(&log_mutex);
+	timespec_add(&(ns_log[task->ns_id].task_queue_latency.latency_time), &(ns_log[task->ns_id].task_queue_latency.latency_time), &sub_time);
+	ns_log[task->ns_id].task_queue_latency.io_num++;
+	latency_ns_log_end();
 
 #endif
 
@@ -960,6 +989,11 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
 							     task, task->ns_id, entry->io_flags,
 							     task->dif_ctx.apptag_mask, task->dif_ctx.app_tag);
 			#else
+			if (entry->u.nvme.io_tmpl != NULL) {
+				return spdk_nvme_ns_cmd_read_template(entry->u.nvme.io_tmpl, ns_ctx->u.nvme.qpair[qp_num],
+								      task->iovs[0].iov_base, NULL, lba,
+								      io_complete, task);
+			}
 			return spdk_nvme_ns_cmd_read_with_md(entry->u.nvme.ns, ns_ctx->u.nvme.qpair[qp_num],
 							     task->iovs[0].iov_base, task->md_iov.iov_base,
 							     lba,
@@ -1014,6 +1048,11 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
 							     task, task->ns_id, entry->io_flags,
 							     task->dif_ctx.apptag_mask, task->dif_ctx.app_tag);
 			#else
+			if (entry->u.nvme.io_tmpl != NULL) {
+				return spdk_nvme_ns_cmd_write_template(entry->u.nvme.io_tmpl, ns_ctx->u.nvme.qpair[qp_num],
+								      task->iovs[0].iov_base, NULL, lba,
+								      io_complete, task);
+			}
 			return spdk_nvme_ns_cmd_write_with_md(entry->u.nvme.ns, ns_ctx->u.nvme.qpair[qp_num],
 							      task->iovs[0].iov_base, task->md_iov.iov_base,
 							      lba,
@@ -1120,6 +1159,7 @@ nvme_init_ns_worker_ctx(struct ns_worker_ctx *ns_ctx)
 	}
 	opts.delay_cmd_submit = true;
 	opts.create_only = true;
+	opts.adaptive_polling = g_adaptive_polling;
 
 	ctrlr_opts = spdk_nvme_ctrlr_get_opts(entry->u.nvme.ctrlr);
 	opts.async_mode = !(spdk_nvme_ctrlr_get_transport_id(entry->u.nvme.ctrlr)->trtype ==
@@ -1147,6 +1187,13 @@ nvme_init_ns_worker_ctx(struct ns_worker_ctx *ns_ctx)
 			goto qpair_failed;
 		}
 
+		if (g_batch_completions &&
+		    spdk_nvme_qpair_set_batch_cb(qpair, io_complete, io_complete_batch, ns_ctx)) {
+			printf("ERROR: unable to enable batched completions on I/O qpair.\n");
+			spdk_nvme_ctrlr_free_io_qpair(qpair);
+			goto qpair_failed;
+		}
+
 		if (spdk_nvme_ctrlr_connect_io_qpair(entry->u.nvme.ctrlr, qpair)) {
 			printf("ERROR: unable to connect I/O qpair.\n");
 			spdk_nvme_ctrlr_free_io_qpair(qpair);
@@ -1236,10 +1283,31 @@ nvme_dump_pcie_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 	printf("\tqueued_requests:     %"PRIu64"\n", pcie_stat->queued_requests);
 }
 
+/* 按阶段打印每个 I/O 平均消耗的 TSC cycles */
+static void
+nvme_dump_tcp_cycles(const struct spdk_nvme_tcp_cycles *cycles, uint64_t ios)
+{
+	uint64_t total;
+
+	if (ios == 0) {
+		return;
+	}
+
+	total = cycles->pdu_build + cycles->digest + cycles->sock_write +
+		cycles->sock_read + cycles->pdu_parse + cycles->completion;
+	printf("\tcycles_per_io:      build %"PRIu64", digest %"PRIu64", sock_write %"PRIu64
+	       ", sock_read %"PRIu64", parse %"PRIu64", completion %"PRIu64", total %"PRIu64"\n",
+	       cycles->pdu_build / ios, cycles->digest / ios, cycles->sock_write / ios,
+	       cycles->sock_read / ios, cycles->pdu_parse / ios, cycles->completion / ios,
+	       total / ios);
+}
+
 static void
 nvme_dump_tcp_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 {
 	struct spdk_nvme_tcp_stat *tcp_stat;
+	struct spdk_nvme_tcp_qpair_stat *qpair_stat;
+	uint32_t i;
 
 	tcp_stat = &stat->tcp;
 
@@ -1250,6 +1318,24 @@ nvme_dump_tcp_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 	printf("\tnvme_completions:   %"PRIu64"\n", tcp_stat->nvme_completions);
 	printf("\tsubmitted_requests: %"PRIu64"\n", tcp_stat->submitted_requests);
 	printf("\tqueued_requests:    %"PRIu64"\n", tcp_stat->queued_requests);
+	printf("\tsubmitted_ios:      %"PRIu64"\n", tcp_stat->submitted_ios);
+	printf("\tsubmit_batches:     %"PRIu64"\n", tcp_stat->submit_batches);
+	printf("\tsock_flushes:       %"PRIu64"\n", tcp_stat->sock_flushes);
+	printf("\tin_capsule_writes:  %"PRIu64"\n", tcp_stat->in_capsule_writes);
+	printf("\tr2t_writes:         %"PRIu64"\n", tcp_stat->r2t_writes);
+	if (tcp_stat->submitted_ios) {
+		printf("\tpdus_per_io:        %.2f\n",
+		       (double)tcp_stat->submitted_requests / tcp_stat->submitted_ios);
+		printf("\tflushes_per_io:     %.2f\n",
+		       (double)tcp_stat->sock_flushes / tcp_stat->submitted_ios);
+	}
+	nvme_dump_tcp_cycles(&tcp_stat->cycles, tcp_stat->nvme_completions);
+	for (i = 0; i < tcp_stat->num_qpairs; i++) {
+		qpair_stat = &tcp_stat->qpair_stats[i];
+		printf("\tqpair %u:            submitted_ios %"PRIu64", completed_ios %"PRIu64"\n",
+		       qpair_stat->qid, qpair_stat->submitted_ios, qpair_stat->completed_ios);
+		nvme_dump_tcp_cycles(&qpair_stat->cycles, qpair_stat->completed_ios);
+	}
 }
 
 static void
@@ -1455,6 +1541,12 @@ register_ns(struct spdk_nvme_ctrlr *ctrlr, struct spdk_nvme_ns *ns)
 		g_max_io_size_blocks = entry->io_size_blocks;
 	}
 
+	/* 模板只覆盖不带元数据的 IO，DIF/DIX 仍走通用路径 */
+	if (g_io_template && entry->md_size == 0) {
+		entry->u.nvme.io_tmpl = spdk_nvme_ns_io_template_create(ns, entry->io_size_blocks,
+					entry->io_flags);
+	}
+
 	build_nvme_ns_name(entry->name, sizeof(entry->name), ctrlr, spdk_nvme_ns_get_id(ns));
 
 	g_num_namespaces++;
@@ -1469,6 +1561,9 @@ unregister_namespaces(void)
 	TAILQ_FOREACH_SAFE(entry, &g_namespaces, link, tmp) {
 		TAILQ_REMOVE(&g_namespaces, entry, link);
 		spdk_zipf_free(&entry->zipf);
+		if (entry->type == ENTRY_TYPE_NVME_NS) {
+			spdk_nvme_ns_io_template_free(entry->u.nvme.io_tmpl);
+		}
 		if (g_use_uring) {
 #ifdef SPDK_CONFIG_URING
 			close(entry->u.uring.fd);
@@ -1610,7 +1705,7 @@ submit_single_io(struct perf_task *task)
 			TAILQ_INSERT_TAIL(&ns_ctx->queued_tasks, task, link);
 		} else {
 			RATELIMIT_LOG("starting I/O failed: %d\n", rc);
-			spdk_dma_free(task->iovs[0].iov_base);
+			task_free_buf(task, task->iovs[0].iov_base);
 			free(task->iovs);
 			spdk_dma_free(task->md_iov.iov_base);
 			task->ns_ctx->status = 1;
@@ -1660,12 +1755,12 @@ task_complete(struct perf_task *task)
 
     ++g_io_completed_num;
 
-	pthread_mutex_lock(&log_mutex);
+	struct latency_ns_log *ns_log = latency_ns_log_begin();
 	struct timespec sub_time;
 	timespec_sub(&sub_time, &task->complete_time, &task->submit_time);
-	timespec_add(&(latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.latency_time), &(latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.latency_time), &sub_time);
-	latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.io_num++;
-	pthread_mutex_unlock(&log_mutex);
+	timespec_add(&(ns_log[task->ns_id].task_complete_latency.latency_time), &(ns_log[task->ns_id].task_complete_latency.latency_time), &sub_time);
+	ns_log[task->ns_id].task_complete_latency.io_num++;
+	latency_ns_log_end();
 
 #endif
 
@@ -1676,7 +1771,7 @@ task_complete(struct perf_task *task)
 	 * replace the one just completed.
 	 */
 	if (spdk_unlikely(ns_ctx->is_draining)) {
-		spdk_dma_free(task->iovs[0].iov_base);
+		task_free_buf(task, task->iovs[0].iov_base);
 		free(task->iovs);
 		spdk_dma_free(task->md_iov.iov_base);
 		free(task);
@@ -1718,6 +1813,56 @@ io_complete(void *ctx, const struct spdk_nvme_cpl *cpl)
 	task_complete(task);
 }
 
+/* 在 ns_ctx 的所有 qpair 上打开/关闭提交批次，批次内的 IO 只敲一次 doorbell */
+static void
+ns_ctx_submit_batch_begin(struct ns_worker_ctx *ns_ctx)
+{
+	int i;
+
+	if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS) {
+		return;
+	}
+
+	for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+		spdk_nvme_qpair_submit_batch_begin(ns_ctx->u.nvme.qpair[i]);
+	}
+}
+
+static void
+ns_ctx_submit_batch_end(struct ns_worker_ctx *ns_ctx)
+{
+	int i;
+
+	if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS) {
+		return;
+	}
+
+	for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+		spdk_nvme_qpair_submit_batch_end(ns_ctx->u.nvme.qpair[i]);
+	}
+}
+
+/*
+ * 批量完成回调：一次 poll 内完成的 IO 一起处理。先预取所有 task，
+ * 再逐个完成，期间重新提交的 IO 放在同一个提交批次里一起下发
+ */
+static void
+io_complete_batch(void *ctx, struct spdk_nvme_cpl_batch_entry *entries, uint32_t num_entries)
+{
+	struct ns_worker_ctx *ns_ctx = ctx;
+	uint32_t i;
+
+	for (i = 0; i < num_entries; i++) {
+		__builtin_prefetch(entries[i].cb_arg);
+	}
+
+	ns_ctx_submit_batch_begin(ns_ctx);
+	for (i = 0; i < num_entries; i++) {
+		io_complete(entries[i].cb_arg, &entries[i].cpl);
+	}
+	ns_ctx_submit_batch_end(ns_ctx);
+}
+
 static struct perf_task *
 allocate_task(struct ns_worker_ctx *ns_ctx, int queue_depth, uint32_t io_id)
 {
@@ -1729,10 +1874,10 @@ allocate_task(struct ns_worker_ctx *ns_ctx, int queue_depth, uint32_t io_id)
 		exit(1);
 	}
 
-	ns_ctx->entry->fn_table->setup_payload(task, queue_depth % 8 + 1);
-
 	task->ns_ctx = ns_ctx;
 
+	ns_ctx->entry->fn_table->setup_payload(task, queue_depth % 8 + 1);
+
 	return task;
 }
 
@@ -1742,6 +1887,7 @@ submit_io(struct ns_worker_ctx *ns_ctx, int queue_depth, uint32_t ns_id)
 	struct perf_task *task;
     uint32_t io_id = 1;
 
+	ns_ctx_submit_batch_begin(ns_ctx);
 	while (queue_depth-- > 0) {
 		task = allocate_task(ns_ctx, queue_depth, io_id++);
 #ifdef PERF_LATENCY_LOG
@@ -1749,6 +1895,7 @@ submit_io(struct ns_worker_ctx *ns_ctx, int queue_depth, uint32_t ns_id)
 #endif
 		submit_single_io(task);
 	}
+	ns_ctx_submit_batch_end(ns_ctx);
 }
 
 static int
@@ -1896,6 +2043,7 @@ work_fn(void *arg)
 				/* Submit any I/O that is queued up */
 				TAILQ_INIT(&swap);
 				TAILQ_SWAP(&swap, &ns_ctx->queued_tasks, perf_task, link);
+				ns_ctx_submit_batch_begin(ns_ctx);
 				while (!TAILQ_EMPTY(&swap)) {
 					task = TAILQ_FIRST(&swap);
 					TAILQ_REMOVE(&swap, task, link);
@@ -1906,6 +2054,7 @@ work_fn(void *arg)
 					}
 					submit_single_io(task);
 				}
+				ns_ctx_submit_batch_end(ns_ctx);
 			}
 
 			check_now = spdk_get_ticks();
@@ -2152,6 +2301,10 @@ usage(char *program_name)
 	printf("\t-G, --enable-debug enable debug logging (flag disabled, must reconfigure with --enable-debug)\n");
 #endif
 	printf("\t--transport-stats dump transport statistics\n");
+	printf("\t--batch-completions deliver NVMe completions in one batch per poll\n");
+	printf("\t--adaptive-polling skip completion polls on qpairs that are not expected to complete anything\n");
+	printf("\t--io-template submit NVMe IO from a prebuilt command, for namespaces without metadata\n");
+	printf("\t--cmb-buffers allocate NVMe IO buffers from the controller memory buffer when possible\n");
 	printf("\n\n");
 }
 
@@ -2671,6 +2824,14 @@ static const struct option g_perf_cmdline_opts[] = {
 	{"use-every-core", no_argument, NULL, PERF_USE_EVERY_CORE},
 #define PERF_NO_HUGE		270
 	{"no-huge", no_argument, NULL, PERF_NO_HUGE},
+#define PERF_BATCH_COMPLETIONS	271
+	{"batch-completions", no_argument, NULL, PERF_BATCH_COMPLETIONS},
+#define PERF_ADAPTIVE_POLLING	272
+	{"adaptive-polling", no_argument, NULL, PERF_ADAPTIVE_POLLING},
+#define PERF_IO_TEMPLATE	273
+	{"io-template", no_argument, NULL, PERF_IO_TEMPLATE},
+#define PERF_CMB_BUFFERS	274
+	{"cmb-buffers", no_argument, NULL, PERF_CMB_BUFFERS},
 	/* Should be the last element */
 	{0, 0, 0, 0}
 };
@@ -2937,6 +3098,18 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 		case PERF_NO_HUGE:
 			env_opts->no_huge = true;
 			break;
+		case PERF_BATCH_COMPLETIONS:
+			g_batch_completions = true;
+			break;
+		case PERF_ADAPTIVE_POLLING:
+			g_adaptive_polling = true;
+			break;
+		case PERF_IO_TEMPLATE:
+			g_io_template = true;
+			break;
+		case PERF_CMB_BUFFERS:
+			g_cmb_buffers = true;
+			break;
 		case PERF_HELP:
 			usage(argv[0]);
 			return HELP_RETURN_CODE;
@@ -3033,11 +3206,12 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 		return 1;
 	}
 
-	if (g_rdma_srq_size != 0) {
+	if (g_rdma_srq_size != 0 || g_dump_transport_stats) {
 		struct spdk_nvme_transport_opts opts;
 
 		spdk_nvme_transport_get_opts(&opts, sizeof(opts));
 		opts.rdma_srq_size = g_rdma_srq_size;
+		opts.tcp_cycle_stats = g_dump_transport_stats;
 
 		rc = spdk_nvme_transport_set_opts(&opts, sizeof(opts));
 		if (rc != 0) {
@@ -3442,6 +3616,8 @@ child_thread_fn(void *arg)
     {
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
 
+        /* 本线程不做 IO，负责每秒汇总各线程的时延槽 */
+        latency_log_poll();
         process_msg_recv(msgid);
 
         // 3. 更新经过时间
@@ -3613,7 +3789,6 @@ main(int argc, char **argv)
     // myprint
     printf("Create a msg queue with msgid %d. \n", g_msgid);
 
-	latency_msg.latency_log_namespaces = malloc(g_num_namespaces * sizeof(struct latency_ns_log));
 	namespace_num = g_num_namespaces;
 	init_log_fn();
 	is_prob_finish = true;
@@ -3691,6 +3866,7 @@ cleanup:
 
     /* 删除消息队列 */
     // 剩余消息数为 0，可以删除消息队列
+    latency_log_collect();
     process_msg_recv(g_msgid);
     if (msgctl(g_msgid, IPC_RMID, NULL) == -1)
     {
@@ -72,6 +72,8 @@ struct ns_entry {
 		struct {
 			struct spdk_nvme_ctrlr	*ctrlr;
 			struct spdk_nvme_ns	*ns;
+			/* 固定大小 IO 的预构建命令，未启用 --io-template 时为 NULL */
+			struct spdk_nvme_ns_io_template	*io_tmpl;
 		} nvme;
 #ifdef SPDK_CONFIG_URING
 		struct {
@@ -364,6 +366,9 @@ static unsigned int g_io_completed_num = 0;
 	}
 
 static bool g_dump_transport_stats;
+static bool g_batch_completions;
+static bool g_adaptive_polling;
+static bool g_io_template;
 static pthread_mutex_t g_stats_mutex;
 
 #define MAX_ALLOWED_PCI_DEVICE_NUM 128
@@ -893,6 +898,8 @@ register_files(int argc, char **argv)
 #endif
 
 static void io_complete(void *ctx, const struct spdk_nvme_cpl *cpl);
+static void io_complete_batch(void *ctx, struct spdk_nvme_cpl_batch_entry *entries,
+			      uint32_t num_entries);
 
 static void
 nvme_setup_payload(struct perf_task *task, uint8_t pattern)
@@ -984,12 +991,12 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
     // 如果被排队，task 本轮最后一次提交也会再次更新 submit_time
     clock_gettime(CLOCK_REALTIME, &task->submit_time);
 
-	pthread_mutex_lock(&log_mutex);
+	struct latency_ns_log *ns_log = latency_ns_log_begin();
 	struct timespec sub_time;
 	timespec_sub(&sub_time, &task->submit_time, &task->create_time);
-	timespec_add(&(latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.latency_time), &(latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.latency_time), &sub_time);
-	latency_msg.latency_log_namespaces[task->ns_id].task_queue_latency.io_num++;
-	pthread_mutex_unlock(&log_mutex);
+	timespec_add(&(ns_log[task->ns_id].task_queue_latency.latency_time), &(ns_log[task->ns_id].task_queue_latency.latency_time), &sub_time);
+	ns_log[task->ns_id].task_queue_latency.io_num++;
+	latency_ns_log_end();
 
 #endif
 
@@ -1016,6 +1023,11 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
 							     task, task->ns_id, entry->io_flags,
 							     task->dif_ctx.apptag_mask, task->dif_ctx.app_tag);
 			#else
+			if (entry->u.nvme.io_tmpl != NULL) {
+				return spdk_nvme_ns_cmd_read_template(entry->u.nvme.io_tmpl, ns_ctx->u.nvme.qpair[qp_num],
+								      task->iovs[0].iov_base, NULL, lba,
+								      io_complete, task);
+			}
 			return spdk_nvme_ns_cmd_read_with_md(entry->u.nvme.ns, ns_ctx->u.nvme.qpair[qp_num],
 							     task->iovs[0].iov_base, task->md_iov.iov_base,
 							     lba,
@@ -1071,6 +1083,11 @@ nvme_submit_io(struct perf_task *task, struct ns_worker_ctx *ns_ctx,
 							     task, task->ns_id, entry->io_flags,
 							     task->dif_ctx.apptag_mask, task->dif_ctx.app_tag);
 			#else
+			if (entry->u.nvme.io_tmpl != NULL) {
+				return spdk_nvme_ns_cmd_write_template(entry->u.nvme.io_tmpl, ns_ctx->u.nvme.qpair[qp_num],
+								      task->iovs[0].iov_base, NULL, lba,
+								      io_complete, task);
+			}
 			return spdk_nvme_ns_cmd_write_with_md(entry->u.nvme.ns, ns_ctx->u.nvme.qpair[qp_num],
 							      task->iovs[0].iov_base, task->md_iov.iov_base,
 							      lba,
@@ -1177,6 +1194,7 @@ nvme_init_ns_worker_ctx(struct ns_worker_ctx *ns_ctx)
 	}
 	opts.delay_cmd_submit = true;
 	opts.create_only = true;
+	opts.adaptive_polling = g_adaptive_polling;
 
 	ctrlr_opts = spdk_nvme_ctrlr_get_opts(entry->u.nvme.ctrlr);
 	opts.async_mode = !(spdk_nvme_ctrlr_get_transport_id(entry->u.nvme.ctrlr)->trtype ==
@@ -1204,6 +1222,13 @@ nvme_init_ns_worker_ctx(struct ns_worker_ctx *ns_ctx)
 			goto qpair_failed;
 		}
 
+		if (g_batch_completions &&
+		    spdk_nvme_qpair_set_batch_cb(qpair, io_complete, io_complete_batch, ns_ctx)) {
+			printf("ERROR: unable to enable batched completions on I/O qpair.\n");
+			spdk_nvme_ctrlr_free_io_qpair(qpair);
+			goto qpair_failed;
+		}
+
 		if (spdk_nvme_ctrlr_connect_io_qpair(entry->u.nvme.ctrlr, qpair)) {
 			printf("ERROR: unable to connect I/O qpair.\n");
 			spdk_nvme_ctrlr_free_io_qpair(qpair);
@@ -1293,10 +1318,31 @@ nvme_dump_pcie_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 	printf("\tqueued_requests:     %"PRIu64"\n", pcie_stat->queued_requests);
 }
 
+/* 按阶段打印每个 I/O 平均消耗的 TSC cycles */
+static void
+nvme_dump_tcp_cycles(const struct spdk_nvme_tcp_cycles *cycles, uint64_t ios)
+{
+	uint64_t total;
+
+	if (ios == 0) {
+		return;
+	}
+
+	total = cycles->pdu_build + cycles->digest + cycles->sock_write +
+		cycles->sock_read + cycles->pdu_parse + cycles->completion;
+	printf("\tcycles_per_io:      build %"PRIu64", digest %"PRIu64", sock_write %"PRIu64
+	       ", sock_read %"PRIu64", parse %"PRIu64", completion %"PRIu64", total %"PRIu64"\n",
+	       cycles->pdu_build / ios, cycles->digest / ios, cycles->sock_write / ios,
+	       cycles->sock_read / ios, cycles->pdu_parse / ios, cycles->completion / ios,
+	       total / ios);
+}
+
 static void
 nvme_dump_tcp_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 {
 	struct spdk_nvme_tcp_stat *tcp_stat;
+	struct spdk_nvme_tcp_qpair_stat *qpair_stat;
+	uint32_t i;
 
 	tcp_stat = &stat->tcp;
 
@@ -1307,6 +1353,24 @@ nvme_dump_tcp_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 	printf("\tnvme_completions:   %"PRIu64"\n", tcp_stat->nvme_completions);
 	printf("\tsubmitted_requests: %"PRIu64"\n", tcp_stat->submitted_requests);
 	printf("\tqueued_requests:    %"PRIu64"\n", tcp_stat->queued_requests);
+	printf("\tsubmitted_ios:      %"PRIu64"\n", tcp_stat->submitted_ios);
+	printf("\tsubmit_batches:     %"PRIu64"\n", tcp_stat->submit_batches);
+	printf("\tsock_flushes:       %"PRIu64"\n", tcp_stat->sock_flushes);
+	printf("\tin_capsule_writes:  %"PRIu64"\n", tcp_stat->in_capsule_writes);
+	printf("\tr2t_writes:         %"PRIu64"\n", tcp_stat->r2t_writes);
+	if (tcp_stat->submitted_ios) {
+		printf("\tpdus_per_io:        %.2f\n",
+		       (double)tcp_stat->submitted_requests / tcp_stat->submitted_ios);
+		printf("\tflushes_per_io:     %.2f\n",
+		       (double)tcp_stat->sock_flushes / tcp_stat->submitted_ios);
+	}
+	nvme_dump_tcp_cycles(&tcp_stat->cycles, tcp_stat->nvme_completions);
+	for (i = 0; i < tcp_stat->num_qpairs; i++) {
+		qpair_stat = &tcp_stat->qpair_stats[i];
+		printf("\tqpair %u:            submitted_ios %"PRIu64", completed_ios %"PRIu64"\n",
+		       qpair_stat->qid, qpair_stat->submitted_ios, qpair_stat->completed_ios);
+		nvme_dump_tcp_cycles(&qpair_stat->cycles, qpair_stat->completed_ios);
+	}
 }
 
 static void
@@ -1532,6 +1596,12 @@ register_ns(struct spdk_nvme_ctrlr *ctrlr, struct spdk_nvme_ns *ns)
 		g_max_io_size_blocks = entry->io_size_blocks;
 	}
 
+	/* 模板只覆盖不带元数据的 IO，DIF/DIX 仍走通用路径 */
+	if (g_io_template && entry->md_size == 0) {
+		entry->u.nvme.io_tmpl = spdk_nvme_ns_io_template_create(ns, entry->io_size_blocks,
+					entry->io_flags);
+	}
+
 	build_nvme_ns_name(entry->name, sizeof(entry->name), ctrlr, spdk_nvme_ns_get_id(ns));
 
 	g_num_namespaces++;
@@ -1546,6 +1616,9 @@ unregister_namespaces(void)
 	TAILQ_FOREACH_SAFE(entry, &g_namespaces, link, tmp) {
 		TAILQ_REMOVE(&g_namespaces, entry, link);
 		spdk_zipf_free(&entry->zipf);
+		if (entry->type == ENTRY_TYPE_NVME_NS) {
+			spdk_nvme_ns_io_template_free(entry->u.nvme.io_tmpl);
+		}
 		if (g_use_uring) {
 #ifdef SPDK_CONFIG_URING
 			close(entry->u.uring.fd);
@@ -1824,12 +1897,12 @@ task_complete(struct perf_task *task)
 
 	++g_io_completed_num;
 
-	pthread_mutex_lock(&log_mutex);
+	struct latency_ns_log *ns_log = latency_ns_log_begin();
 	struct timespec sub_time;
 	timespec_sub(&sub_time, &task->complete_time, &task->submit_time);
-	timespec_add(&(latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.latency_time), &(latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.latency_time), &sub_time);
-	latency_msg.latency_log_namespaces[task->ns_id].task_complete_latency.io_num++;
-	pthread_mutex_unlock(&log_mutex);
+	timespec_add(&(ns_log[task->ns_id].task_complete_latency.latency_time), &(ns_log[task->ns_id].task_complete_latency.latency_time), &sub_time);
+	ns_log[task->ns_id].task_complete_latency.io_num++;
+	latency_ns_log_end();
 
 #endif
 
@@ -1906,6 +1979,56 @@ io_complete(void *ctx, const struct spdk_nvme_cpl *cpl)
 	task_complete(task);
 }
 
+/* 在 ns_ctx 的所有 qpair 上打开/关闭提交批次，批次内的 IO 只敲一次 doorbell */
+static void
+ns_ctx_submit_batch_begin(struct ns_worker_ctx *ns_ctx)
+{
+	int i;
+
+	if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS) {
+		return;
+	}
+
+	for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+		spdk_nvme_qpair_submit_batch_begin(ns_ctx->u.nvme.qpair[i]);
+	}
+}
+
+static void
+ns_ctx_submit_batch_end(struct ns_worker_ctx *ns_ctx)
+{
+	int i;
+
+	if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS) {
+		return;
+	}
+
+	for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+		spdk_nvme_qpair_submit_batch_end(ns_ctx->u.nvme.qpair[i]);
+	}
+}
+
+/*
+ * 批量完成回调：一次 poll 内完成的 IO 一起处理。先预取所有 task，
+ * 再逐个完成，期间重新提交的 IO 放在同一个提交批次里一起下发
+ */
+static void
+io_complete_batch(void *ctx, struct spdk_nvme_cpl_batch_entry *entries, uint32_t num_entries)
+{
+	struct ns_worker_ctx *ns_ctx = ctx;
+	uint32_t i;
+
+	for (i = 0; i < num_entries; i++) {
+		__builtin_prefetch(entries[i].cb_arg);
+	}
+
+	ns_ctx_submit_batch_begin(ns_ctx);
+	for (i = 0; i < num_entries; i++) {
+		io_complete(entries[i].cb_arg, &entries[i].cpl);
+	}
+	ns_ctx_submit_batch_end(ns_ctx);
+}
+
 static struct perf_task *
 allocate_main_task(struct ns_worker_ctx *ns_ctx, int queue_depth, int io_id, uint32_t ns_id)
 {
@@ -1994,6 +2117,10 @@ submit_io_rep(struct worker_thread *worker, int queue_depth)
     struct perf_task *main_task = NULL;
     uint32_t io_id = 1;
 
+	TAILQ_FOREACH(ns_ctx, &worker->ns_ctx, link) {
+		ns_ctx_submit_batch_begin(ns_ctx);
+	}
+
     // [通过修改此处代码逻辑，来实现不同的入队顺序]
     // 先为每个 io 请求生成所有副本，再执行提交
     // io_id 的编号从 1 开始
@@ -2027,6 +2154,11 @@ submit_io_rep(struct worker_thread *worker, int queue_depth)
 		}
         io_id ++;
     }
+
+	// 所有副本都已经入队，每个 ns_ctx 的 qpair 只敲一次 doorbell
+	TAILQ_FOREACH(ns_ctx, &worker->ns_ctx, link) {
+		ns_ctx_submit_batch_end(ns_ctx);
+	}
 }
  
 static int
@@ -2110,6 +2242,39 @@ perf_dump_transport_statistics(struct worker_thread *worker)
 	}
 }
 
+/* 批量模式下一批 IO 的所有 PDU 在批次结束时一次性交给 socket 并 flush */
+static void
+worker_submit_batch_begin(struct worker_thread *worker)
+{
+	struct ns_worker_ctx *ns_ctx;
+	int i;
+
+	TAILQ_FOREACH(ns_ctx, &worker->ns_ctx, link) {
+		if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS || ns_ctx->is_draining) {
+			continue;
+		}
+		for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+			spdk_nvme_qpair_submit_batch_begin(ns_ctx->u.nvme.qpair[i]);
+		}
+	}
+}
+
+static void
+worker_submit_batch_end(struct worker_thread *worker)
+{
+	struct ns_worker_ctx *ns_ctx;
+	int i;
+
+	TAILQ_FOREACH(ns_ctx, &worker->ns_ctx, link) {
+		if (ns_ctx->entry->type != ENTRY_TYPE_NVME_NS) {
+			continue;
+		}
+		for (i = 0; i < ns_ctx->u.nvme.num_active_qpairs; i++) {
+			spdk_nvme_qpair_submit_batch_end(ns_ctx->u.nvme.qpair[i]);
+		}
+	}
+}
+
 static int
 work_fn(void *arg)
 {
@@ -2165,6 +2330,7 @@ work_fn(void *arg)
 				/* Submit any I/O that is queued up */
 				TAILQ_INIT(&swap);
 				TAILQ_SWAP(&swap, &ns_ctx->queued_tasks, perf_task, link);
+				ns_ctx_submit_batch_begin(ns_ctx);
 				while (!TAILQ_EMPTY(&swap)) {
 					task = TAILQ_FIRST(&swap);
 					TAILQ_REMOVE(&swap, task, link);
@@ -2175,6 +2341,7 @@ work_fn(void *arg)
 					}
 					submit_single_io(task);
 				}
+				ns_ctx_submit_batch_end(ns_ctx);
 			}
 
 			check_now = spdk_get_ticks();
@@ -2193,6 +2360,7 @@ work_fn(void *arg)
 		}
 
 		if(io_num_per_second > 0){
+			worker_submit_batch_begin(worker);
 			while(submit_batch < batch_size){
 				struct perf_task_link* temp_perf_task_link = perf_task_link_head->next;
 				if(temp_perf_task_link != NULL){
@@ -2204,6 +2372,7 @@ work_fn(void *arg)
 				submit_single_io_rep(temp_perf_task_link->task);
 				submit_batch++;
 			}
+			worker_submit_batch_end(worker);
 			if(batch >= batch_size){
 				batch = 0;
 				submit_batch = 0;
@@ -2458,6 +2627,9 @@ usage(char *program_name)
 #endif
     // --transport-stats
 	printf("\t--transport-stats dump transport statistics\n");
+	printf("\t--batch-completions deliver NVMe completions in one batch per poll\n");
+	printf("\t--adaptive-polling skip completion polls on qpairs that are not expected to complete anything\n");
+	printf("\t--io-template submit NVMe IO from a prebuilt command, for namespaces without metadata\n");
 	printf("\n\n");
 }
 
@@ -2989,6 +3161,12 @@ static const struct option g_perf_cmdline_opts[] = {
 	{"use-every-core", no_argument, NULL, PERF_USE_EVERY_CORE},
 #define PERF_NO_HUGE		270
 	{"no-huge", no_argument, NULL, PERF_NO_HUGE},
+#define PERF_BATCH_COMPLETIONS	271
+	{"batch-completions", no_argument, NULL, PERF_BATCH_COMPLETIONS},
+#define PERF_ADAPTIVE_POLLING	272
+	{"adaptive-polling", no_argument, NULL, PERF_ADAPTIVE_POLLING},
+#define PERF_IO_TEMPLATE	273
+	{"io-template", no_argument, NULL, PERF_IO_TEMPLATE},
 	/* Should be the last element */
 	{0, 0, 0, 0}
 };
@@ -3275,6 +3453,15 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 		case PERF_NO_HUGE:
 			env_opts->no_huge = true;
 			break;
+		case PERF_BATCH_COMPLETIONS:
+			g_batch_completions = true;
+			break;
+		case PERF_ADAPTIVE_POLLING:
+			g_adaptive_polling = true;
+			break;
+		case PERF_IO_TEMPLATE:
+			g_io_template = true;
+			break;
 		case PERF_HELP:
 			usage(argv[0]);
 			return HELP_RETURN_CODE;
@@ -3371,11 +3558,12 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 		return 1;
 	}
 
-	if (g_rdma_srq_size != 0) {
+	if (g_rdma_srq_size != 0 || g_dump_transport_stats) {
 		struct spdk_nvme_transport_opts opts;
 
 		spdk_nvme_transport_get_opts(&opts, sizeof(opts));
 		opts.rdma_srq_size = g_rdma_srq_size;
+		opts.tcp_cycle_stats = g_dump_transport_stats;
 
 		rc = spdk_nvme_transport_set_opts(&opts, sizeof(opts));
 		if (rc != 0) {
@@ -3786,6 +3974,8 @@ child_thread_fn(void *arg)
     {
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
 
+        /* 本线程不做 IO，负责每秒汇总各线程的时延槽 */
+        latency_log_poll();
         process_msg_recv(msgid);
 
         // 3. 更新经过时间
@@ -3959,7 +4149,6 @@ main(int argc, char **argv)
     // myprint
     printf("Create a msg queue with msgid %d. \n", g_msgid);
 
-	latency_msg.latency_log_namespaces = malloc(g_num_namespaces * sizeof(struct latency_ns_log));
 	namespace_num = g_num_namespaces;
 	init_log_fn();
 	is_prob_finish = true;
@@ -4040,6 +4229,7 @@ cleanup:
 
     /* 删除消息队列 */
     // 剩余消息数为 0，可以删除消息队列
+    latency_log_collect();
     process_msg_recv(g_msgid);
     if (msgctl(g_msgid, IPC_RMID, NULL) == -1)
     {
@@ -0,0 +1,337 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 the nof-rep authors.
+ */
+
+/*
+ * Microbenchmark for building the PRP list of a PCIe NVMe request. It runs the
+ * driver's own nvme_pcie_qpair_build_contig_request() and
+ * nvme_pcie_qpair_build_prps_sgl_request() on payloads of different sizes, so
+ * it needs neither a device nor hugepages. spdk_vtophys() is replaced by a copy
+ * of the spdk_mem_map_translate() lookup over a fake physical layout, kept out
+ * of line like the real one. Every PRP list is checked against a page by page
+ * translation before it is timed.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/log.h"
+#include "spdk/util.h"
+
+#include "nvme/nvme_pcie_common.c"
+
+#define BENCH_NUM_2MB_PAGES	8
+/* Pages below this one are physically contiguous, the rest are scattered */
+#define BENCH_CONTIG_2MB_PAGES	4
+#define BENCH_PHYS_BASE		0x100000000ULL
+#define BENCH_PAGE_SIZE		4096
+
+SPDK_LOG_REGISTER_COMPONENT(nvme)
+
+pid_t g_spdk_nvme_pid;
+struct spdk_trace_file *g_trace_file;
+
+static uint64_t g_num_iters = 1000000;
+static uint32_t g_rounds = 5;
+
+static uint8_t *g_buf;
+static uint64_t g_translation_2mb[BENCH_NUM_2MB_PAGES];
+
+/*
+ * The rest of the driver isn't linked in. None of these is reached while building
+ * PRP lists, they only satisfy the references of nvme_pcie_common.c.
+ */
+#define BENCH_STUB(fn, ret, dargs)	ret fn dargs { abort(); }
+#define BENCH_STUB_V(fn, dargs)		void fn dargs { abort(); }
+
+BENCH_STUB(nvme_completion_is_retry, bool, (const struct spdk_nvme_cpl *cpl))
+BENCH_STUB_V(nvme_completion_poll_cb, (void *arg, const struct spdk_nvme_cpl *cpl))
+BENCH_STUB_V(nvme_ctrlr_disable, (struct spdk_nvme_ctrlr *ctrlr))
+BENCH_STUB(nvme_ctrlr_disable_poll, int, (struct spdk_nvme_ctrlr *ctrlr))
+BENCH_STUB(nvme_ctrlr_get_current_process, struct spdk_nvme_ctrlr_process *,
+	   (struct spdk_nvme_ctrlr *ctrlr))
+BENCH_STUB(nvme_ctrlr_get_process, struct spdk_nvme_ctrlr_process *,
+	   (struct spdk_nvme_ctrlr *ctrlr, pid_t pid))
+BENCH_STUB(nvme_ctrlr_submit_admin_request, int,
+	   (struct spdk_nvme_ctrlr *ctrlr, struct nvme_request *req))
+BENCH_STUB_V(nvme_qpair_deinit, (struct spdk_nvme_qpair *qpair))
+BENCH_STUB_V(nvme_qpair_flush_cpl_batch, (struct spdk_nvme_qpair *qpair))
+BENCH_STUB(nvme_qpair_init, int, (struct spdk_nvme_qpair *qpair, uint16_t id,
+				  struct spdk_nvme_ctrlr *ctrlr, enum spdk_nvme_qprio qprio,
+				  uint32_t num_requests, bool async))
+BENCH_STUB(nvme_request_check_timeout, int, (struct nvme_request *req, uint16_t cid,
+		struct spdk_nvme_ctrlr_process *active_proc, uint64_t now_tick))
+BENCH_STUB_V(nvme_transport_ctrlr_disconnect_qpair_done, (struct spdk_nvme_qpair *qpair))
+BENCH_STUB(nvme_wait_for_completion, int, (struct spdk_nvme_qpair *qpair,
+		struct nvme_completion_poll_status *status))
+BENCH_STUB_V(spdk_nvme_qpair_print_command, (struct spdk_nvme_qpair *qpair,
+		struct spdk_nvme_cmd *cmd))
+BENCH_STUB_V(spdk_nvme_qpair_print_completion, (struct spdk_nvme_qpair *qpair,
+		struct spdk_nvme_cpl *cpl))
+BENCH_STUB(spdk_nvme_qpair_process_completions, int32_t, (struct spdk_nvme_qpair *qpair,
+		uint32_t max_completions))
+BENCH_STUB_V(spdk_trace_register_description_ext, (const struct spdk_trace_tpoint_opts *opts,
+		size_t num_opts))
+BENCH_STUB_V(spdk_trace_register_object, (uint8_t type, char id_prefix))
+BENCH_STUB_V(spdk_trace_register_owner_type, (uint8_t type, char id_prefix))
+BENCH_STUB_V(_spdk_trace_record, (uint64_t tsc, uint16_t tpoint_id, uint16_t owner_id,
+				  uint32_t size, uint64_t object_id, int num_args, ...))
+BENCH_STUB(spdk_zmalloc, void *, (size_t size, size_t align, uint64_t *unused, int socket_id,
+				  uint32_t flags))
+BENCH_STUB_V(spdk_free, (void *buf))
+
+/* Tracepoints stay unregistered, g_trace_file is NULL so none is recorded */
+void
+spdk_trace_add_register_fn(struct spdk_trace_register_fn *reg_fn)
+{
+}
+
+uint64_t
+spdk_get_ticks(void)
+{
+	return 0;
+}
+
+/* Same walk as spdk_mem_map_translate() and spdk_vtophys() */
+__attribute__((noinline)) uint64_t
+spdk_vtophys(const void *buf, uint64_t *size)
+{
+	uint64_t vaddr = (uintptr_t)buf, idx, translation, cur_size;
+
+	idx = (vaddr - (uintptr_t)g_buf) >> SHIFT_2MB;
+	if (vaddr < (uintptr_t)g_buf || idx >= BENCH_NUM_2MB_PAGES) {
+		return SPDK_VTOPHYS_ERROR;
+	}
+
+	translation = g_translation_2mb[idx];
+	cur_size = VALUE_2MB - (vaddr & MASK_2MB);
+	if (size != NULL) {
+		while (cur_size < *size && ++idx < BENCH_NUM_2MB_PAGES &&
+		       g_translation_2mb[idx] == g_translation_2mb[idx - 1] + VALUE_2MB) {
+			cur_size += VALUE_2MB;
+		}
+		*size = spdk_min(*size, cur_size);
+	}
+
+	return translation + (vaddr & MASK_2MB);
+}
+
+struct bench_sgl {
+	uint8_t		*base;
+	uint32_t	sge_len;
+	uint32_t	offset;
+};
+
+static void
+bench_reset_sgl(void *cb_arg, uint32_t offset)
+{
+	struct bench_sgl *sgl = cb_arg;
+
+	sgl->offset = offset;
+}
+
+/* SGEs of sge_len bytes, each one starts on the next page after the previous one */
+static int
+bench_next_sge(void *cb_arg, void **address, uint32_t *length)
+{
+	struct bench_sgl *sgl = cb_arg;
+
+	*address = sgl->base + sgl->offset / sgl->sge_len * (sgl->sge_len + BENCH_PAGE_SIZE);
+	*length = sgl->sge_len;
+	sgl->offset += sgl->sge_len;
+
+	return 0;
+}
+
+struct bench_case {
+	const char	*name;
+	uint64_t	offset;
+	uint32_t	length;
+	uint32_t	sge_len;
+};
+
+static const struct bench_case g_cases[] = {
+	{ "4 KiB",			0,		4096,		0 },
+	{ "64 KiB",			0,		64 * 1024,	0 },
+	{ "1 MiB",			0,		1024 * 1024,	0 },
+	{ "1 MiB, not contiguous",	15 * VALUE_2MB / 4, 1024 * 1024,	0 },
+	{ "1 MiB as 32 SGEs",		0,		1024 * 1024,	32 * 1024 },
+};
+
+/* Where page i of the payload is, the way the old page by page loop found it */
+static uint64_t
+bench_page_phys(const struct bench_case *c, const struct bench_sgl *sgl, uint32_t i)
+{
+	uint8_t *vaddr = g_buf + c->offset + (uint64_t)i * BENCH_PAGE_SIZE;
+
+	if (c->sge_len != 0) {
+		vaddr = sgl->base + (uint64_t)i * BENCH_PAGE_SIZE / c->sge_len * (c->sge_len + BENCH_PAGE_SIZE) +
+			(uint64_t)i * BENCH_PAGE_SIZE % c->sge_len;
+	}
+
+	return spdk_vtophys(vaddr, NULL);
+}
+
+static int
+bench_build(const struct bench_case *c, struct spdk_nvme_qpair *qpair, struct nvme_request *req,
+	    struct nvme_tracker *tr)
+{
+	if (c->sge_len != 0) {
+		return nvme_pcie_qpair_build_prps_sgl_request(qpair, req, tr, false);
+	}
+
+	return nvme_pcie_qpair_build_contig_request(qpair, req, tr, false);
+}
+
+static int
+bench_verify(const struct bench_case *c, const struct bench_sgl *sgl,
+	     const struct nvme_request *req, const struct nvme_tracker *tr)
+{
+	uint32_t i, num_pages = c->length / BENCH_PAGE_SIZE;
+
+	if (req->cmd.dptr.prp.prp1 != bench_page_phys(c, sgl, 0)) {
+		return -1;
+	}
+	if (num_pages == 1) {
+		return req->cmd.dptr.prp.prp2 == 0 ? 0 : -1;
+	}
+	if (num_pages == 2) {
+		return req->cmd.dptr.prp.prp2 == bench_page_phys(c, sgl, 1) ? 0 : -1;
+	}
+	if (req->cmd.dptr.prp.prp2 != tr->prp_sgl_bus_addr) {
+		return -1;
+	}
+	for (i = 1; i < num_pages; i++) {
+		if (tr->u.prp[i - 1] != bench_page_phys(c, sgl, i)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+bench_run(const struct bench_case *c, struct spdk_nvme_qpair *qpair, struct nvme_tracker *tr)
+{
+	struct nvme_request req = {};
+	struct bench_sgl sgl = {};
+	struct timespec start, end;
+	uint64_t i, ns, best_ns = UINT64_MAX;
+	uint32_t r;
+
+	req.payload_size = c->length;
+	if (c->sge_len != 0) {
+		sgl.base = g_buf + c->offset;
+		sgl.sge_len = c->sge_len;
+		req.payload = NVME_PAYLOAD_SGL(bench_reset_sgl, bench_next_sge, &sgl, NULL);
+	} else {
+		req.payload = NVME_PAYLOAD_CONTIG(g_buf + c->offset, NULL);
+	}
+	tr->req = &req;
+
+	if (bench_build(c, qpair, &req, tr) != 0 || bench_verify(c, &sgl, &req, tr) != 0) {
+		fprintf(stderr, "%s: wrong PRP list\n", c->name);
+		return -1;
+	}
+
+	for (r = 0; r < g_rounds; r++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < g_num_iters; i++) {
+			bench_build(c, qpair, &req, tr);
+			/* Keep the compiler from dropping the stores into the tracker */
+			__asm__ volatile("" : : "r"(tr) : "memory");
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		ns = (end.tv_sec - start.tv_sec) * SPDK_SEC_TO_NSEC + end.tv_nsec - start.tv_nsec;
+		best_ns = spdk_min(best_ns, ns);
+	}
+
+	printf("%-24s %8u %10.1f\n", c->name, c->length / BENCH_PAGE_SIZE,
+	       (double)best_ns / g_num_iters);
+
+	return 0;
+}
+
+static void
+usage(char *program_name)
+{
+	printf("%s options\n", program_name);
+	printf("\t[-n PRP lists built per round (default: 1000000)]\n");
+	printf("\t[-r rounds, the fastest one is reported (default: 5)]\n");
+	printf("\t[-h show this usage]\n");
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	int op;
+	long long value;
+
+	while ((op = getopt(argc, argv, "n:r:h")) != -1) {
+		switch (op) {
+		case 'n':
+		case 'r':
+			value = strtoll(optarg, NULL, 10);
+			if (value <= 0 || (op == 'r' && value > UINT32_MAX)) {
+				fprintf(stderr, "invalid value %s for -%c\n", optarg, op);
+				return -EINVAL;
+			}
+			if (op == 'n') {
+				g_num_iters = value;
+			} else {
+				g_rounds = value;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+		default:
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct spdk_nvme_qpair qpair = {};
+	struct nvme_tracker *tr;
+	uint32_t i;
+	int rc = 0;
+
+	if (parse_args(argc, argv) != 0) {
+		return 1;
+	}
+
+	g_buf = aligned_alloc(VALUE_2MB, BENCH_NUM_2MB_PAGES * VALUE_2MB);
+	tr = aligned_alloc(sizeof(*tr), sizeof(*tr));
+	if (g_buf == NULL || tr == NULL) {
+		fprintf(stderr, "could not allocate the payload buffer\n");
+		return 1;
+	}
+	memset(tr, 0, sizeof(*tr));
+	tr->prp_sgl_bus_addr = BENCH_PHYS_BASE - sizeof(*tr);
+
+	for (i = 0; i < BENCH_NUM_2MB_PAGES; i++) {
+		g_translation_2mb[i] = BENCH_PHYS_BASE + (i < BENCH_CONTIG_2MB_PAGES ? i : 3 * i) * VALUE_2MB;
+	}
+
+	ctrlr.page_size = BENCH_PAGE_SIZE;
+	ctrlr.trid.trtype = SPDK_NVME_TRANSPORT_PCIE;
+	qpair.ctrlr = &ctrlr;
+
+	printf("%-24s %8s %10s\n", "payload", "pages", "ns/build");
+	for (i = 0; i < SPDK_COUNTOF(g_cases); i++) {
+		rc = bench_run(&g_cases[i], &qpair, tr);
+		if (rc != 0) {
+			break;
+		}
+	}
+
+	free(tr);
+	free(g_buf);
+	return rc == 0 ? 0 : 1;
+}
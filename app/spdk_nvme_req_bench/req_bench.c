@@ -0,0 +1,219 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 the nof-rep authors.
+ */
+
+/*
+ * Microbenchmark for the layout of struct nvme_request. It keeps a deep queue of
+ * requests in flight on a fake queue pair and, like a device completing out of
+ * order, completes a random one and submits a new request in its place, using the
+ * driver's own nvme_allocate_request() and nvme_complete_request(). With a queue
+ * deeper than the caches, every completion touches a request that has been
+ * evicted, so the time per I/O follows the number of cache lines the hot path
+ * touches.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/util.h"
+
+#include "nvme/nvme_internal.h"
+
+pid_t g_spdk_nvme_pid;
+
+/* Not reached, the fake queue pair has no completion batch */
+void
+nvme_qpair_flush_cpl_batch(struct spdk_nvme_qpair *qpair)
+{
+	abort();
+}
+
+static uint32_t g_queue_depth = 65536;
+static uint64_t g_num_ios = 10000000;
+static uint32_t g_rounds = 5;
+
+static void
+usage(char *program_name)
+{
+	printf("%s options\n", program_name);
+	printf("\t[-q requests in flight (default: 65536)]\n");
+	printf("\t[-n I/Os per round (default: 10000000)]\n");
+	printf("\t[-r rounds, the fastest one is reported (default: 5)]\n");
+	printf("\t[-h show this usage]\n");
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	int op;
+	long long value;
+
+	while ((op = getopt(argc, argv, "q:n:r:h")) != -1) {
+		switch (op) {
+		case 'q':
+		case 'n':
+		case 'r':
+			value = strtoll(optarg, NULL, 10);
+			if (value <= 0 || (op != 'n' && value > UINT32_MAX)) {
+				fprintf(stderr, "invalid value %s for -%c\n", optarg, op);
+				return -EINVAL;
+			}
+			if (op == 'q') {
+				g_queue_depth = value;
+			} else if (op == 'n') {
+				g_num_ios = value;
+			} else {
+				g_rounds = value;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+		default:
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static void
+io_complete(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	uint64_t *num_completed = cb_arg;
+
+	(*num_completed)++;
+}
+
+#define HOT_LINE(lines, member)								\
+	do {										\
+		size_t _first = offsetof(struct nvme_request, member) / 64;		\
+		size_t _last = (offsetof(struct nvme_request, member) +			\
+				sizeof(((struct nvme_request *)0)->member) - 1) / 64;	\
+		for (; _first <= _last; _first++) {					\
+			lines |= 1ULL << _first;					\
+		}									\
+	} while (0)
+
+/* Cache lines of the members a plain read or write touches on submit and completion */
+static uint32_t
+hot_lines(void)
+{
+	uint64_t lines = 0;
+	size_t i;
+
+	/* nvme_request_clear() zeroes everything in front of payload_size */
+	for (i = 0; i < offsetof(struct nvme_request, payload_size); i += 64) {
+		lines |= 1ULL << (i / 64);
+	}
+	HOT_LINE(lines, cmd);
+	HOT_LINE(lines, payload_offset);
+	HOT_LINE(lines, payload_size);
+	HOT_LINE(lines, md_size);
+	HOT_LINE(lines, cb_fn);
+	HOT_LINE(lines, cb_arg);
+	HOT_LINE(lines, qpair);
+	HOT_LINE(lines, stailq);
+	HOT_LINE(lines, accel_sequence);
+	HOT_LINE(lines, payload);
+	HOT_LINE(lines, submit_tick);
+	HOT_LINE(lines, pid);
+
+	return __builtin_popcountll(lines);
+}
+
+static inline uint64_t
+xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+
+	return x;
+}
+
+static inline struct nvme_request *
+submit_io(struct spdk_nvme_qpair *qpair, void *buf, uint64_t lba, uint64_t *num_completed)
+{
+	struct nvme_payload payload = NVME_PAYLOAD_CONTIG(buf, NULL);
+	struct nvme_request *req;
+
+	req = nvme_allocate_request(qpair, &payload, 4096, 0, io_complete, num_completed);
+	assert(req != NULL);
+
+	/* What _nvme_ns_cmd_rw() and the transport fill in */
+	req->cmd.opc = SPDK_NVME_OPC_READ;
+	req->cmd.nsid = 1;
+	req->cmd.cdw10 = (uint32_t)lba;
+	req->cmd.cdw11 = (uint32_t)(lba >> 32);
+	req->cmd.cdw12 = 0;
+	req->cmd.dptr.prp.prp1 = (uintptr_t)req->payload.contig_or_cb_arg + req->payload_offset;
+	req->cmd.cid = (uint16_t)lba;
+	req->qpair = qpair;
+	req->submit_tick = lba;
+
+	return req;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_nvme_qpair *qpair;
+	struct nvme_request *reqs, **inflight;
+	struct spdk_nvme_cpl cpl = {};
+	struct timespec start, end;
+	uint64_t num_completed = 0, rng = 0x9e3779b97f4a7c15ULL;
+	uint64_t i, ns, best_ns = UINT64_MAX;
+	uint32_t r, idx;
+	char buf[64];
+
+	if (parse_args(argc, argv) != 0) {
+		return 1;
+	}
+
+	qpair = calloc(1, sizeof(*qpair));
+	reqs = calloc(g_queue_depth, sizeof(*reqs));
+	inflight = calloc(g_queue_depth, sizeof(*inflight));
+	if (qpair == NULL || reqs == NULL || inflight == NULL) {
+		fprintf(stderr, "could not allocate %u requests\n", g_queue_depth);
+		return 1;
+	}
+
+	STAILQ_INIT(&qpair->free_req);
+	TAILQ_INIT(&qpair->err_cmd_head);
+	for (i = 0; i < g_queue_depth; i++) {
+		STAILQ_INSERT_HEAD(&qpair->free_req, &reqs[i], stailq);
+	}
+	for (i = 0; i < g_queue_depth; i++) {
+		inflight[i] = submit_io(qpair, buf, i, &num_completed);
+	}
+
+	printf("struct nvme_request: %zu bytes, hot path touches %u cache lines\n",
+	       sizeof(struct nvme_request), hot_lines());
+	printf("%u requests in flight, %" PRIu64 " I/Os per round\n", g_queue_depth, g_num_ios);
+
+	for (r = 0; r < g_rounds; r++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < g_num_ios; i++) {
+			idx = xorshift64(&rng) % g_queue_depth;
+			nvme_complete_request(inflight[idx]->cb_fn, inflight[idx]->cb_arg, qpair,
+					      inflight[idx], &cpl);
+			inflight[idx] = submit_io(qpair, buf, i, &num_completed);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		ns = (end.tv_sec - start.tv_sec) * SPDK_SEC_TO_NSEC + end.tv_nsec - start.tv_nsec;
+		printf("round %u: %.2f ns/IO\n", r, (double)ns / g_num_ios);
+		best_ns = spdk_min(best_ns, ns);
+	}
+
+	printf("best: %.2f ns/IO (%" PRIu64 " completions)\n", (double)best_ns / g_num_ios,
+	       num_completed);
+
+	free(inflight);
+	free(reqs);
+	free(qpair);
+	return 0;
+}
@@ -13,13 +13,23 @@
 #include "spdk/bdev.h"
 #include "spdk/rpc.h"
 #include "spdk/nvmf.h"
+#include "spdk/nvmf_transport.h"
 #include "spdk/likely.h"
 #include "spdk/util.h"
+#ifdef TARGET_LATENCY_LOG
+#include "spdk/latency_shm.h"
+#endif
 
 #include "spdk_internal/event.h"
 
 #define NVMF_DEFAULT_SUBSYSTEMS		32
-#define NVMF_GETOPT_STRING "g:i:m:n:p:r:s:u:h"
+#define NVMF_GETOPT_STRING "g:i:m:n:p:P:r:s:u:h"
+
+/* Poll group migration period used by the load-aware policies if -g is not given */
+#define NVMF_DEFAULT_BALANCE_PERIOD_US	1000000
+/* Don't migrate unless the busiest and the idlest core differ by this share of the period */
+#define NVMF_BALANCE_IMBALANCE_PCT	10
+#define NVMF_PG_MAX_HOSTS		32
 
 static const char *g_rpc_addr = SPDK_DEFAULT_RPC_ADDR;
 
@@ -47,10 +57,30 @@ struct nvmf_reactor {
 	TAILQ_ENTRY(nvmf_reactor)	link;
 };
 
+enum nvmf_pg_policy {
+	/* move every poll group to the next core each period */
+	NVMF_PG_POLICY_RR = 0,
+	/* move one poll group off the busiest core each period */
+	NVMF_PG_POLICY_LOAD,
+	/* like load, but poll groups serving the same host never share a core */
+	NVMF_PG_POLICY_PINNED,
+};
+
 struct nvmf_target_poll_group {
 	struct spdk_nvmf_poll_group		*group;
 	struct spdk_thread			*thread;
 
+	/* core the poll group runs on, as last reported by its thread */
+	uint32_t				core;
+
+	/* Written on the poll group thread, read on the init thread after the
+	 * sample message came back.
+	 */
+	struct spdk_thread_stats		stats;
+	uint64_t				busy_tsc;
+	uint32_t				num_hosts;
+	uint32_t				hosts[NVMF_PG_MAX_HOSTS];
+
 	TAILQ_ENTRY(nvmf_target_poll_group)	link;
 };
 
@@ -80,6 +110,35 @@ static bool g_intr_received = false;
 
 static uint32_t g_migrate_pg_period_us = 0;
 static struct spdk_poller *g_migrate_pg_poller = NULL;
+static enum nvmf_pg_policy g_pg_policy = NVMF_PG_POLICY_RR;
+
+struct nvmf_pg_balance {
+	/* poll groups that have not reported their sample of this round yet */
+	uint32_t		pending;
+	/* set on shutdown, the last outstanding sample frees the state */
+	bool			stopping;
+	uint64_t		last_tsc;
+	/* cores that poll groups may be placed on */
+	struct spdk_cpuset	cores;
+	uint32_t		max_core;
+	uint64_t		*core_busy;
+	uint32_t		*core_pgs;
+};
+static struct nvmf_pg_balance g_balance;
+
+/* Latency of the periods right after a migration ([1]) vs. the other periods ([0]) */
+struct nvmf_migrate_report {
+	uint64_t		num_migrations;
+	bool			migrated;
+	bool			started;
+	uint64_t		io_num;
+	uint64_t		total_ns;
+	uint64_t		last_avg_ns;
+	uint64_t		periods[2];
+	uint64_t		period_io_num[2];
+	uint64_t		period_total_ns[2];
+};
+static struct nvmf_migrate_report g_migrate_report;
 
 static void nvmf_target_advance_state(void);
 static int nvmf_schedule_spdk_thread(struct spdk_thread *thread);
@@ -89,11 +148,16 @@ usage(char *program_name)
 {
 	printf("%s options", program_name);
 	printf("\n");
-	printf("\t[-g period of round robin poll group migration (us) (default: 0 (disabled))]\n");
+	printf("\t[-g period of poll group migration (us) (default: 0 (disabled))]\n");
 	printf("\t[-h show this usage]\n");
 	printf("\t[-i shared memory ID (optional)]\n");
 	printf("\t[-m core mask for DPDK]\n");
 	printf("\t[-n max subsystems for target(default: 32)]\n");
+	printf("\t[-P poll group placement policy: rr, load or pinned (default: rr)]\n");
+	printf("\t\t rr: move every poll group to the next core each -g period\n");
+	printf("\t\t load: sample busy ticks each -g period (default: 1s) and move one poll group\n");
+	printf("\t\t       off the busiest core\n");
+	printf("\t\t pinned: like load, but keep qpairs of the same host on distinct cores\n");
 	printf("\t[-r RPC listen address (default /var/tmp/spdk.sock)]\n");
 	printf("\t[-s memory size in MB for DPDK (default: 0MB)]\n");
 	printf("\t[-u disable PCI access]\n");
@@ -140,6 +204,18 @@ parse_args(int argc, char **argv, struct spdk_env_opts *opts)
 				return -EINVAL;
 			}
 			break;
+		case 'P':
+			if (strcmp(optarg, "rr") == 0) {
+				g_pg_policy = NVMF_PG_POLICY_RR;
+			} else if (strcmp(optarg, "load") == 0) {
+				g_pg_policy = NVMF_PG_POLICY_LOAD;
+			} else if (strcmp(optarg, "pinned") == 0) {
+				g_pg_policy = NVMF_PG_POLICY_PINNED;
+			} else {
+				fprintf(stderr, "unknown poll group policy %s\n", optarg);
+				return -EINVAL;
+			}
+			break;
 		case 'r':
 			g_rpc_addr = optarg;
 			break;
@@ -602,6 +678,7 @@ nvmf_tgt_create_poll_group(void *ctx)
 	}
 
 	pg->thread = spdk_get_thread();
+	pg->core = spdk_env_get_current_core();
 	pg->group = spdk_nvmf_poll_group_create(g_nvmf_tgt.tgt);
 	if (!pg->group) {
 		fprintf(stderr, "failed to create poll group of the target\n");
@@ -745,18 +822,423 @@ migrate_poll_group_by_rr(void *ctx)
 	spdk_thread_set_cpumask(&cpumask);
 }
 
+#ifdef TARGET_LATENCY_LOG
+/* Sum the target stage of every slot in the latency shm, like spdk_latency_shm does. */
+static bool
+nvmf_latency_snapshot(uint64_t *io_num, uint64_t *total_ns)
+{
+	const struct spdk_latency_shm_file *file = spdk_latency_shm_get_file();
+	struct spdk_latency_shm_slot slot;
+	uint32_t i, num_slots;
+
+	if (file == NULL) {
+		return false;
+	}
+
+	*io_num = 0;
+	*total_ns = 0;
+	num_slots = spdk_min(__atomic_load_n(&file->num_slots, __ATOMIC_ACQUIRE), file->max_slots);
+	for (i = 0; i < num_slots; i++) {
+		if (spdk_latency_shm_read_slot(file, i, &slot) != 0) {
+			continue;
+		}
+		*io_num += slot.stage[SPDK_LATENCY_SHM_STAGE_TARGET].io_num;
+		*total_ns += slot.stage[SPDK_LATENCY_SHM_STAGE_TARGET].total_ns;
+	}
+
+	return true;
+}
+#endif
+
+/* Called once per migration period, before this period's migrations are issued.
+ * Accounts the latency of the period that just ended to the periods that
+ * followed a migration or to the quiet ones.
+ */
+static void
+nvmf_migrate_report_period(void)
+{
+#ifdef TARGET_LATENCY_LOG
+	struct nvmf_migrate_report *r = &g_migrate_report;
+	uint64_t io_num, total_ns, d_io_num, d_total_ns, avg_ns;
+	int i = r->migrated ? 1 : 0;
+
+	if (!nvmf_latency_snapshot(&io_num, &total_ns)) {
+		r->migrated = false;
+		return;
+	}
+
+	if (r->started) {
+		d_io_num = io_num - r->io_num;
+		d_total_ns = total_ns - r->total_ns;
+		avg_ns = d_io_num ? d_total_ns / d_io_num : 0;
+
+		r->periods[i]++;
+		r->period_io_num[i] += d_io_num;
+		r->period_total_ns[i] += d_total_ns;
+
+		if (r->migrated && g_pg_policy != NVMF_PG_POLICY_RR && d_io_num != 0) {
+			printf("\tavg target latency after migration: %.2f us (period before: %.2f us)\n",
+			       (double)avg_ns / 1000, (double)r->last_avg_ns / 1000);
+		}
+		r->last_avg_ns = avg_ns;
+	}
+
+	r->io_num = io_num;
+	r->total_ns = total_ns;
+	r->started = true;
+#endif
+	g_migrate_report.migrated = false;
+}
+
+static void
+nvmf_migrate_report_print(void)
+{
+	struct nvmf_migrate_report *r = &g_migrate_report;
+
+	if (g_migrate_pg_poller == NULL) {
+		return;
+	}
+
+	printf("poll group migrations: %" PRIu64 "\n", r->num_migrations);
+#ifdef TARGET_LATENCY_LOG
+	printf("\tperiods without migration: %" PRIu64 ", avg target latency %.2f us\n", r->periods[0],
+	       r->period_io_num[0] ? (double)r->period_total_ns[0] / r->period_io_num[0] / 1000 : 0.0);
+	printf("\tperiods after a migration: %" PRIu64 ", avg target latency %.2f us\n", r->periods[1],
+	       r->period_io_num[1] ? (double)r->period_total_ns[1] / r->period_io_num[1] / 1000 : 0.0);
+#endif
+}
+
 static int
 migrate_poll_groups_by_rr(void *ctx)
 {
 	struct nvmf_target_poll_group *pg;
 
+	nvmf_migrate_report_period();
+
 	TAILQ_FOREACH(pg, &g_poll_groups, link) {
 		spdk_thread_send_msg(pg->thread, migrate_poll_group_by_rr, NULL);
+		g_migrate_report.num_migrations++;
+	}
+	g_migrate_report.migrated = true;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+migrate_poll_group_to_core(void *ctx)
+{
+	uint32_t core = (uint32_t)(uintptr_t)ctx;
+	struct spdk_cpuset cpumask = {};
+
+	spdk_cpuset_set_cpu(&cpumask, core, true);
+
+	spdk_thread_set_cpumask(&cpumask);
+}
+
+static void
+nvmf_pg_migrate(struct nvmf_target_poll_group *pg, uint32_t core, uint64_t period_tsc)
+{
+	printf("migrate %s: core %u (busy %" PRIu64 "%%) -> core %u (busy %" PRIu64 "%%)\n",
+	       spdk_thread_get_name(pg->thread), pg->core,
+	       g_balance.core_busy[pg->core] * 100 / period_tsc, core,
+	       g_balance.core_busy[core] * 100 / period_tsc);
+
+	spdk_thread_send_msg(pg->thread, migrate_poll_group_to_core, (void *)(uintptr_t)core);
+
+	g_balance.core_busy[pg->core] -= pg->busy_tsc;
+	g_balance.core_pgs[pg->core]--;
+	g_balance.core_busy[core] += pg->busy_tsc;
+	g_balance.core_pgs[core]++;
+	pg->core = core;
+
+	g_migrate_report.num_migrations++;
+	g_migrate_report.migrated = true;
+}
+
+/* Whether pg serves a host that another poll group on the given core serves too. */
+static bool
+nvmf_pg_conflicts(struct nvmf_target_poll_group *pg, uint32_t core)
+{
+	struct nvmf_target_poll_group *other;
+	uint32_t i, j;
+
+	TAILQ_FOREACH(other, &g_poll_groups, link) {
+		if (other == pg || other->core != core) {
+			continue;
+		}
+		for (i = 0; i < pg->num_hosts; i++) {
+			for (j = 0; j < other->num_hosts; j++) {
+				if (pg->hosts[i] == other->hosts[j]) {
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+/* Pinned mode: move a poll group that shares its core with another poll group
+ * of the same host to the idlest core where it doesn't conflict.
+ */
+static bool
+nvmf_pg_separate_hosts(uint64_t period_tsc)
+{
+	struct nvmf_target_poll_group *pg;
+	uint32_t core, dst;
+
+	TAILQ_FOREACH(pg, &g_poll_groups, link) {
+		if (!nvmf_pg_conflicts(pg, pg->core)) {
+			continue;
+		}
+
+		dst = UINT32_MAX;
+		SPDK_ENV_FOREACH_CORE(core) {
+			if (core == pg->core || !spdk_cpuset_get_cpu(&g_balance.cores, core) ||
+			    nvmf_pg_conflicts(pg, core)) {
+				continue;
+			}
+			if (dst == UINT32_MAX || g_balance.core_busy[core] < g_balance.core_busy[dst]) {
+				dst = core;
+			}
+		}
+
+		if (dst != UINT32_MAX) {
+			nvmf_pg_migrate(pg, dst, period_tsc);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Called on the init thread once every poll group reported its busy ticks.
+ * Moves at most one poll group per period: the one on the busiest core whose
+ * load brings the busiest and the idlest core closest together.
+ */
+static void
+nvmf_pg_rebalance(void)
+{
+	struct nvmf_target_poll_group *pg, *best = NULL;
+	uint64_t now, period_tsc, diff, best_dist = UINT64_MAX, dist;
+	uint32_t core, busiest = UINT32_MAX, idlest = UINT32_MAX;
+
+	now = spdk_get_ticks();
+	period_tsc = now - g_balance.last_tsc;
+	if (g_balance.last_tsc == 0 || period_tsc == 0) {
+		/* The first round only establishes the baseline of the busy counters. */
+		g_balance.last_tsc = now;
+		return;
+	}
+	g_balance.last_tsc = now;
+
+	memset(g_balance.core_busy, 0, (g_balance.max_core + 1) * sizeof(uint64_t));
+	memset(g_balance.core_pgs, 0, (g_balance.max_core + 1) * sizeof(uint32_t));
+	TAILQ_FOREACH(pg, &g_poll_groups, link) {
+		g_balance.core_busy[pg->core] += pg->busy_tsc;
+		g_balance.core_pgs[pg->core]++;
+	}
+
+	if (g_pg_policy == NVMF_PG_POLICY_PINNED && nvmf_pg_separate_hosts(period_tsc)) {
+		return;
+	}
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		if (!spdk_cpuset_get_cpu(&g_balance.cores, core)) {
+			continue;
+		}
+		/* Moving the only poll group of a core elsewhere never helps. */
+		if (g_balance.core_pgs[core] > 1 &&
+		    (busiest == UINT32_MAX || g_balance.core_busy[core] > g_balance.core_busy[busiest])) {
+			busiest = core;
+		}
+		if (idlest == UINT32_MAX || g_balance.core_busy[core] < g_balance.core_busy[idlest]) {
+			idlest = core;
+		}
+	}
+
+	if (busiest == UINT32_MAX || idlest == UINT32_MAX ||
+	    g_balance.core_busy[busiest] <= g_balance.core_busy[idlest]) {
+		return;
+	}
+
+	diff = g_balance.core_busy[busiest] - g_balance.core_busy[idlest];
+	if (diff * 100 < period_tsc * NVMF_BALANCE_IMBALANCE_PCT) {
+		return;
+	}
+
+	TAILQ_FOREACH(pg, &g_poll_groups, link) {
+		if (pg->core != busiest || pg->busy_tsc == 0 || pg->busy_tsc >= diff) {
+			continue;
+		}
+		if (g_pg_policy == NVMF_PG_POLICY_PINNED && nvmf_pg_conflicts(pg, idlest)) {
+			continue;
+		}
+		dist = pg->busy_tsc * 2 > diff ? pg->busy_tsc * 2 - diff : diff - pg->busy_tsc * 2;
+		if (dist < best_dist) {
+			best_dist = dist;
+			best = pg;
+		}
+	}
+
+	if (best != NULL) {
+		nvmf_pg_migrate(best, idlest, period_tsc);
+	}
+}
+
+static void nvmf_pg_balance_free(void);
+
+static void
+nvmf_pg_sample_done(void *ctx)
+{
+	assert(g_balance.pending > 0);
+
+	if (--g_balance.pending == 0) {
+		if (g_balance.stopping) {
+			nvmf_pg_balance_free();
+			return;
+		}
+		nvmf_pg_rebalance();
+	}
+}
+
+static uint32_t
+nvmf_host_hash(const char *traddr)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*traddr != '\0') {
+		hash = (hash ^ (uint8_t)*traddr++) * 16777619u;
+	}
+
+	return hash;
+}
+
+/* Runs on the poll group thread: sample the busy ticks of the last period and,
+ * in pinned mode, the hosts this poll group serves.
+ */
+static void
+nvmf_pg_sample(void *ctx)
+{
+	struct nvmf_target_poll_group *pg = ctx;
+	struct spdk_thread_stats stats;
+	struct spdk_nvmf_qpair *qpair;
+	struct spdk_nvme_transport_id trid;
+	uint32_t hash, i;
+
+	spdk_thread_get_stats(&stats);
+	pg->busy_tsc = stats.busy_tsc - pg->stats.busy_tsc;
+	pg->stats = stats;
+	pg->core = spdk_env_get_current_core();
+
+	pg->num_hosts = 0;
+	if (g_pg_policy == NVMF_PG_POLICY_PINNED) {
+		TAILQ_FOREACH(qpair, &pg->group->qpairs, link) {
+			if (spdk_nvmf_qpair_get_peer_trid(qpair, &trid) != 0) {
+				continue;
+			}
+			hash = nvmf_host_hash(trid.traddr);
+			for (i = 0; i < pg->num_hosts; i++) {
+				if (pg->hosts[i] == hash) {
+					break;
+				}
+			}
+			if (i == pg->num_hosts && pg->num_hosts < NVMF_PG_MAX_HOSTS) {
+				pg->hosts[pg->num_hosts++] = hash;
+			}
+		}
+	}
+
+	spdk_thread_send_msg(g_init_thread, nvmf_pg_sample_done, NULL);
+}
+
+static int
+migrate_poll_groups_by_load(void *ctx)
+{
+	struct nvmf_target_poll_group *pg;
+
+	if (g_balance.pending != 0) {
+		/* Previous round is still being collected. */
+		return SPDK_POLLER_IDLE;
+	}
+
+	nvmf_migrate_report_period();
+
+	g_balance.pending = g_num_poll_groups;
+	TAILQ_FOREACH(pg, &g_poll_groups, link) {
+		spdk_thread_send_msg(pg->thread, nvmf_pg_sample, pg);
 	}
 
 	return SPDK_POLLER_BUSY;
 }
 
+static int
+nvmf_pg_balance_init(void)
+{
+	struct nvmf_target_poll_group *pg;
+
+	g_balance.max_core = spdk_env_get_last_core();
+	g_balance.core_busy = calloc(g_balance.max_core + 1, sizeof(uint64_t));
+	g_balance.core_pgs = calloc(g_balance.max_core + 1, sizeof(uint32_t));
+	if (g_balance.core_busy == NULL || g_balance.core_pgs == NULL) {
+		free(g_balance.core_busy);
+		free(g_balance.core_pgs);
+		return -ENOMEM;
+	}
+
+	/* Only the cores that got a poll group at start up take part. */
+	spdk_cpuset_zero(&g_balance.cores);
+	TAILQ_FOREACH(pg, &g_poll_groups, link) {
+		spdk_cpuset_set_cpu(&g_balance.cores, pg->core, true);
+	}
+
+	return 0;
+}
+
+static void
+nvmf_pg_balance_free(void)
+{
+	free(g_balance.core_busy);
+	free(g_balance.core_pgs);
+	g_balance.core_busy = NULL;
+	g_balance.core_pgs = NULL;
+}
+
+static void
+nvmf_pg_balance_fini(void)
+{
+	g_balance.stopping = true;
+
+	/* Otherwise nvmf_pg_sample_done() frees it once the last sample arrives. */
+	if (g_balance.pending == 0) {
+		nvmf_pg_balance_free();
+	}
+}
+
+static void
+nvmf_start_pg_migration(void)
+{
+	if (g_pg_policy == NVMF_PG_POLICY_RR) {
+		if (g_migrate_pg_period_us != 0) {
+			g_migrate_pg_poller = SPDK_POLLER_REGISTER(migrate_poll_groups_by_rr, NULL,
+					      g_migrate_pg_period_us);
+		}
+		return;
+	}
+
+	if (g_migrate_pg_period_us == 0) {
+		g_migrate_pg_period_us = NVMF_DEFAULT_BALANCE_PERIOD_US;
+	}
+
+	if (nvmf_pg_balance_init() != 0) {
+		fprintf(stderr, "failed to allocate poll group balance state\n");
+		return;
+	}
+
+	g_migrate_pg_poller = SPDK_POLLER_REGISTER(migrate_poll_groups_by_load, NULL,
+			      g_migrate_pg_period_us);
+}
+
 static void
 nvmf_target_advance_state(void)
 {
@@ -784,13 +1266,13 @@ nvmf_target_advance_state(void)
 			init_log_fn();
 			#endif
 			fprintf(stdout, "nvmf target is running\n");
-			if (g_migrate_pg_period_us != 0) {
-				g_migrate_pg_poller = SPDK_POLLER_REGISTER(migrate_poll_groups_by_rr, NULL,
-						      g_migrate_pg_period_us);
-			}
+			nvmf_start_pg_migration();
 			break;
 		case NVMF_FINI_STOP_SUBSYSTEMS:
+			nvmf_migrate_report_print();
 			spdk_poller_unregister(&g_migrate_pg_poller);
+			/* No more migrations once the poll groups start going away */
+			nvmf_pg_balance_fini();
 			nvmf_tgt_stop_subsystems(&g_nvmf_tgt);
 			break;
 		case NVMF_FINI_POLL_GROUPS:
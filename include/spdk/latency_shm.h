@@ -0,0 +1,196 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 the nof-rep authors.
+ */
+
+/** \file
+ * Live latency counters published in POSIX shared memory.
+ *
+ * The layout follows the spdk_trace shm: a fixed header followed by
+ * per-slot sections referenced by offsets from the beginning of the file.
+ * Every SPDK thread that records latency owns exactly one slot, so writers
+ * never share a cache line and never take a lock.  Readers map the file
+ * read-only and may sample it at any rate.
+ */
+
+#ifndef SPDK_LATENCY_SHM_H
+#define SPDK_LATENCY_SHM_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPDK_LATENCY_SHM_MAGIC		0x4c4154534853444bULL /* "KDSHSTAL" */
+#define SPDK_LATENCY_SHM_VERSION	1
+
+/** Default shm name prefix, the pid of the target is appended. */
+#define SPDK_LATENCY_SHM_NAME_PREFIX	"/spdk_tgt_latency"
+
+#define SPDK_LATENCY_SHM_MAX_SLOTS	128
+#define SPDK_LATENCY_SHM_SLOT_NAME_LEN	32
+
+/** Histogram buckets are power-of-two ranges of nanoseconds: bucket i holds [2^i, 2^(i+1)). */
+#define SPDK_LATENCY_SHM_NUM_BUCKETS	40
+
+enum spdk_latency_shm_stage {
+	SPDK_LATENCY_SHM_STAGE_TARGET = 0,
+	SPDK_LATENCY_SHM_STAGE_BDEV,
+	SPDK_LATENCY_SHM_STAGE_DRIVER,
+	SPDK_LATENCY_SHM_NUM_STAGES,
+};
+
+struct spdk_latency_shm_stage_stats {
+	uint64_t	io_num;
+	uint64_t	total_ns;
+	uint64_t	min_ns;
+	uint64_t	max_ns;
+	uint64_t	buckets[SPDK_LATENCY_SHM_NUM_BUCKETS];
+};
+
+struct spdk_latency_shm_slot {
+	/**
+	 * Sequence counter, odd while the owning thread updates the slot.
+	 * Readers retry their copy if it changed or was odd.
+	 */
+	volatile uint64_t			seq;
+	char					name[SPDK_LATENCY_SHM_SLOT_NAME_LEN];
+	uint8_t					reserved[24];
+	struct spdk_latency_shm_stage_stats	stage[SPDK_LATENCY_SHM_NUM_STAGES];
+} __attribute__((aligned(64)));
+
+struct spdk_latency_shm_file {
+	uint64_t	magic;
+	uint32_t	version;
+	uint32_t	num_stages;
+	uint64_t	file_size;
+	/** CLOCK_MONOTONIC time when the segment was created. */
+	uint64_t	start_ns;
+	pid_t		pid;
+	uint32_t	max_slots;
+	/** Number of initialized slots, only grows. Load it with acquire semantics. */
+	volatile uint32_t	num_slots;
+	uint8_t		reserved[4];
+
+	/** Offset of each slot from the beginning of this data structure. */
+	uint64_t	slot_offsets[SPDK_LATENCY_SHM_MAX_SLOTS];
+
+	uint8_t		data[0];
+};
+
+static inline const char *
+spdk_latency_shm_stage_name(enum spdk_latency_shm_stage stage)
+{
+	switch (stage) {
+	case SPDK_LATENCY_SHM_STAGE_TARGET:
+		return "target";
+	case SPDK_LATENCY_SHM_STAGE_BDEV:
+		return "bdev";
+	case SPDK_LATENCY_SHM_STAGE_DRIVER:
+		return "driver";
+	default:
+		return "unknown";
+	}
+}
+
+static inline struct spdk_latency_shm_slot *
+spdk_latency_shm_get_slot(const struct spdk_latency_shm_file *file, uint32_t index)
+{
+	if (index >= file->max_slots || file->slot_offsets[index] == 0) {
+		return NULL;
+	}
+
+	return (struct spdk_latency_shm_slot *)(((char *)file) + file->slot_offsets[index]);
+}
+
+static inline uint32_t
+spdk_latency_shm_bucket(uint64_t ns)
+{
+	uint32_t bucket;
+
+	if (ns < 2) {
+		return 0;
+	}
+
+	bucket = 63 - __builtin_clzll(ns);
+	return bucket < SPDK_LATENCY_SHM_NUM_BUCKETS ? bucket : SPDK_LATENCY_SHM_NUM_BUCKETS - 1;
+}
+
+/**
+ * Create the latency shm segment and map it.
+ *
+ * \param shm_name Name of the segment, e.g. "/spdk_tgt_latency.1234".
+ *
+ * \return 0 on success, negative errno otherwise.
+ */
+int spdk_latency_shm_init(const char *shm_name);
+
+/**
+ * Unmap and unlink the latency shm segment.
+ */
+void spdk_latency_shm_fini(void);
+
+/**
+ * Get the name of the latency shm segment, or NULL if it's not initialized.
+ */
+const char *spdk_latency_shm_get_name(void);
+
+/**
+ * Get the mapped latency shm segment of this process, or NULL if it's not
+ * initialized. Lets in-process consumers sample it like an external reader.
+ */
+const struct spdk_latency_shm_file *spdk_latency_shm_get_file(void);
+
+/**
+ * Record one completed IO for the given stage in the calling thread's slot.
+ * The first call on a thread claims a slot; if none is left the sample is dropped.
+ *
+ * \param stage Stage the latency belongs to.
+ * \param latency_ns Latency of the IO in nanoseconds.
+ */
+void spdk_latency_shm_record(enum spdk_latency_shm_stage stage, uint64_t latency_ns);
+
+/**
+ * Take a consistent copy of one slot.
+ *
+ * \param file Mapped latency shm file.
+ * \param index Slot index.
+ * \param out Copy of the slot.
+ *
+ * \return 0 on success, -ENOENT if the slot is not claimed, -EAGAIN if the
+ * writer kept updating it while we tried to copy.
+ */
+static inline int
+spdk_latency_shm_read_slot(const struct spdk_latency_shm_file *file, uint32_t index,
+			   struct spdk_latency_shm_slot *out)
+{
+	struct spdk_latency_shm_slot *slot;
+	uint64_t seq;
+	int retries;
+
+	slot = spdk_latency_shm_get_slot(file, index);
+	if (slot == NULL) {
+		return -ENOENT;
+	}
+
+	for (retries = 0; retries < 1000; retries++) {
+		seq = slot->seq;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			continue;
+		}
+		memcpy(out, slot, sizeof(*out));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (slot->seq == seq) {
+			return 0;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPDK_LATENCY_SHM_H */
@@ -312,8 +312,22 @@ struct spdk_nvme_ctrlr_opts {
 	 * the spdk_nvmf_dhchap_dhgroup values.
 	 */
 	uint32_t dhchap_dhgroups;
+
+	/**
+	 * Reuse the namespace data of a fabrics controller across a reconnect.
+	 *
+	 * When set, the Identify Controller data returned after a reconnect is
+	 * compared with the data seen before the reset. If it is unchanged (except
+	 * for CNTLID), the active namespace list and the per-namespace identify
+	 * commands are skipped and the cached namespaces are reused. The upper layer
+	 * is responsible for rescanning namespaces if the target may change them
+	 * without changing its controller data.
+	 *
+	 * Default is `false`.
+	 */
+	bool fast_reconnect;
 };
-SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_ctrlr_opts) == 856, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_ctrlr_opts) == 864, "Incorrect size");
 
 /**
  * NVMe acceleration operation callback.
@@ -582,6 +596,37 @@ struct spdk_nvme_pcie_stat {
 	uint64_t sq_shadow_doorbell_updates;
 };
 
+/*
+ * TSC cycles spent by the TCP transport in each stage of the I/O path. Each
+ * stage excludes the stages nested in it, e.g. completion does not include the
+ * submission done from the completion callback, so the stages add up. Only
+ * counted if spdk_nvme_transport_opts.tcp_cycle_stats is set.
+ */
+struct spdk_nvme_tcp_cycles {
+	/* Building command and H2C data PDUs */
+	uint64_t pdu_build;
+	/* Header and data digests computed or checked on the CPU */
+	uint64_t digest;
+	/* Handing PDUs to the socket and flushes issued by the driver. The flush done
+	 * by spdk_sock_group_poll() for the whole group is not included.
+	 */
+	uint64_t sock_write;
+	/* Reading PDU headers and payloads from the socket */
+	uint64_t sock_read;
+	/* Handling received PDUs */
+	uint64_t pdu_parse;
+	/* Completion callbacks of the upper layer */
+	uint64_t completion;
+};
+
+struct spdk_nvme_tcp_qpair_stat {
+	struct spdk_nvme_qpair *qpair;
+	uint16_t qid;
+	uint64_t submitted_ios;
+	uint64_t completed_ios;
+	struct spdk_nvme_tcp_cycles cycles;
+};
+
 struct spdk_nvme_tcp_stat {
 	uint64_t polls;
 	uint64_t idle_polls;
@@ -589,6 +634,19 @@ struct spdk_nvme_tcp_stat {
 	uint64_t nvme_completions;
 	uint64_t submitted_requests;
 	uint64_t queued_requests;
+	/* NVMe commands submitted; submitted_requests counts PDUs */
+	uint64_t submitted_ios;
+	uint64_t submit_batches;
+	/* Socket flushes that had PDUs to send, by the driver or by sock group polls */
+	uint64_t sock_flushes;
+	/* Host to controller transfers sent in-capsule, or waiting for an R2T */
+	uint64_t in_capsule_writes;
+	uint64_t r2t_writes;
+	/* Cycles of all qpairs that are or were in the poll group */
+	struct spdk_nvme_tcp_cycles cycles;
+	/* Filled in by spdk_nvme_poll_group_get_stats() only */
+	uint32_t num_qpairs;
+	struct spdk_nvme_tcp_qpair_stat *qpair_stats;
 };
 
 struct spdk_nvme_transport_poll_group_stat {
@@ -1446,6 +1504,27 @@ bool spdk_nvme_ctrlr_is_feature_supported(struct spdk_nvme_ctrlr *ctrlr, uint8_t
  */
 typedef void (*spdk_nvme_cmd_cb)(void *ctx, const struct spdk_nvme_cpl *cpl);
 
+/**
+ * Completion handed to a spdk_nvme_cmd_batch_cb.
+ */
+struct spdk_nvme_cpl_batch_entry {
+	/** Callback context provided when the command was submitted. */
+	void			*cb_arg;
+
+	/** Completion queue entry that contains the completion status. */
+	struct spdk_nvme_cpl	cpl;
+};
+
+/**
+ * Signature for callback function invoked with a batch of completed commands.
+ *
+ * \param ctx Context passed to spdk_nvme_qpair_set_batch_cb().
+ * \param entries Completed commands. The array is only valid until the callback returns.
+ * \param num_entries Number of entries in the array.
+ */
+typedef void (*spdk_nvme_cmd_batch_cb)(void *ctx, struct spdk_nvme_cpl_batch_entry *entries,
+				       uint32_t num_entries);
+
 /**
  * Signature for callback function invoked when an asynchronous event request
  * command is completed.
@@ -1662,8 +1741,19 @@ struct spdk_nvme_io_qpair_opts {
 	 */
 	bool async_mode;
 
-	/* Hole at bytes 66-71. */
-	uint8_t reserved66[6];
+	/**
+	 * Adapt completion polling to the load of this qpair. Calls to
+	 * spdk_nvme_qpair_process_completions() that are not expected to find any
+	 * completion, because nothing is outstanding or because completions have
+	 * been arriving less often than the qpair is polled, return 0 without
+	 * touching the completion queue, and each poll reaps at most 16 to 64
+	 * completions depending on the observed completion rate. An idle qpair is
+	 * still polled once every 64 calls. Default is false.
+	 */
+	bool adaptive_polling;
+
+	/* Hole at bytes 67-71. */
+	uint8_t reserved67[5];
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_io_qpair_opts) == 72, "Incorrect size");
 
@@ -2004,6 +2094,60 @@ void spdk_nvme_qpair_set_abort_dnr(struct spdk_nvme_qpair *qpair, bool dnr);
  */
 bool spdk_nvme_qpair_is_connected(struct spdk_nvme_qpair *qpair);
 
+/**
+ * Start a submission batch on the given qpair.
+ *
+ * Commands submitted until spdk_nvme_qpair_submit_batch_end() is called may be
+ * held by the transport and sent to the controller together when the batch ends:
+ * PCIe rings the submission queue tail doorbell once, RDMA posts all send work
+ * requests with one ibv_post_send() and TCP flushes all PDUs with one socket flush.
+ * Batches do not nest, and completions must not be processed on the qpair while
+ * a batch is open.
+ *
+ * \param qpair Queue pair to start the batch on.
+ *
+ * \return 0 on success, -EINVAL if a batch is already open on this qpair.
+ */
+int spdk_nvme_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair);
+
+/**
+ * End the submission batch opened by spdk_nvme_qpair_submit_batch_begin() and
+ * send all commands held by the transport.
+ *
+ * \param qpair Queue pair to end the batch on.
+ *
+ * \return 0 on success, -EINVAL if no batch is open on this qpair, or a negated
+ * errno if the transport failed to send the commands. In the latter case the qpair
+ * is failed and the commands are completed with an error status.
+ */
+int spdk_nvme_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair);
+
+/**
+ * Deliver completions on the given qpair in batches.
+ *
+ * While completions are processed on the qpair, either by
+ * spdk_nvme_qpair_process_completions() or by
+ * spdk_nvme_poll_group_process_completions() on the poll group it belongs to,
+ * commands that were submitted with cb_fn as their completion callback do not
+ * call cb_fn. Their callback context and completion are collected instead and
+ * batch_fn is called once at the end of the poll with all of them, or earlier
+ * if a large number of completions piles up. Commands completed outside of a
+ * poll, e.g. aborted while the qpair is destroyed, still call cb_fn directly.
+ *
+ * This function must not be called from within batch_fn.
+ *
+ * \param qpair I/O queue pair to enable batched completions on.
+ * \param cb_fn Completion callback of the commands to batch.
+ * \param batch_fn Function to call with a batch of completions, or NULL to go back
+ * to calling cb_fn for each command.
+ * \param ctx Context passed to batch_fn.
+ *
+ * \return 0 on success, -EINVAL for the admin qpair or if cb_fn is NULL, -EBUSY if
+ * called from within batch_fn, -ENOMEM if the batch could not be allocated.
+ */
+int spdk_nvme_qpair_set_batch_cb(struct spdk_nvme_qpair *qpair, spdk_nvme_cmd_cb cb_fn,
+				 spdk_nvme_cmd_batch_cb batch_fn, void *ctx);
+
 /**
  * Send the given admin command to the NVMe controller.
  *
@@ -2054,6 +2198,22 @@ int spdk_nvme_ctrlr_cmd_admin_raw(struct spdk_nvme_ctrlr *ctrlr,
  */
 int32_t spdk_nvme_ctrlr_process_admin_completions(struct spdk_nvme_ctrlr *ctrlr);
 
+/**
+ * Get an event file descriptor for I/O messages of external producers.
+ *
+ * External producers such as CUSE pass their I/O to the controller through
+ * messages that spdk_nvme_ctrlr_process_admin_completions() executes. After
+ * this call producers signal the returned eventfd when a message arrives at an
+ * idle controller, so the caller can sleep on it instead of polling. The
+ * descriptor is owned by the controller and stays valid until the last
+ * producer unregisters.
+ *
+ * \param ctrlr Opaque handle to NVMe controller.
+ *
+ * \return file descriptor on success, -ENXIO if no external producer is registered.
+ */
+int spdk_nvme_ctrlr_get_io_msg_fd(struct spdk_nvme_ctrlr *ctrlr);
+
 
 /**
  * Opaque handle to a namespace. Obtained by calling spdk_nvme_ctrlr_get_ns().
@@ -2697,6 +2857,46 @@ void *spdk_nvme_ctrlr_map_pmr(struct spdk_nvme_ctrlr *ctrlr, size_t *size);
  */
 int spdk_nvme_ctrlr_unmap_pmr(struct spdk_nvme_ctrlr *ctrlr);
 
+/**
+ * Device memory regions that I/O buffers can be allocated from.
+ */
+enum spdk_nvme_dev_mem_type {
+	/** Controller Memory Buffer */
+	SPDK_NVME_DEV_MEM_CMB	= 0,
+	/** Persistent Memory Region */
+	SPDK_NVME_DEV_MEM_PMR	= 1,
+};
+
+/**
+ * Allocate an I/O buffer in the memory of the controller.
+ *
+ * The region is mapped (and for the PMR enabled) on the first allocation and
+ * unmapped again when the last buffer is freed, so it can't be used with
+ * spdk_nvme_ctrlr_map_cmb() or spdk_nvme_ctrlr_map_pmr() at the same time. The
+ * CMB can't be used if the submission queues are placed in it.
+ *
+ * Data written to such a buffer doesn't have to be fetched from host memory by
+ * the controller it belongs to. Other controllers can only use it if peer to
+ * peer DMA between the devices is possible.
+ *
+ * \param ctrlr Controller that contains the memory.
+ * \param type Region to allocate from.
+ * \param size Size of the buffer in bytes. Buffers are 4 KiB aligned.
+ *
+ * \return Pointer to the buffer, or NULL if the region is not available or
+ * doesn't have enough free space.
+ */
+void *spdk_nvme_ctrlr_alloc_dev_mem(struct spdk_nvme_ctrlr *ctrlr,
+				    enum spdk_nvme_dev_mem_type type, size_t size);
+
+/**
+ * Free an I/O buffer allocated by spdk_nvme_ctrlr_alloc_dev_mem().
+ *
+ * \param ctrlr Controller the buffer was allocated from.
+ * \param buf Buffer to free, may be NULL.
+ */
+void spdk_nvme_ctrlr_free_dev_mem(struct spdk_nvme_ctrlr *ctrlr, void *buf);
+
 /**
  * Get the transport ID for a given NVMe controller.
  *
@@ -3280,6 +3480,136 @@ int spdk_nvme_ns_cmd_writev_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair
 				spdk_nvme_req_next_sge_cb next_sge_fn,
 				struct spdk_nvme_ns_cmd_ext_io_opts *opts);
 
+/** Maximum number of destinations of spdk_nvme_ns_cmd_writev_multi(). */
+#define SPDK_NVME_MULTI_WRITE_MAX_TARGETS	8
+
+/**
+ * One destination of spdk_nvme_ns_cmd_writev_multi().
+ */
+struct spdk_nvme_ns_cmd_multi_target {
+	struct spdk_nvme_ns	*ns;
+	struct spdk_nvme_qpair	*qpair;
+};
+
+/**
+ * Submit the same write I/O to several namespaces, e.g. the replicas of a
+ * replicated volume.
+ *
+ * The payload descriptor and the command are built once and shared by the
+ * requests sent to each target. All namespaces must have the same format.
+ * All qpairs must be used by the calling thread only.
+ *
+ * cb_fn is called once: when quorum targets completed the write successfully,
+ * or as soon as the quorum can't be reached anymore. In the latter case it gets
+ * the completion of the last failed target. Targets whose submission fails count
+ * as failed, so cb_fn may be called before this function returns.
+ *
+ * \param targets Array of (namespace, qpair) destinations.
+ * \param num_targets Number of entries in targets, at most SPDK_NVME_MULTI_WRITE_MAX_TARGETS.
+ * \param quorum Number of targets that have to succeed, 0 means all of them.
+ * \param lba Starting LBA to write the data.
+ * \param lba_count Length (in sectors) for the write operation.
+ * \param iov Payload. Must stay valid until release_fn is called, or until cb_fn
+ * is called if quorum covers all targets.
+ * \param iovcnt Number of entries in iov.
+ * \param metadata Separate metadata buffer, or NULL.
+ * \param cb_fn Callback function to invoke when the quorum is decided.
+ * \param release_fn Callback function to invoke once every target completed, after
+ * cb_fn. Required when quorum is less than num_targets, ignored otherwise.
+ * \param cb_arg Argument to pass to cb_fn and release_fn.
+ * \param io_flags Set flags, defined by the SPDK_NVME_IO_FLAGS_* entries in
+ * spdk/nvme_spec.h, for this I/O.
+ *
+ * \return 0 if the write was submitted to at least one target, negated errnos on
+ * the following error conditions (no callback is invoked then):
+ * -EINVAL: The request is malformed.
+ * -ENOMEM: The request cannot be allocated.
+ * -ENXIO: The qpairs are failed at the transport level.
+ */
+int spdk_nvme_ns_cmd_writev_multi(const struct spdk_nvme_ns_cmd_multi_target *targets,
+				  uint32_t num_targets, uint32_t quorum,
+				  uint64_t lba, uint32_t lba_count,
+				  struct iovec *iov, int iovcnt, void *metadata,
+				  spdk_nvme_cmd_cb cb_fn, spdk_nvme_cmd_cb release_fn, void *cb_arg,
+				  uint32_t io_flags);
+
+/**
+ * Opaque handle of a precomputed read/write command, see spdk_nvme_ns_io_template_create().
+ */
+struct spdk_nvme_ns_io_template;
+
+/**
+ * Create an I/O template for reads and writes of a fixed size.
+ *
+ * The size checks, split decisions and command setup that spdk_nvme_ns_cmd_read()
+ * and spdk_nvme_ns_cmd_write() do for every I/O are done once here. Submitting
+ * through the template only fills in the LBA, the buffer and the callback.
+ *
+ * The template is only valid as long as the namespace is not reformatted or
+ * removed.
+ *
+ * \param ns Namespace the I/O is submitted to.
+ * \param lba_count Length (in sectors) of every I/O.
+ * \param io_flags Set flags, defined by the SPDK_NVME_IO_FLAGS_* entries in
+ * spdk/nvme_spec.h, for every I/O.
+ *
+ * \return the template, or NULL if the flags are invalid, an I/O of this size
+ * always has to be split by the driver, or memory can't be allocated.
+ */
+struct spdk_nvme_ns_io_template *spdk_nvme_ns_io_template_create(struct spdk_nvme_ns *ns,
+		uint32_t lba_count, uint32_t io_flags);
+
+/**
+ * Free an I/O template.
+ *
+ * \param tmpl Template to free, may be NULL. I/O submitted through it may still be outstanding.
+ */
+void spdk_nvme_ns_io_template_free(struct spdk_nvme_ns_io_template *tmpl);
+
+/**
+ * Submit a read I/O built from an I/O template.
+ *
+ * An I/O that crosses a stripe boundary of the controller is still split, it
+ * takes the generic path then.
+ *
+ * \param tmpl Template created by spdk_nvme_ns_io_template_create().
+ * \param qpair I/O queue pair to submit the request.
+ * \param buffer Physically contiguous virtual address pointer for the data.
+ * \param metadata Virtual address pointer to the separate metadata buffer, or NULL.
+ * \param lba Starting LBA to read the data.
+ * \param cb_fn Callback function to invoke when the I/O is completed.
+ * \param cb_arg Argument to pass to the callback function.
+ *
+ * \return 0 if successfully submitted, negated errnos on the following error conditions:
+ * -ENOMEM: The request cannot be allocated.
+ * -ENXIO: The qpair is failed at the transport level.
+ */
+int spdk_nvme_ns_cmd_read_template(struct spdk_nvme_ns_io_template *tmpl,
+				   struct spdk_nvme_qpair *qpair, void *buffer, void *metadata,
+				   uint64_t lba, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a write I/O built from an I/O template.
+ *
+ * An I/O that crosses a stripe boundary of the controller is still split, it
+ * takes the generic path then.
+ *
+ * \param tmpl Template created by spdk_nvme_ns_io_template_create().
+ * \param qpair I/O queue pair to submit the request.
+ * \param buffer Physically contiguous virtual address pointer for the data.
+ * \param metadata Virtual address pointer to the separate metadata buffer, or NULL.
+ * \param lba Starting LBA to write the data.
+ * \param cb_fn Callback function to invoke when the I/O is completed.
+ * \param cb_arg Argument to pass to the callback function.
+ *
+ * \return 0 if successfully submitted, negated errnos on the following error conditions:
+ * -ENOMEM: The request cannot be allocated.
+ * -ENXIO: The qpair is failed at the transport level.
+ */
+int spdk_nvme_ns_cmd_write_template(struct spdk_nvme_ns_io_template *tmpl,
+				    struct spdk_nvme_qpair *qpair, void *buffer, void *metadata,
+				    uint64_t lba, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+
 /**
  * Submit a write I/O to the specified NVMe namespace.
  *
@@ -4397,6 +4727,10 @@ struct spdk_nvme_transport_ops {
 	int (*ctrlr_ready)(struct spdk_nvme_ctrlr *ctrlr);
 
 	volatile struct spdk_nvme_registers *(*ctrlr_get_registers)(struct spdk_nvme_ctrlr *ctrlr);
+
+	void (*qpair_submit_batch_begin)(struct spdk_nvme_qpair *qpair);
+
+	int (*qpair_submit_batch_end)(struct spdk_nvme_qpair *qpair);
 };
 
 /**
@@ -4453,6 +4787,15 @@ struct spdk_nvme_transport_opts {
 	 * RDMA CM event timeout in milliseconds.
 	 */
 	uint16_t rdma_cm_event_timeout_ms;
+
+	/**
+	 * It is used for TCP transport.
+	 *
+	 * Account the CPU cycles of each qpair per stage of the I/O path, see
+	 * spdk_nvme_tcp_cycles. It takes effect for qpairs created afterwards and
+	 * is disabled by default, as it reads the TSC several times per I/O.
+	 */
+	bool tcp_cycle_stats;
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_transport_opts) == 24, "Incorrect size");
 
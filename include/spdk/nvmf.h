@@ -669,6 +669,53 @@ int spdk_nvmf_subsystem_disconnect_host(struct spdk_nvmf_subsystem *subsystem,
 					spdk_nvmf_tgt_subsystem_listen_done_fn cb_fn,
 					void *cb_arg);
 
+/** Weight used for hosts without an explicit QoS configuration */
+#define SPDK_NVMF_HOST_QOS_DEFAULT_WEIGHT	1
+
+struct spdk_nvmf_host_qos_opts {
+	/**
+	 * Share of the transport data buffers relative to other connections when they
+	 * contend for them. Applies to each IO queue pair of the host.
+	 */
+	uint32_t	weight;
+	/** Read/write IOs per second allowed for the host across all its IO queue pairs, 0 is unlimited */
+	uint64_t	rw_ios_per_sec;
+	/** Read/write megabytes per second allowed for the host, 0 is unlimited */
+	uint64_t	rw_mbytes_per_sec;
+};
+
+/**
+ * Set the QoS parameters of a host connecting to the given subsystem.
+ *
+ * The parameters are applied when a request is admitted by the transport, before a
+ * data buffer is allocated for it: requests of IO queue pairs contending for buffers
+ * are served in weighted fair order and requests of a host that is over its rate
+ * limits are held until the next timeslice. Controllers that are already connected
+ * pick up the new values right away. The host doesn't have to be in the list of
+ * allowed hosts.
+ *
+ * \param subsystem Subsystem to operate on.
+ * \param hostnqn The NQN for the host.
+ * \param opts QoS parameters. Passing NULL or weight 0 with no limits removes the
+ * host's configuration.
+ *
+ * \return 0 on success, or negated errno value on failure.
+ */
+int spdk_nvmf_subsystem_set_host_qos(struct spdk_nvmf_subsystem *subsystem, const char *hostnqn,
+				     const struct spdk_nvmf_host_qos_opts *opts);
+
+/**
+ * Get the QoS parameters configured for a host of the given subsystem.
+ *
+ * \param subsystem Subsystem to query.
+ * \param hostnqn The NQN for the host.
+ * \param opts Filled with the host's QoS parameters.
+ *
+ * \return 0 on success, -ENOENT if the host has no QoS configuration.
+ */
+int spdk_nvmf_subsystem_get_host_qos(struct spdk_nvmf_subsystem *subsystem, const char *hostnqn,
+				     struct spdk_nvmf_host_qos_opts *opts);
+
 /**
  * Set whether a subsystem should allow any host or only hosts in the allowed list.
  *
@@ -1333,6 +1380,75 @@ spdk_nvme_transport_type_t spdk_nvmf_get_transport_type(struct spdk_nvmf_transpo
  */
 const char *spdk_nvmf_get_transport_name(struct spdk_nvmf_transport *transport);
 
+/**
+ * Policy used to assign the new qpairs of a transport to poll groups.
+ */
+enum spdk_nvmf_qpair_placement {
+	/** Let the transport decide, round-robin if it has no preference. */
+	SPDK_NVMF_QPAIR_PLACEMENT_TRANSPORT = 0,
+
+	/** Poll group with the fewest outstanding IOs, then the fewest qpairs. */
+	SPDK_NVMF_QPAIR_PLACEMENT_LEAST_LOADED,
+
+	/**
+	 * Spread the qpairs of each host over consecutive poll groups, starting
+	 * at a poll group chosen by a hash of the host. The host NQN only arrives
+	 * with the CONNECT command, after the qpair was placed, so hosts are told
+	 * apart by their transport address.
+	 */
+	SPDK_NVMF_QPAIR_PLACEMENT_HOST,
+
+	/**
+	 * Place all qpairs that reach a namespace's bdev on one poll group chosen
+	 * by a hash of the bdev name, so the bdev is always accessed through the
+	 * same bdev channel on the same core. The subsystem is found by the
+	 * listener the qpair connected to. If several subsystems share that
+	 * listener, the qpair is placed round-robin.
+	 */
+	SPDK_NVMF_QPAIR_PLACEMENT_BDEV,
+};
+
+/**
+ * Set the qpair placement policy of a transport. Affects qpairs that connect
+ * after the call.
+ *
+ * \param transport The transport to update.
+ * \param placement The new policy.
+ *
+ * \return 0 on success, -EINVAL if the policy is unknown.
+ */
+int spdk_nvmf_transport_set_qpair_placement(struct spdk_nvmf_transport *transport,
+		enum spdk_nvmf_qpair_placement placement);
+
+/**
+ * Get the qpair placement policy of a transport.
+ *
+ * \param transport The transport to query.
+ *
+ * \return the placement policy.
+ */
+enum spdk_nvmf_qpair_placement spdk_nvmf_transport_get_qpair_placement(
+	struct spdk_nvmf_transport *transport);
+
+/**
+ * Get the name of a qpair placement policy.
+ *
+ * \param placement The policy.
+ *
+ * \return the name, or NULL if the policy is unknown.
+ */
+const char *spdk_nvmf_qpair_placement_str(enum spdk_nvmf_qpair_placement placement);
+
+/**
+ * Parse a qpair placement policy name.
+ *
+ * \param str Name of the policy: "transport", "least_loaded", "host" or "bdev".
+ * \param placement Parsed policy.
+ *
+ * \return 0 on success, -EINVAL if the name is unknown.
+ */
+int spdk_nvmf_qpair_placement_parse(const char *str, enum spdk_nvmf_qpair_placement *placement);
+
 /**
  * Function to be called once transport add is complete
  *
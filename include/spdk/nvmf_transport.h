@@ -89,7 +89,8 @@ struct spdk_nvmf_request {
 			uint8_t data_from_pool		: 1;
 			uint8_t dif_enabled		: 1;
 			uint8_t first_fused		: 1;
-			uint8_t rsvd			: 5;
+			uint8_t qos_held		: 1;
+			uint8_t rsvd			: 4;
 		};
 	};
 	uint8_t				zcopy_phase; /* type enum spdk_nvmf_zcopy_phase */
@@ -121,8 +122,11 @@ struct spdk_nvmf_request {
 
 	/* Timeout tracked for connect and abort flows. */
 	uint64_t timeout_tsc;
+
+	/* Virtual start time used to order the pending_buf_queue */
+	uint64_t qos_tag;
 };
-SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_request) == 776, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_request) == 784, "Incorrect size");
 
 enum spdk_nvmf_qpair_state {
 	SPDK_NVMF_QPAIR_UNINITIALIZED = 0,
@@ -168,20 +172,29 @@ struct spdk_nvmf_qpair {
 	uint16_t				queue_depth;
 
 	struct spdk_nvmf_qpair_auth		*auth;
+
+	/* Virtual finish time of the last request queued for a data buffer */
+	uint64_t				qos_finish_tag;
 };
 
 struct spdk_nvmf_transport_poll_group {
 	struct spdk_nvmf_transport					*transport;
 	/* Requests that are waiting to obtain a data buffer */
 	STAILQ_HEAD(, spdk_nvmf_request)				pending_buf_queue;
+	/* Virtual time of the pending_buf_queue, i.e. the tag of the last request served */
+	uint64_t							qos_vtime;
 	struct spdk_iobuf_channel					*buf_cache;
 	struct spdk_nvmf_poll_group					*group;
+	/* Set through spdk_nvmf_transport_poll_group_set_idle() */
+	bool								idle;
 	TAILQ_ENTRY(spdk_nvmf_transport_poll_group)			link;
 };
 
 struct spdk_nvmf_poll_group {
 	struct spdk_thread				*thread;
+	/* NULL while polling is paused or all transport poll groups are idle */
 	struct spdk_poller				*poller;
+	bool						polling_paused;
 
 	TAILQ_HEAD(, spdk_nvmf_transport_poll_group)	tgroups;
 
@@ -201,6 +214,11 @@ struct spdk_nvmf_poll_group {
 	/* Statistics */
 	struct spdk_nvmf_poll_group_stat		stat;
 
+	/* IOs submitted to namespaces and not completed yet. Only updated on the
+	 * poll group thread, read without locking by the qpair placement.
+	 */
+	uint32_t					outstanding_io;
+
 	spdk_nvmf_poll_group_destroy_done_fn		destroy_cb_fn;
 	void						*destroy_cb_arg;
 
@@ -250,6 +268,8 @@ struct spdk_nvmf_transport {
 	TAILQ_ENTRY(spdk_nvmf_transport)	link;
 
 	pthread_mutex_t				mutex;
+
+	enum spdk_nvmf_qpair_placement		qpair_placement;
 };
 
 typedef void (*spdk_nvmf_transport_qpair_fini_cb)(void *cb_arg);
@@ -529,6 +549,20 @@ spdk_nvmf_request_using_zcopy(const struct spdk_nvmf_request *req)
 	return req->zcopy_phase != NVMF_ZCOPY_PHASE_NONE;
 }
 
+/**
+ * Mark a transport poll group as idle or busy.
+ *
+ * Once all transport poll groups of a poll group are idle, the poll group stops
+ * polling them, so that its thread can sleep in interrupt mode. An idle transport
+ * poll group has to poll itself, e.g. from a timed poller, and mark itself busy
+ * again when it sees work. Transport poll groups start busy.
+ *
+ * \param tgroup The transport poll group.
+ * \param idle Whether the transport poll group is idle.
+ */
+void spdk_nvmf_transport_poll_group_set_idle(struct spdk_nvmf_transport_poll_group *tgroup,
+		bool idle);
+
 /**
  * Remove the given qpair from the poll group.
  *
@@ -1195,7 +1195,6 @@ typedef void (*spdk_iobuf_get_stats_cb)(struct spdk_iobuf_module_stats *modules,
 					uint32_t num_modules, void *cb_arg);
 
 #ifdef TARGET_LATENCY_LOG
-void latency_log_1s(union sigval sv);
 void init_log_fn();
 void fini_log_fn();
 #endif
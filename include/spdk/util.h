@@ -36,12 +36,20 @@ struct latency_module_log{
 	struct latency_log_ctx driver;
 };
 
-extern struct latency_module_log module_log;
-
-extern pthread_mutex_t log_mutex;
+enum latency_module_type {
+	LATENCY_MODULE_TARGET = 0,
+	LATENCY_MODULE_BDEV,
+	LATENCY_MODULE_DRIVER,
+};
 
 extern bool is_io_log;
 
+/* Add the latency since start_time to the calling thread's slot, lock-free. */
+void latency_module_log_record(enum latency_module_type module, const struct timespec *start_time);
+
+/* Sum what all threads recorded since the previous call. Single collector thread only. */
+bool latency_module_log_collect(struct latency_module_log *log);
+
 void write_log_to_file(const char* module, struct timespec latency_time, uint32_t iops);
 
 void write_latency_log(void* ctx);
@@ -69,8 +77,6 @@ struct latency_log_msg{
 	struct latency_ns_log* latency_log_namespaces;
 };
 
-extern struct latency_log_msg latency_msg;
-
 void write_log_tasks_to_file(int i, uint32_t task_queue_io_num, struct timespec task_queue_latency, uint32_t task_complete_io_num, struct timespec task_complete_latency,
 							uint32_t req_send_io_num, struct timespec req_send_latency, uint32_t req_complete_io_num, struct timespec req_complete_latency,
 							uint32_t wr_send_io_num, struct timespec wr_send_latency, uint32_t wr_complete_io_num, struct timespec wr_complete_latency,
@@ -81,7 +87,13 @@ void write_latency_tasks_log(void *ctx, char **g_ns_name, uint32_t g_rep_num, ui
 /* 检查 msg queue 消息个数 */
 int check_msg_qnum(int msgid);
 
-extern pthread_mutex_t log_mutex;
+/*
+ * Get the calling thread's per-namespace totals for updating. Must be paired with
+ * latency_ns_log_end(), no lock is taken.
+ */
+struct latency_ns_log *latency_ns_log_begin();
+
+void latency_ns_log_end();
 
 extern uint32_t namespace_num;
 
@@ -89,7 +101,11 @@ extern int msgid;
 
 extern bool is_prob_finish;
 
-void latency_log_1s(union sigval sv);
+/* Collect all thread slots and queue the result on msgid. Collector thread only. */
+void latency_log_collect();
+
+/* Call latency_log_collect() if a second passed since the last collection. */
+void latency_log_poll();
 
 void init_log_fn();
 
@@ -7259,14 +7259,7 @@ bdev_io_complete(void *ctx)
 	tsc = spdk_get_ticks();
 	tsc_diff = tsc - bdev_io->internal.submit_tsc;
 	#ifdef TARGET_LATENCY_LOG
-    pthread_mutex_lock(&log_mutex);
-	struct timespec end_time;
-	struct timespec sub_time;
-	clock_gettime(CLOCK_REALTIME, &end_time);
-	timespec_sub(&sub_time, &end_time, &bdev_io->start_time);
-	timespec_add(&(module_log.bdev.latency_time), &(module_log.bdev.latency_time), &sub_time);
-	module_log.bdev.io_num++;
-    pthread_mutex_unlock(&log_mutex);
+	latency_module_log_record(LATENCY_MODULE_BDEV, &bdev_io->start_time);
 	#endif
 
 	bdev_ch_remove_from_io_submitted(bdev_io);
@@ -974,6 +974,7 @@ nvme_ctrlr_opts_init(struct spdk_nvme_ctrlr_opts *opts,
 	SET_FIELD(dhchap_ctrlr_key);
 	SET_FIELD(dhchap_digests);
 	SET_FIELD(dhchap_dhgroups);
+	SET_FIELD(fast_reconnect);
 
 #undef FIELD_OK
 #undef SET_FIELD
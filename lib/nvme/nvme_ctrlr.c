@@ -24,6 +24,8 @@ static int nvme_ctrlr_identify_id_desc_async(struct spdk_nvme_ns *ns);
 static void nvme_ctrlr_init_cap(struct spdk_nvme_ctrlr *ctrlr);
 static void nvme_ctrlr_set_state(struct spdk_nvme_ctrlr *ctrlr, enum nvme_ctrlr_state state,
 				 uint64_t timeout_in_ms);
+static void nvme_ctrlr_dev_mem_free_region(struct spdk_nvme_ctrlr *ctrlr,
+		enum spdk_nvme_dev_mem_type type, bool unmap);
 
 static int
 nvme_ns_cmp(struct spdk_nvme_ns *ns1, struct spdk_nvme_ns *ns2)
@@ -247,6 +249,7 @@ spdk_nvme_ctrlr_get_default_ctrlr_opts(struct spdk_nvme_ctrlr_opts *opts, size_t
 		  SPDK_BIT(SPDK_NVMF_DHCHAP_DHGROUP_4096) |
 		  SPDK_BIT(SPDK_NVMF_DHCHAP_DHGROUP_6144) |
 		  SPDK_BIT(SPDK_NVMF_DHCHAP_DHGROUP_8192));
+	SET_FIELD(fast_reconnect, false);
 
 	if (FIELD_OK(psk)) {
 		memset(opts->psk, 0, sizeof(opts->psk));
@@ -368,6 +371,10 @@ spdk_nvme_ctrlr_get_default_io_qpair_opts(struct spdk_nvme_ctrlr *ctrlr,
 		opts->async_mode = false;
 	}
 
+	if (FIELD_OK(adaptive_polling)) {
+		opts->adaptive_polling = false;
+	}
+
 #undef FIELD_OK
 }
 
@@ -415,6 +422,8 @@ nvme_ctrlr_create_io_qpair(struct spdk_nvme_ctrlr *ctrlr,
 		return NULL;
 	}
 
+	qpair->adaptive_polling = opts->adaptive_polling;
+
 	TAILQ_INSERT_TAIL(&ctrlr->active_io_qpairs, qpair, tailq);
 
 	nvme_ctrlr_proc_add_io_qpair(qpair);
@@ -1702,6 +1711,19 @@ spdk_nvme_ctrlr_reconnect_async(struct spdk_nvme_ctrlr *ctrlr)
 	nvme_ctrlr_lock(ctrlr);
 
 	ctrlr->prepare_for_reset = false;
+	ctrlr->reuse_ns_data = false;
+
+	if (ctrlr->opts.fast_reconnect && spdk_nvme_ctrlr_is_fabrics(ctrlr) &&
+	    ctrlr->active_ns_count != 0 && ctrlr->reconnect_cdata == NULL) {
+		/* Keep the controller data of the last successful initialization so
+		 * that the Identify Controller issued by the init process can tell
+		 * whether the target changed. It is kept until a reconnect succeeds.
+		 */
+		ctrlr->reconnect_cdata = malloc(sizeof(*ctrlr->reconnect_cdata));
+		if (ctrlr->reconnect_cdata != NULL) {
+			memcpy(ctrlr->reconnect_cdata, &ctrlr->cdata, sizeof(ctrlr->cdata));
+		}
+	}
 
 	/* Set the state back to INIT to cause a full hardware reset. */
 	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_INIT, NVME_TIMEOUT_INFINITE);
@@ -1800,6 +1822,9 @@ spdk_nvme_ctrlr_reconnect_poll_async(struct spdk_nvme_ctrlr *ctrlr)
 
 	if (rc) {
 		nvme_ctrlr_fail(ctrlr, false);
+	} else {
+		free(ctrlr->reconnect_cdata);
+		ctrlr->reconnect_cdata = NULL;
 	}
 	ctrlr->is_resetting = false;
 
@@ -2035,6 +2060,15 @@ nvme_ctrlr_identify_done(void *arg, const struct spdk_nvme_cpl *cpl)
 		ctrlr->flags |= SPDK_NVME_CTRLR_COMPARE_AND_WRITE_SUPPORTED;
 	}
 
+	if (ctrlr->reconnect_cdata != NULL) {
+		/* CNTLID is allocated per association, ignore it in the comparison. */
+		ctrlr->reconnect_cdata->cntlid = ctrlr->cdata.cntlid;
+		ctrlr->reuse_ns_data = memcmp(ctrlr->reconnect_cdata, &ctrlr->cdata,
+					      sizeof(ctrlr->cdata)) == 0;
+		NVME_CTRLR_DEBUGLOG(ctrlr, "controller data %s across reconnect\n",
+				    ctrlr->reuse_ns_data ? "unchanged" : "changed");
+	}
+
 	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_CONFIGURE_AER,
 			     ctrlr->opts.admin_timeout_ms);
 }
@@ -2839,6 +2873,17 @@ nvme_ctrlr_set_num_queues_done(void *arg, const struct spdk_nvme_cpl *cpl)
 		spdk_nvme_ctrlr_free_qid(ctrlr, i);
 	}
 
+	if (ctrlr->reuse_ns_data) {
+		/* The target did not change across the reconnect. Keep the namespaces
+		 * identified before the reset and only refresh the log pages, which
+		 * also picks up the current ANA states.
+		 */
+		ctrlr->reuse_ns_data = false;
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+				     ctrlr->opts.admin_timeout_ms);
+		return;
+	}
+
 	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_ACTIVE_NS,
 			     ctrlr->opts.admin_timeout_ms);
 }
@@ -4288,6 +4333,13 @@ nvme_ctrlr_destruct_poll_async(struct spdk_nvme_ctrlr *ctrlr,
 	ctrlr->copied_ana_desc = NULL;
 	ctrlr->ana_log_page_size = 0;
 
+	free(ctrlr->reconnect_cdata);
+	ctrlr->reconnect_cdata = NULL;
+
+	/* The BARs are unmapped by the transport */
+	nvme_ctrlr_dev_mem_free_region(ctrlr, SPDK_NVME_DEV_MEM_CMB, false);
+	nvme_ctrlr_dev_mem_free_region(ctrlr, SPDK_NVME_DEV_MEM_PMR, false);
+
 	nvme_transport_ctrlr_destruct(ctrlr);
 
 	return rc;
@@ -5046,6 +5098,180 @@ spdk_nvme_ctrlr_unmap_pmr(struct spdk_nvme_ctrlr *ctrlr)
 	return rc;
 }
 
+static void
+nvme_ctrlr_dev_mem_free_region(struct spdk_nvme_ctrlr *ctrlr, enum spdk_nvme_dev_mem_type type,
+			       bool unmap)
+{
+	struct nvme_dev_mem *mem = ctrlr->dev_mem[type];
+
+	if (mem == NULL) {
+		return;
+	}
+
+	if (unmap) {
+		if (type == SPDK_NVME_DEV_MEM_CMB) {
+			nvme_transport_ctrlr_unmap_cmb(ctrlr);
+		} else {
+			nvme_transport_ctrlr_unmap_pmr(ctrlr);
+			nvme_transport_ctrlr_disable_pmr(ctrlr);
+		}
+	}
+
+	spdk_bit_array_free(&mem->used_chunks);
+	free(mem->buf_chunks);
+	free(mem);
+	ctrlr->dev_mem[type] = NULL;
+}
+
+static struct nvme_dev_mem *
+nvme_ctrlr_dev_mem_map_region(struct spdk_nvme_ctrlr *ctrlr, enum spdk_nvme_dev_mem_type type)
+{
+	struct nvme_dev_mem *mem;
+	size_t size = 0;
+	void *addr;
+
+	if (type == SPDK_NVME_DEV_MEM_CMB) {
+		addr = nvme_transport_ctrlr_map_cmb(ctrlr, &size);
+	} else {
+		if (nvme_transport_ctrlr_enable_pmr(ctrlr) != 0) {
+			return NULL;
+		}
+
+		addr = nvme_transport_ctrlr_map_pmr(ctrlr, &size);
+		if (addr == NULL) {
+			nvme_transport_ctrlr_disable_pmr(ctrlr);
+		}
+	}
+
+	if (addr == NULL) {
+		NVME_CTRLR_DEBUGLOG(ctrlr, "%s not available for I/O buffers\n",
+				    type == SPDK_NVME_DEV_MEM_CMB ? "CMB" : "PMR");
+		return NULL;
+	}
+
+	mem = calloc(1, sizeof(*mem));
+	if (mem == NULL) {
+		goto err;
+	}
+
+	ctrlr->dev_mem[type] = mem;
+	mem->addr = addr;
+	mem->num_chunks = size / NVME_DEV_MEM_CHUNK_SIZE;
+	mem->used_chunks = spdk_bit_array_create(mem->num_chunks);
+	mem->buf_chunks = calloc(mem->num_chunks, sizeof(*mem->buf_chunks));
+	if (mem->used_chunks == NULL || mem->buf_chunks == NULL) {
+		nvme_ctrlr_dev_mem_free_region(ctrlr, type, true);
+		return NULL;
+	}
+
+	return mem;
+err:
+	if (type == SPDK_NVME_DEV_MEM_CMB) {
+		nvme_transport_ctrlr_unmap_cmb(ctrlr);
+	} else {
+		nvme_transport_ctrlr_unmap_pmr(ctrlr);
+		nvme_transport_ctrlr_disable_pmr(ctrlr);
+	}
+
+	return NULL;
+}
+
+void *
+spdk_nvme_ctrlr_alloc_dev_mem(struct spdk_nvme_ctrlr *ctrlr, enum spdk_nvme_dev_mem_type type,
+			      size_t size)
+{
+	struct nvme_dev_mem *mem;
+	uint32_t num_chunks, first, i;
+	void *buf = NULL;
+
+	if (size == 0 || type > SPDK_NVME_DEV_MEM_PMR) {
+		return NULL;
+	}
+
+	num_chunks = SPDK_CEIL_DIV(size, NVME_DEV_MEM_CHUNK_SIZE);
+
+	nvme_ctrlr_lock(ctrlr);
+
+	mem = ctrlr->dev_mem[type];
+	if (mem == NULL) {
+		mem = nvme_ctrlr_dev_mem_map_region(ctrlr, type);
+		if (mem == NULL) {
+			goto out;
+		}
+	}
+
+	/* First fit, these buffers are allocated once at setup time */
+	first = spdk_bit_array_find_first_clear(mem->used_chunks, 0);
+	while (first != UINT32_MAX && first + num_chunks <= mem->num_chunks) {
+		for (i = 1; i < num_chunks; i++) {
+			if (spdk_bit_array_get(mem->used_chunks, first + i)) {
+				break;
+			}
+		}
+
+		if (i == num_chunks) {
+			for (i = 0; i < num_chunks; i++) {
+				spdk_bit_array_set(mem->used_chunks, first + i);
+			}
+			mem->buf_chunks[first] = num_chunks;
+			mem->num_bufs++;
+			buf = mem->addr + (uint64_t)first * NVME_DEV_MEM_CHUNK_SIZE;
+			break;
+		}
+
+		first = spdk_bit_array_find_first_clear(mem->used_chunks, first + i);
+	}
+
+	if (buf == NULL && mem->num_bufs == 0) {
+		nvme_ctrlr_dev_mem_free_region(ctrlr, type, true);
+	}
+out:
+	nvme_ctrlr_unlock(ctrlr);
+
+	return buf;
+}
+
+void
+spdk_nvme_ctrlr_free_dev_mem(struct spdk_nvme_ctrlr *ctrlr, void *buf)
+{
+	struct nvme_dev_mem *mem;
+	uint32_t type, first, i;
+
+	if (buf == NULL) {
+		return;
+	}
+
+	nvme_ctrlr_lock(ctrlr);
+
+	for (type = 0; type < SPDK_COUNTOF(ctrlr->dev_mem); type++) {
+		mem = ctrlr->dev_mem[type];
+		if (mem == NULL || (uint8_t *)buf < mem->addr ||
+		    (uint8_t *)buf >= mem->addr + (uint64_t)mem->num_chunks * NVME_DEV_MEM_CHUNK_SIZE) {
+			continue;
+		}
+
+		first = ((uint8_t *)buf - mem->addr) / NVME_DEV_MEM_CHUNK_SIZE;
+		if (mem->buf_chunks[first] == 0) {
+			break;
+		}
+
+		for (i = 0; i < mem->buf_chunks[first]; i++) {
+			spdk_bit_array_clear(mem->used_chunks, first + i);
+		}
+		mem->buf_chunks[first] = 0;
+
+		if (--mem->num_bufs == 0) {
+			nvme_ctrlr_dev_mem_free_region(ctrlr, type, true);
+		}
+
+		nvme_ctrlr_unlock(ctrlr);
+		return;
+	}
+
+	nvme_ctrlr_unlock(ctrlr);
+	NVME_CTRLR_ERRLOG(ctrlr, "%p is not a device memory buffer\n", buf);
+}
+
 int
 spdk_nvme_ctrlr_read_boot_partition_start(struct spdk_nvme_ctrlr *ctrlr, void *payload,
 		uint32_t bprsz, uint32_t bprof, uint32_t bpid)
@@ -271,12 +271,16 @@ struct nvme_error_cmd {
 };
   
 struct nvme_request {
+	/*
+	 * The members up to NVME_REQUEST_COLD_START form the hot part of the
+	 *  request: everything the submit and completion paths touch for a
+	 *  plain, unsplit I/O.  They are kept within the first three cache
+	 *  lines (the command itself fills the first one).  Do not add
+	 *  members here unless every I/O needs them.
+	 */
+
 	// cmd.cid 与 rdma_req 绑定
 	struct spdk_nvme_cmd		cmd;
-	#ifdef TARGET_LATENCY_LOG
-	struct timespec start_time;
-	#endif
-	uint32_t io_id;
 
 	uint8_t				retries;
 
@@ -301,40 +305,28 @@ struct nvme_request {
 	uint32_t			payload_offset;
 	uint32_t			md_offset;
 
-	uint32_t			payload_size;
-
-	/**
-	 * Timeout ticks for error injection requests, can be extended in future
-	 * to support per-request timeout feature.
-	 */
-	uint64_t			timeout_tsc;
+	uint32_t io_id;
 
-	/**
-	 * Data payload for this request's command.
+	/*
+	 * Everything above payload_size is zeroed by nvme_request_clear(),
+	 *  the remaining hot members are set by NVME_INIT_REQUEST().
 	 */
-	struct nvme_payload		payload;
+	uint32_t			payload_size;
+	uint32_t			md_size;
 
 	spdk_nvme_cmd_cb		cb_fn;
 	void				*cb_arg;
-	STAILQ_ENTRY(nvme_request)	stailq;
 
 	struct spdk_nvme_qpair		*qpair;
+	STAILQ_ENTRY(nvme_request)	stailq;
 
-	#ifdef PERF_LATENCY_LOG
-	// 统计性能涉及 id
-	uint32_t ns_id;
-	// 统计性能涉及计算时间
-	// 提交 nvme req 的时间
-    struct timespec req_submit_time;
-	// 完成 nvme req 的时间
-	struct timespec req_complete_time;
-	// 提交 wr 的时间
-	struct timespec wr_send_time;
-	// 提交 wr 完成的时间
-	struct timespec wr_send_complete_time;
-    // wr 完成的时间
-    struct timespec wr_recv_time;
-	#endif
+	/** Sequence of accel operations associated with this request */
+	void				*accel_sequence;
+
+	/**
+	 * Data payload for this request's command.
+	 */
+	struct nvme_payload		payload;
 
 	/*
 	 * The value of spdk_get_ticks() when the request was submitted to the hardware.
@@ -347,20 +339,26 @@ struct nvme_request {
 	 *  list based on the saved pid to tell which process it belongs
 	 *  to. The cpl saves the original completion information which
 	 *  is used in the completion callback.
-	 * NOTE: these below two fields are only used for admin request.
+	 * NOTE: pid is only checked for admin requests, cpl is in the
+	 *  cold part below.
 	 */
 	pid_t				pid;
-	struct spdk_nvme_cpl		cpl;
 
-	uint32_t			md_size;
+	/**
+	 * The following members form the cold part of the request.  They
+	 *  are only needed for admin requests, error injection, splitting,
+	 *  user-copy requests and latency logging, and the driver is careful
+	 *  to not touch them until one of those is needed, to avoid touching
+	 *  an extra cacheline.  Nothing here is cleared by nvme_request_clear().
+	 */
 
 	/**
-	 * The following members should not be reordered with members
-	 *  above.  These members are only needed when splitting
-	 *  requests which is done rarely, and the driver is careful
-	 *  to not touch the following fields until a split operation is
-	 *  needed, to avoid touching an extra cacheline.
+	 * Timeout ticks for error injection requests, can be extended in future
+	 * to support per-request timeout feature.
 	 */
+	uint64_t			timeout_tsc;
+
+	struct spdk_nvme_cpl		cpl;
 
 	/**
 	 * Points to the outstanding child requests for a parent request.
@@ -397,10 +395,31 @@ struct nvme_request {
 	void				*user_cb_arg;
 	void				*user_buffer;
 
-	/** Sequence of accel operations associated with this request */
-	void				*accel_sequence;
+	#ifdef TARGET_LATENCY_LOG
+	struct timespec start_time;
+	#endif
+
+	#ifdef PERF_LATENCY_LOG
+	// 统计性能涉及 id
+	uint32_t ns_id;
+	// 统计性能涉及计算时间
+	// 提交 nvme req 的时间
+    struct timespec req_submit_time;
+	// 完成 nvme req 的时间
+	struct timespec req_complete_time;
+	// 提交 wr 的时间
+	struct timespec wr_send_time;
+	// 提交 wr 完成的时间
+	struct timespec wr_send_complete_time;
+    // wr 完成的时间
+    struct timespec wr_recv_time;
+	#endif
 };
 
+#define NVME_REQUEST_COLD_START	offsetof(struct nvme_request, timeout_tsc)
+SPDK_STATIC_ASSERT(NVME_REQUEST_COLD_START <= 3 * 64,
+		   "nvme_request hot part does not fit in three cache lines");
+
 struct nvme_completion_poll_status {
 	struct spdk_nvme_cpl	cpl;
 	uint64_t		timeout_tsc;
@@ -472,6 +491,26 @@ struct nvme_auth {
 	uint8_t				challenge[NVME_AUTH_DIGEST_MAX_SIZE];
 };
 
+#define NVME_QPAIR_CPL_BATCH_SIZE	128
+
+/* Adaptive completion polling, see spdk_nvme_io_qpair_opts::adaptive_polling */
+#define NVME_ADAPTIVE_POLL_MIN_CHUNK	16
+#define NVME_ADAPTIVE_POLL_MAX_CHUNK	64
+#define NVME_ADAPTIVE_POLL_MAX_SKIP	32
+#define NVME_ADAPTIVE_POLL_IDLE_INTERVAL	64
+
+struct nvme_qpair_cpl_batch {
+	spdk_nvme_cmd_cb			cb_fn;
+	spdk_nvme_cmd_batch_cb			batch_fn;
+	void					*ctx;
+	uint32_t				num_entries;
+
+	/* batch_fn is running, completions go straight to cb_fn meanwhile */
+	bool					flushing;
+
+	struct spdk_nvme_cpl_batch_entry	entries[NVME_QPAIR_CPL_BATCH_SIZE];
+};
+
 struct spdk_nvme_qpair {
 	struct spdk_nvme_ctrlr			*ctrlr;
 
@@ -508,6 +547,12 @@ struct spdk_nvme_qpair {
 	/* The user is destroying qpair */
 	uint8_t					destroy_in_progress: 1;
 
+	/* A submission batch is open, see spdk_nvme_qpair_submit_batch_begin() */
+	uint8_t					in_submit_batch: 1;
+
+	/* See spdk_nvme_io_qpair_opts::adaptive_polling */
+	uint8_t					adaptive_polling: 1;
+
 	/* Number of IO outstanding at transport level */
 	uint16_t				queue_depth;
 
@@ -537,6 +582,16 @@ struct spdk_nvme_qpair {
 
 	const struct spdk_nvme_transport	*transport;
 
+	/* Completions collected for spdk_nvme_qpair_set_batch_cb(), NULL if not enabled */
+	struct nvme_qpair_cpl_batch		*cpl_batch;
+
+	/* Adaptive polling state, only used if adaptive_polling is set */
+	uint16_t				poll_skip;
+	uint16_t				poll_calls;
+	/* EWMAs in 1/16 units of calls between polls that reaped completions and of completions per such poll */
+	uint16_t				poll_gap;
+	uint16_t				poll_rate;
+
 	/* Entries below here are not touched in the main I/O path. */
 
 	struct nvme_completion_poll_status	*poll_status;
@@ -943,6 +998,28 @@ struct nvme_register_completion {
 	pid_t					pid;
 };
 
+/* Allocation unit of spdk_nvme_ctrlr_alloc_dev_mem() */
+#define NVME_DEV_MEM_CHUNK_SIZE		0x1000
+
+struct nvme_dev_mem {
+	uint8_t				*addr;
+	uint32_t			num_chunks;
+	uint32_t			num_bufs;
+	struct spdk_bit_array		*used_chunks;
+	/* Number of chunks of the buffer that starts at a given chunk */
+	uint32_t			*buf_chunks;
+};
+
+/* Producer threads that get an external I/O message ring of their own, later
+ * ones share the MP/SC ring.
+ */
+#define NVME_IO_MSG_MAX_RINGS		64
+
+struct nvme_io_msg_ring {
+	pthread_t			thread;
+	struct spdk_ring		*ring;
+};
+
 struct spdk_nvme_ctrlr {
 	/* Hot data (accessed in I/O path) starts here. */
 
@@ -1064,6 +1141,14 @@ struct spdk_nvme_ctrlr {
 	struct spdk_nvme_qpair		*external_io_msgs_qpair;
 	pthread_mutex_t			external_io_msgs_lock;
 	struct spdk_ring		*external_io_msgs;
+	/* SP/SC rings of producer threads, entries below the count are published. */
+	struct nvme_io_msg_ring		*external_io_msg_rings;
+	uint32_t			external_io_msg_num_rings;
+	uint32_t			external_io_msg_next_ring;
+	/* Signalled on the first message after processing if wakeup is enabled. */
+	int				external_io_msgs_fd;
+	bool				external_io_msgs_wakeup;
+	bool				external_io_msgs_pending;
 
 	STAILQ_HEAD(, nvme_io_msg_producer) io_producers;
 
@@ -1101,6 +1186,14 @@ struct spdk_nvme_ctrlr {
 	uint16_t				auth_tid;
 	/* Authentication sequence number */
 	uint32_t				auth_seqnum;
+
+	/* Identify Controller data saved before a reconnect (opts.fast_reconnect) */
+	struct spdk_nvme_ctrlr_data		*reconnect_cdata;
+	/* The target is unchanged, namespace identify is skipped on this reconnect */
+	bool					reuse_ns_data;
+
+	/* Allocators of spdk_nvme_ctrlr_alloc_dev_mem(), NULL while the region is not mapped */
+	struct nvme_dev_mem			*dev_mem[SPDK_NVME_DEV_MEM_PMR + 1];
 };
 
 struct spdk_nvme_probe_ctx {
@@ -1368,11 +1461,12 @@ nvme_request_clear(struct nvme_request *req)
 	 *  will be initialized appropriately either later in this
 	 *  function, or before they are needed later in the
 	 *  submission patch.  For example, the children
-	 *  TAILQ_ENTRY and following members are
-	 *  only used as part of I/O splitting so we avoid
-	 *  memsetting them until it is actually needed.
-	 *  They will be initialized in nvme_request_add_child()
-	 *  if the request is split.
+	 *  TAILQ_ENTRY and the other members of the cold part
+	 *  are only used as part of I/O splitting, user-copy
+	 *  or admin requests so we avoid memsetting them until
+	 *  it is actually needed.  The split members will be
+	 *  initialized in nvme_request_add_child() if the
+	 *  request is split.
 	 */
 	memset(req, 0, offsetof(struct nvme_request, payload_size));
 }
@@ -1456,6 +1550,35 @@ nvme_free_request(struct nvme_request *req)
 	_nvme_free_request(req, req->qpair);
 }
 
+void nvme_qpair_flush_cpl_batch(struct spdk_nvme_qpair *qpair);
+
+static inline bool
+nvme_qpair_cpl_batch_active(struct spdk_nvme_qpair *qpair)
+{
+	if (qpair->cpl_batch->flushing) {
+		return false;
+	}
+
+	return qpair->in_completion_context ||
+	       (qpair->poll_group != NULL && qpair->poll_group->group->in_process_completions);
+}
+
+static inline void
+nvme_qpair_cpl_batch_add(struct spdk_nvme_qpair *qpair, void *cb_arg,
+			 const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_qpair_cpl_batch *batch = qpair->cpl_batch;
+	struct spdk_nvme_cpl_batch_entry *entry;
+
+	entry = &batch->entries[batch->num_entries++];
+	entry->cb_arg = cb_arg;
+	entry->cpl = *cpl;
+
+	if (spdk_unlikely(batch->num_entries == NVME_QPAIR_CPL_BATCH_SIZE)) {
+		nvme_qpair_flush_cpl_batch(qpair);
+	}
+}
+
 static inline void
 nvme_complete_request(spdk_nvme_cmd_cb cb_fn, void *cb_arg, struct spdk_nvme_qpair *qpair,
 		      struct nvme_request *req, struct spdk_nvme_cpl *cpl)
@@ -1501,30 +1624,30 @@ nvme_complete_request(spdk_nvme_cmd_cb cb_fn, void *cb_arg, struct spdk_nvme_qpa
 	if(is_prob_finish){
 		clock_gettime(CLOCK_REALTIME, &req->req_complete_time);
 
-		pthread_mutex_lock(&log_mutex);
+		struct latency_ns_log *ns_log = latency_ns_log_begin();
 		struct timespec sub_time;
 
 		// req_send_latency = wr_send_time - req_submit_time
 		int judge = timespec_sub(&sub_time, &req->wr_send_time, &req->req_submit_time);
-		timespec_add(&(latency_msg.latency_log_namespaces[req->ns_id].req_send_latency.latency_time), &(latency_msg.latency_log_namespaces[req->ns_id].req_send_latency.latency_time), &sub_time);
-		latency_msg.latency_log_namespaces[req->ns_id].req_send_latency.io_num++;
+		timespec_add(&(ns_log[req->ns_id].req_send_latency.latency_time), &(ns_log[req->ns_id].req_send_latency.latency_time), &sub_time);
+		ns_log[req->ns_id].req_send_latency.io_num++;
 
 		// req_complete_latency = req_complete_time - req_submit_time
 		judge = timespec_sub(&sub_time, &req->req_complete_time, &req->req_submit_time);
-		timespec_add(&(latency_msg.latency_log_namespaces[req->ns_id].req_complete_latency.latency_time), &(latency_msg.latency_log_namespaces[req->ns_id].req_complete_latency.latency_time), &sub_time);
-		latency_msg.latency_log_namespaces[req->ns_id].req_complete_latency.io_num++;
+		timespec_add(&(ns_log[req->ns_id].req_complete_latency.latency_time), &(ns_log[req->ns_id].req_complete_latency.latency_time), &sub_time);
+		ns_log[req->ns_id].req_complete_latency.io_num++;
 
 		// wr_send_latency = wr_send_complete_time - wr_send_time
 		judge = timespec_sub(&sub_time, &req->wr_send_complete_time, &req->wr_send_time);
-		timespec_add(&(latency_msg.latency_log_namespaces[req->ns_id].wr_send_latency.latency_time), &(latency_msg.latency_log_namespaces[req->ns_id].wr_send_latency.latency_time), &sub_time);
-		latency_msg.latency_log_namespaces[req->ns_id].wr_send_latency.io_num++;
+		timespec_add(&(ns_log[req->ns_id].wr_send_latency.latency_time), &(ns_log[req->ns_id].wr_send_latency.latency_time), &sub_time);
+		ns_log[req->ns_id].wr_send_latency.io_num++;
 
 		// wr_complete_latency = wr_recv_time - wr_send_time
 		judge = timespec_sub(&sub_time, &req->wr_recv_time, &req->wr_send_time);
-		timespec_add(&(latency_msg.latency_log_namespaces[req->ns_id].wr_complete_latency.latency_time), &(latency_msg.latency_log_namespaces[req->ns_id].wr_complete_latency.latency_time), &sub_time);
-		latency_msg.latency_log_namespaces[req->ns_id].wr_complete_latency.io_num++;
+		timespec_add(&(ns_log[req->ns_id].wr_complete_latency.latency_time), &(ns_log[req->ns_id].wr_complete_latency.latency_time), &sub_time);
+		ns_log[req->ns_id].wr_complete_latency.io_num++;
 
-		pthread_mutex_unlock(&log_mutex);
+		latency_ns_log_end();
 	}
 	#endif
 
@@ -1535,6 +1658,12 @@ nvme_complete_request(spdk_nvme_cmd_cb cb_fn, void *cb_arg, struct spdk_nvme_qpa
 	 */
 	_nvme_free_request(req, qpair);
 
+	if (spdk_unlikely(qpair->cpl_batch != NULL) && cb_fn == qpair->cpl_batch->cb_fn &&
+	    nvme_qpair_cpl_batch_active(qpair)) {
+		nvme_qpair_cpl_batch_add(qpair, cb_arg, cpl);
+		return;
+	}
+
 	if (spdk_likely(cb_fn)) {
 		cb_fn(cb_arg, cpl);
 	}
@@ -1701,6 +1830,8 @@ int nvme_transport_qpair_reset(struct spdk_nvme_qpair *qpair);
 int nvme_transport_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req);
 int32_t nvme_transport_qpair_process_completions(struct spdk_nvme_qpair *qpair,
 		uint32_t max_completions);
+void nvme_transport_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair);
+int nvme_transport_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair);
 void nvme_transport_admin_qpair_abort_aers(struct spdk_nvme_qpair *qpair);
 int nvme_transport_qpair_iterate_requests(struct spdk_nvme_qpair *qpair,
 		int (*iter_fn)(struct nvme_request *req, void *arg),
@@ -6,7 +6,66 @@
 #include "nvme_internal.h"
 #include "nvme_io_msg.h"
 
-#define SPDK_NVME_MSG_IO_PROCESS_SIZE 8
+#include "spdk/string.h"
+
+/* Messages dequeued from one ring at a time and from all rings per call. */
+#define SPDK_NVME_MSG_IO_PROCESS_SIZE 32
+#define SPDK_NVME_MSG_IO_PROCESS_BUDGET 128
+
+#define NVME_IO_MSG_RING_SIZE 16384
+
+/*
+ * Return the SP/SC ring of the calling thread, creating it on the first send.
+ * Rings are only added while producers are registered, so lookups do not lock.
+ */
+static struct spdk_ring *
+nvme_io_msg_get_thread_ring(struct spdk_nvme_ctrlr *ctrlr)
+{
+	pthread_t self = pthread_self();
+	struct spdk_ring *ring = NULL;
+	uint32_t i, num_rings;
+
+	num_rings = __atomic_load_n(&ctrlr->external_io_msg_num_rings, __ATOMIC_ACQUIRE);
+	for (i = 0; i < num_rings; i++) {
+		if (pthread_equal(ctrlr->external_io_msg_rings[i].thread, self)) {
+			return ctrlr->external_io_msg_rings[i].ring;
+		}
+	}
+
+	pthread_mutex_lock(&ctrlr->external_io_msgs_lock);
+	/* Only the calling thread adds a ring for itself, no need to rescan. */
+	num_rings = ctrlr->external_io_msg_num_rings;
+	if (num_rings < NVME_IO_MSG_MAX_RINGS) {
+		ring = spdk_ring_create(SPDK_RING_TYPE_SP_SC, NVME_IO_MSG_RING_SIZE,
+					SPDK_ENV_SOCKET_ID_ANY);
+		if (ring != NULL) {
+			ctrlr->external_io_msg_rings[num_rings].thread = self;
+			ctrlr->external_io_msg_rings[num_rings].ring = ring;
+			__atomic_store_n(&ctrlr->external_io_msg_num_rings, num_rings + 1,
+					 __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&ctrlr->external_io_msgs_lock);
+
+	return ring;
+}
+
+static inline void
+nvme_io_msg_wakeup(struct spdk_nvme_ctrlr *ctrlr)
+{
+	if (!__atomic_load_n(&ctrlr->external_io_msgs_wakeup, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	/* Only the first message after the last processing signals the eventfd. */
+	if (__atomic_exchange_n(&ctrlr->external_io_msgs_pending, true, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	if (eventfd_write(ctrlr->external_io_msgs_fd, 1) != 0) {
+		SPDK_ERRLOG("eventfd_write failed: (%s).\n", spdk_strerror(errno));
+	}
+}
 
 /**
  * Send message to IO queue.
@@ -17,14 +76,11 @@ nvme_io_msg_send(struct spdk_nvme_ctrlr *ctrlr, uint32_t nsid, spdk_nvme_io_msg_
 {
 	int rc;
 	struct spdk_nvme_io_msg *io;
-
-	/* Protect requests ring against preemptive producers */
-	pthread_mutex_lock(&ctrlr->external_io_msgs_lock);
+	struct spdk_ring *ring;
 
 	io = (struct spdk_nvme_io_msg *)calloc(1, sizeof(struct spdk_nvme_io_msg));
 	if (!io) {
 		SPDK_ERRLOG("IO msg allocation failed.");
-		pthread_mutex_unlock(&ctrlr->external_io_msgs_lock);
 		return -ENOMEM;
 	}
 
@@ -33,26 +89,58 @@ nvme_io_msg_send(struct spdk_nvme_ctrlr *ctrlr, uint32_t nsid, spdk_nvme_io_msg_
 	io->fn = fn;
 	io->arg = arg;
 
+	ring = nvme_io_msg_get_thread_ring(ctrlr);
+	if (spdk_likely(ring != NULL)) {
+		rc = spdk_ring_enqueue(ring, (void **)&io, 1, NULL);
+		if (spdk_likely(rc == 1)) {
+			nvme_io_msg_wakeup(ctrlr);
+			return 0;
+		}
+	}
+
+	/* Out of per thread rings or the ring is full, use the shared one.
+	 * Protect it against preemptive producers.
+	 */
+	pthread_mutex_lock(&ctrlr->external_io_msgs_lock);
 	rc = spdk_ring_enqueue(ctrlr->external_io_msgs, (void **)&io, 1, NULL);
+	pthread_mutex_unlock(&ctrlr->external_io_msgs_lock);
 	if (rc != 1) {
 		assert(false);
 		free(io);
-		pthread_mutex_unlock(&ctrlr->external_io_msgs_lock);
 		return -ENOMEM;
 	}
 
-	pthread_mutex_unlock(&ctrlr->external_io_msgs_lock);
+	nvme_io_msg_wakeup(ctrlr);
 
 	return 0;
 }
 
+static uint32_t
+nvme_io_msg_process_ring(struct spdk_ring *ring, uint32_t max)
+{
+	void *requests[SPDK_NVME_MSG_IO_PROCESS_SIZE];
+	struct spdk_nvme_io_msg *io;
+	size_t i, count;
+
+	count = spdk_ring_dequeue(ring, requests, spdk_min(max, SPDK_NVME_MSG_IO_PROCESS_SIZE));
+	for (i = 0; i < count; i++) {
+		io = requests[i];
+
+		assert(io != NULL);
+
+		io->fn(io->ctrlr, io->nsid, io->arg);
+		free(io);
+	}
+
+	return count;
+}
+
 int
 nvme_io_msg_process(struct spdk_nvme_ctrlr *ctrlr)
 {
-	int i;
-	int count;
-	struct spdk_nvme_io_msg *io;
-	void *requests[SPDK_NVME_MSG_IO_PROCESS_SIZE];
+	uint32_t i, num_rings, start, count = 0;
+	struct nvme_io_msg_ring *rings;
+	eventfd_t val;
 
 	if (!spdk_process_is_primary()) {
 		return 0;
@@ -70,24 +158,50 @@ nvme_io_msg_process(struct spdk_nvme_ctrlr *ctrlr)
 
 	spdk_nvme_qpair_process_completions(ctrlr->external_io_msgs_qpair, 0);
 
-	count = spdk_ring_dequeue(ctrlr->external_io_msgs, requests,
-				  SPDK_NVME_MSG_IO_PROCESS_SIZE);
-	if (count == 0) {
-		return 0;
+	if (__atomic_load_n(&ctrlr->external_io_msgs_wakeup, __ATOMIC_ACQUIRE)) {
+		/* Rearm before draining so that no later message misses the signal. */
+		__atomic_store_n(&ctrlr->external_io_msgs_pending, false, __ATOMIC_SEQ_CST);
+		eventfd_read(ctrlr->external_io_msgs_fd, &val);
 	}
 
-	for (i = 0; i < count; i++) {
-		io = requests[i];
+	/* Rotate the first ring so that busy producers cannot starve the others. */
+	rings = ctrlr->external_io_msg_rings;
+	num_rings = __atomic_load_n(&ctrlr->external_io_msg_num_rings, __ATOMIC_ACQUIRE);
+	start = ctrlr->external_io_msg_next_ring++;
+	for (i = 0; i < num_rings && count < SPDK_NVME_MSG_IO_PROCESS_BUDGET; i++) {
+		count += nvme_io_msg_process_ring(rings[(start + i) % num_rings].ring,
+						  SPDK_NVME_MSG_IO_PROCESS_BUDGET - count);
+	}
 
-		assert(io != NULL);
+	if (count < SPDK_NVME_MSG_IO_PROCESS_BUDGET) {
+		count += nvme_io_msg_process_ring(ctrlr->external_io_msgs,
+						  SPDK_NVME_MSG_IO_PROCESS_BUDGET - count);
+	}
 
-		io->fn(io->ctrlr, io->nsid, io->arg);
-		free(io);
+	if (count == SPDK_NVME_MSG_IO_PROCESS_BUDGET && ctrlr->external_io_msgs_wakeup) {
+		/* Messages may be left behind, make sure the caller comes back. */
+		__atomic_store_n(&ctrlr->external_io_msgs_pending, false, __ATOMIC_SEQ_CST);
+		nvme_io_msg_wakeup(ctrlr);
 	}
 
 	return count;
 }
 
+int
+spdk_nvme_ctrlr_get_io_msg_fd(struct spdk_nvme_ctrlr *ctrlr)
+{
+	int fd = -ENXIO;
+
+	nvme_ctrlr_lock(ctrlr);
+	if (ctrlr->external_io_msgs != NULL) {
+		fd = ctrlr->external_io_msgs_fd;
+		__atomic_store_n(&ctrlr->external_io_msgs_wakeup, true, __ATOMIC_RELEASE);
+	}
+	nvme_ctrlr_unlock(ctrlr);
+
+	return fd;
+}
+
 static bool
 nvme_io_msg_is_producer_registered(struct spdk_nvme_ctrlr *ctrlr,
 				   struct nvme_io_msg_producer *io_msg_producer)
@@ -106,6 +220,8 @@ int
 nvme_io_msg_ctrlr_register(struct spdk_nvme_ctrlr *ctrlr,
 			   struct nvme_io_msg_producer *io_msg_producer)
 {
+	int rc;
+
 	if (io_msg_producer == NULL) {
 		SPDK_ERRLOG("io_msg_producer cannot be NULL\n");
 		return -EINVAL;
@@ -127,13 +243,31 @@ nvme_io_msg_ctrlr_register(struct spdk_nvme_ctrlr *ctrlr,
 	pthread_mutex_init(&ctrlr->external_io_msgs_lock, NULL);
 
 	/**
-	 * Initialize ring and qpair for controller
+	 * Initialize rings, eventfd and qpair for controller
 	 */
+	ctrlr->external_io_msg_rings = calloc(NVME_IO_MSG_MAX_RINGS, sizeof(struct nvme_io_msg_ring));
+	if (!ctrlr->external_io_msg_rings) {
+		SPDK_ERRLOG("Unable to allocate memory for message rings\n");
+		nvme_ctrlr_unlock(ctrlr);
+		return -ENOMEM;
+	}
+	ctrlr->external_io_msg_num_rings = 0;
+	ctrlr->external_io_msg_next_ring = 0;
+
+	ctrlr->external_io_msgs_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ctrlr->external_io_msgs_fd < 0) {
+		rc = -errno;
+		SPDK_ERRLOG("Failed to create eventfd: (%s).\n", spdk_strerror(errno));
+		goto err;
+	}
+	ctrlr->external_io_msgs_wakeup = false;
+	ctrlr->external_io_msgs_pending = false;
+
 	ctrlr->external_io_msgs = spdk_ring_create(SPDK_RING_TYPE_MP_SC, 65536, SPDK_ENV_SOCKET_ID_ANY);
 	if (!ctrlr->external_io_msgs) {
 		SPDK_ERRLOG("Unable to allocate memory for message ring\n");
-		nvme_ctrlr_unlock(ctrlr);
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto err;
 	}
 
 	ctrlr->external_io_msgs_qpair = spdk_nvme_ctrlr_alloc_io_qpair(ctrlr, NULL, 0);
@@ -141,14 +275,24 @@ nvme_io_msg_ctrlr_register(struct spdk_nvme_ctrlr *ctrlr,
 		SPDK_ERRLOG("spdk_nvme_ctrlr_alloc_io_qpair() failed\n");
 		spdk_ring_free(ctrlr->external_io_msgs);
 		ctrlr->external_io_msgs = NULL;
-		nvme_ctrlr_unlock(ctrlr);
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto err;
 	}
 
 	STAILQ_INSERT_TAIL(&ctrlr->io_producers, io_msg_producer, link);
 	nvme_ctrlr_unlock(ctrlr);
 
 	return 0;
+
+err:
+	if (ctrlr->external_io_msgs_fd >= 0) {
+		close(ctrlr->external_io_msgs_fd);
+	}
+	ctrlr->external_io_msgs_fd = -1;
+	free(ctrlr->external_io_msg_rings);
+	ctrlr->external_io_msg_rings = NULL;
+	nvme_ctrlr_unlock(ctrlr);
+	return rc;
 }
 
 void
@@ -173,6 +317,7 @@ void
 nvme_io_msg_ctrlr_detach(struct spdk_nvme_ctrlr *ctrlr)
 {
 	struct nvme_io_msg_producer *io_msg_producer, *tmp;
+	uint32_t i;
 
 	if (!spdk_process_is_primary()) {
 		return;
@@ -189,6 +334,20 @@ nvme_io_msg_ctrlr_detach(struct spdk_nvme_ctrlr *ctrlr)
 		ctrlr->external_io_msgs = NULL;
 	}
 
+	if (ctrlr->external_io_msg_rings) {
+		for (i = 0; i < ctrlr->external_io_msg_num_rings; i++) {
+			spdk_ring_free(ctrlr->external_io_msg_rings[i].ring);
+		}
+		free(ctrlr->external_io_msg_rings);
+		ctrlr->external_io_msg_rings = NULL;
+		ctrlr->external_io_msg_num_rings = 0;
+
+		/* The eventfd only exists while the rings do. */
+		close(ctrlr->external_io_msgs_fd);
+		ctrlr->external_io_msgs_fd = -1;
+		ctrlr->external_io_msgs_wakeup = false;
+	}
+
 	if (ctrlr->external_io_msgs_qpair) {
 		spdk_nvme_ctrlr_free_io_qpair(ctrlr->external_io_msgs_qpair);
 		ctrlr->external_io_msgs_qpair = NULL;
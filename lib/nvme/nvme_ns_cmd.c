@@ -1449,6 +1449,446 @@ spdk_nvme_ns_cmd_writev_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpa
 				   opts, SPDK_NVME_OPC_WRITE);
 }
 
+/*
+ * Command of a fixed size read or write that does not need to be split. Only the
+ * opcode and the LBA dependent dwords are filled in per I/O.
+ */
+struct spdk_nvme_ns_io_template {
+	struct spdk_nvme_cmd		cmd;
+	struct spdk_nvme_ns		*ns;
+	uint32_t			lba_count;
+	uint32_t			io_flags;
+	uint32_t			payload_size;
+	uint32_t			md_size;
+	uint32_t			sectors_per_stripe;
+	/* PI type 1 and 2 check the reference tag against the LBA */
+	bool				lba_in_cdw14;
+};
+
+struct spdk_nvme_ns_io_template *
+spdk_nvme_ns_io_template_create(struct spdk_nvme_ns *ns, uint32_t lba_count, uint32_t io_flags)
+{
+	struct spdk_nvme_ns_io_template *tmpl;
+
+	if (!_is_io_flags_valid(io_flags) || lba_count == 0) {
+		return NULL;
+	}
+
+	if (lba_count > _nvme_get_sectors_per_max_io(ns, io_flags) ||
+	    (ns->sectors_per_stripe > 0 && lba_count > ns->sectors_per_stripe)) {
+		SPDK_ERRLOG("I/O of %u blocks is always split on nsid %u\n", lba_count, ns->id);
+		return NULL;
+	}
+
+	tmpl = calloc(1, sizeof(*tmpl));
+	if (tmpl == NULL) {
+		return NULL;
+	}
+
+	tmpl->ns = ns;
+	tmpl->lba_count = lba_count;
+	tmpl->io_flags = io_flags;
+	tmpl->payload_size = lba_count * _nvme_get_host_buffer_sector_size(ns, io_flags);
+	tmpl->md_size = lba_count * ns->md_size;
+	tmpl->sectors_per_stripe = ns->sectors_per_stripe;
+
+	if (ns->flags & SPDK_NVME_NS_DPS_PI_SUPPORTED) {
+		switch (ns->pi_type) {
+		case SPDK_NVME_FMT_NVM_PROTECTION_TYPE1:
+		case SPDK_NVME_FMT_NVM_PROTECTION_TYPE2:
+			tmpl->lba_in_cdw14 = true;
+			break;
+		}
+	}
+
+	/* Same as _nvme_ns_cmd_setup_request() without apptag and cdw13 */
+	tmpl->cmd.nsid = ns->id;
+	tmpl->cmd.fuse = (io_flags & SPDK_NVME_IO_FLAGS_FUSE_MASK);
+	tmpl->cmd.cdw12 = lba_count - 1;
+	tmpl->cmd.cdw12 |= (io_flags & SPDK_NVME_IO_FLAGS_CDW12_MASK);
+
+	return tmpl;
+}
+
+void
+spdk_nvme_ns_io_template_free(struct spdk_nvme_ns_io_template *tmpl)
+{
+	free(tmpl);
+}
+
+static inline int
+nvme_ns_cmd_rw_template(struct spdk_nvme_ns_io_template *tmpl, struct spdk_nvme_qpair *qpair,
+			void *buffer, void *metadata, uint64_t lba,
+			spdk_nvme_cmd_cb cb_fn, void *cb_arg, uint32_t opc)
+{
+	struct nvme_request *req;
+	struct nvme_payload payload;
+	uint32_t sectors_per_stripe = tmpl->sectors_per_stripe;
+	int rc = 0;
+
+	payload = NVME_PAYLOAD_CONTIG(buffer, metadata);
+
+	if (spdk_unlikely(sectors_per_stripe > 0 &&
+			  ((lba & (sectors_per_stripe - 1)) + tmpl->lba_count) > sectors_per_stripe)) {
+		req = _nvme_ns_cmd_rw(tmpl->ns, qpair, &payload, 0, 0, lba, tmpl->lba_count, cb_fn, cb_arg,
+				      opc, tmpl->io_flags, 0, 0, 0, false, NULL, &rc);
+		if (req == NULL) {
+			return rc;
+		}
+
+		return nvme_qpair_submit_request(qpair, req);
+	}
+
+	req = nvme_allocate_request(qpair, &payload, tmpl->payload_size, tmpl->md_size, cb_fn, cb_arg);
+	if (spdk_unlikely(req == NULL)) {
+		return -ENOMEM;
+	}
+
+	req->cmd = tmpl->cmd;
+	req->cmd.opc = opc;
+	*(uint64_t *)&req->cmd.cdw10 = lba;
+	if (tmpl->lba_in_cdw14) {
+		req->cmd.cdw14 = (uint32_t)lba;
+	}
+
+	return nvme_qpair_submit_request(qpair, req);
+}
+
+int
+spdk_nvme_ns_cmd_read_template(struct spdk_nvme_ns_io_template *tmpl,
+			       struct spdk_nvme_qpair *qpair, void *buffer, void *metadata,
+			       uint64_t lba, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return nvme_ns_cmd_rw_template(tmpl, qpair, buffer, metadata, lba, cb_fn, cb_arg,
+				       SPDK_NVME_OPC_READ);
+}
+
+int
+spdk_nvme_ns_cmd_write_template(struct spdk_nvme_ns_io_template *tmpl,
+				struct spdk_nvme_qpair *qpair, void *buffer, void *metadata,
+				uint64_t lba, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return nvme_ns_cmd_rw_template(tmpl, qpair, buffer, metadata, lba, cb_fn, cb_arg,
+				       SPDK_NVME_OPC_WRITE);
+}
+
+/*
+ * State of one spdk_nvme_ns_cmd_writev_multi() call. The requests of all targets
+ * point at the same payload descriptor, whose SGL cursor lives here. Transports
+ * walk the SGL synchronously while a request is submitted, so a single cursor is
+ * enough.
+ */
+struct nvme_multi_write {
+	spdk_nvme_cmd_cb		cb_fn;
+	spdk_nvme_cmd_cb		release_fn;
+	void				*cb_arg;
+
+	uint16_t			quorum;
+	uint16_t			max_failures;
+	/* Targets in flight, plus one reference held while submitting. */
+	uint16_t			outstanding;
+	uint16_t			succeeded;
+	uint16_t			failed;
+	bool				submitting;
+	bool				decided;
+	/* Last successful and last failed completion. */
+	struct spdk_nvme_cpl		cpl;
+	struct spdk_nvme_cpl		err_cpl;
+
+	struct iovec			*iov;
+	int				iovcnt;
+	int				iovpos;
+	uint32_t			iov_offset;
+
+	struct nvme_multi_write		*next;
+};
+
+#define NVME_MULTI_WRITE_CACHE_SIZE	128
+
+static __thread struct nvme_multi_write *g_multi_write_cache;
+static __thread uint32_t g_multi_write_cache_count;
+
+static struct nvme_multi_write *
+nvme_multi_write_get(void)
+{
+	struct nvme_multi_write *mw = g_multi_write_cache;
+
+	if (mw != NULL) {
+		g_multi_write_cache = mw->next;
+		g_multi_write_cache_count--;
+		return mw;
+	}
+
+	return malloc(sizeof(*mw));
+}
+
+static void
+nvme_multi_write_put(struct nvme_multi_write *mw)
+{
+	if (g_multi_write_cache_count >= NVME_MULTI_WRITE_CACHE_SIZE) {
+		free(mw);
+		return;
+	}
+
+	mw->next = g_multi_write_cache;
+	g_multi_write_cache = mw;
+	g_multi_write_cache_count++;
+}
+
+static void
+nvme_multi_write_reset_sgl(void *ref, uint32_t sgl_offset)
+{
+	struct nvme_multi_write *mw = ref;
+	struct iovec *iov;
+
+	mw->iov_offset = sgl_offset;
+	for (mw->iovpos = 0; mw->iovpos < mw->iovcnt; mw->iovpos++) {
+		iov = &mw->iov[mw->iovpos];
+		if (mw->iov_offset < iov->iov_len) {
+			break;
+		}
+		mw->iov_offset -= iov->iov_len;
+	}
+}
+
+static int
+nvme_multi_write_next_sge(void *ref, void **address, uint32_t *length)
+{
+	struct nvme_multi_write *mw = ref;
+	struct iovec *iov;
+
+	assert(mw->iovpos < mw->iovcnt);
+
+	iov = &mw->iov[mw->iovpos];
+	*address = (uint8_t *)iov->iov_base + mw->iov_offset;
+	*length = iov->iov_len - mw->iov_offset;
+	mw->iovpos++;
+	mw->iov_offset = 0;
+
+	return 0;
+}
+
+static void
+nvme_multi_write_put_ref(struct nvme_multi_write *mw)
+{
+	assert(mw->outstanding > 0);
+	if (--mw->outstanding > 0) {
+		return;
+	}
+
+	if (mw->release_fn != NULL) {
+		mw->release_fn(mw->cb_arg, mw->failed ? &mw->err_cpl : &mw->cpl);
+	}
+	nvme_multi_write_put(mw);
+}
+
+static void
+nvme_multi_write_check_quorum(struct nvme_multi_write *mw)
+{
+	if (mw->decided) {
+		return;
+	}
+
+	if (mw->succeeded >= mw->quorum) {
+		mw->decided = true;
+		mw->cb_fn(mw->cb_arg, &mw->cpl);
+	} else if (mw->failed > mw->max_failures) {
+		mw->decided = true;
+		mw->cb_fn(mw->cb_arg, &mw->err_cpl);
+	}
+}
+
+static void
+nvme_multi_write_done(void *ctx, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_multi_write *mw = ctx;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		mw->failed++;
+		mw->err_cpl = *cpl;
+	} else {
+		mw->succeeded++;
+		mw->cpl = *cpl;
+	}
+
+	/* The quorum is evaluated only once every target was submitted. */
+	if (!mw->submitting) {
+		nvme_multi_write_check_quorum(mw);
+	}
+	nvme_multi_write_put_ref(mw);
+}
+
+/*
+ * A request built for one target can be reused for another one if the command
+ * fields and the payload layout derived from the namespace are identical.
+ */
+static bool
+nvme_multi_write_can_clone(struct spdk_nvme_ns *tmpl, struct spdk_nvme_ns *ns,
+			   uint64_t lba, uint32_t lba_count, uint32_t io_flags)
+{
+	struct spdk_nvme_ctrlr *tctrlr = tmpl->ctrlr, *ctrlr = ns->ctrlr;
+	uint32_t sectors_per_stripe = ns->sectors_per_stripe;
+
+	if ((tmpl->flags & SPDK_NVME_NS_DPS_PI_SUPPORTED) != (ns->flags & SPDK_NVME_NS_DPS_PI_SUPPORTED) ||
+	    tmpl->pi_type != ns->pi_type ||
+	    _nvme_md_excluded_from_xfer(tmpl, io_flags) != _nvme_md_excluded_from_xfer(ns, io_flags)) {
+		return false;
+	}
+
+	if (lba_count > _nvme_get_sectors_per_max_io(ns, io_flags) ||
+	    (sectors_per_stripe > 0 &&
+	     ((lba & (sectors_per_stripe - 1)) + lba_count) > sectors_per_stripe)) {
+		return false;
+	}
+
+	if ((tctrlr->flags & SPDK_NVME_CTRLR_SGL_SUPPORTED) != (ctrlr->flags & SPDK_NVME_CTRLR_SGL_SUPPORTED) ||
+	    ctrlr->max_sges < tctrlr->max_sges || ctrlr->page_size != tctrlr->page_size) {
+		return false;
+	}
+
+	return true;
+}
+
+int
+spdk_nvme_ns_cmd_writev_multi(const struct spdk_nvme_ns_cmd_multi_target *targets,
+			      uint32_t num_targets, uint32_t quorum,
+			      uint64_t lba, uint32_t lba_count,
+			      struct iovec *iov, int iovcnt, void *metadata,
+			      spdk_nvme_cmd_cb cb_fn, spdk_nvme_cmd_cb release_fn, void *cb_arg,
+			      uint32_t io_flags)
+{
+	struct nvme_request *reqs[SPDK_NVME_MULTI_WRITE_MAX_TARGETS];
+	struct nvme_request *tmpl;
+	struct nvme_multi_write *mw;
+	struct nvme_payload payload;
+	struct spdk_nvme_ns *ns;
+	struct spdk_nvme_qpair *qpair;
+	uint32_t i, submitted = 0;
+	int rc = 0, first_rc = 0;
+
+	if (!_is_io_flags_valid(io_flags)) {
+		return -EINVAL;
+	}
+
+	if (num_targets == 0 || num_targets > SPDK_NVME_MULTI_WRITE_MAX_TARGETS ||
+	    quorum > num_targets || iov == NULL || iovcnt <= 0 || cb_fn == NULL) {
+		return -EINVAL;
+	}
+
+	if (quorum == 0) {
+		quorum = num_targets;
+	}
+
+	if (quorum < num_targets && release_fn == NULL) {
+		return -EINVAL;
+	}
+
+	for (i = 1; i < num_targets; i++) {
+		if (targets[i].ns->extended_lba_size != targets[0].ns->extended_lba_size ||
+		    targets[i].ns->md_size != targets[0].ns->md_size) {
+			SPDK_ERRLOG("Namespaces of a multi-target write must have the same format\n");
+			return -EINVAL;
+		}
+	}
+
+	mw = nvme_multi_write_get();
+	if (mw == NULL) {
+		return -ENOMEM;
+	}
+
+	mw->cb_fn = cb_fn;
+	mw->release_fn = quorum < num_targets ? release_fn : NULL;
+	mw->cb_arg = cb_arg;
+	mw->quorum = quorum;
+	mw->max_failures = num_targets - quorum;
+	mw->outstanding = 1;
+	mw->succeeded = 0;
+	mw->failed = 0;
+	mw->submitting = true;
+	mw->decided = false;
+	memset(&mw->cpl, 0, sizeof(mw->cpl));
+	memset(&mw->err_cpl, 0, sizeof(mw->err_cpl));
+	mw->iov = iov;
+	mw->iovcnt = iovcnt;
+	mw->iovpos = 0;
+	mw->iov_offset = 0;
+
+	payload = NVME_PAYLOAD_SGL(nvme_multi_write_reset_sgl, nvme_multi_write_next_sge, mw, metadata);
+
+	/* Build and validate the command once, then reuse it for every target that allows it. */
+	tmpl = _nvme_ns_cmd_rw(targets[0].ns, targets[0].qpair, &payload, 0, 0, lba, lba_count,
+			       nvme_multi_write_done, mw, SPDK_NVME_OPC_WRITE, io_flags, 0, 0, 0,
+			       true, NULL, &rc);
+	if (tmpl == NULL) {
+		rc = nvme_ns_map_failure_rc(lba_count, targets[0].ns->sectors_per_max_io,
+					    targets[0].ns->sectors_per_stripe,
+					    targets[0].qpair->ctrlr->opts.io_queue_requests, rc);
+		nvme_multi_write_put(mw);
+		return rc;
+	}
+	reqs[0] = tmpl;
+
+	for (i = 1; i < num_targets; i++) {
+		ns = targets[i].ns;
+		qpair = targets[i].qpair;
+
+		if (tmpl->num_children == 0 &&
+		    nvme_multi_write_can_clone(targets[0].ns, ns, lba, lba_count, io_flags)) {
+			reqs[i] = nvme_allocate_request(qpair, &payload, tmpl->payload_size, tmpl->md_size,
+							nvme_multi_write_done, mw);
+			if (reqs[i] != NULL) {
+				reqs[i]->cmd = tmpl->cmd;
+				reqs[i]->cmd.nsid = ns->id;
+			} else {
+				rc = -ENOMEM;
+			}
+		} else {
+			reqs[i] = _nvme_ns_cmd_rw(ns, qpair, &payload, 0, 0, lba, lba_count,
+						  nvme_multi_write_done, mw, SPDK_NVME_OPC_WRITE, io_flags,
+						  0, 0, 0, true, NULL, &rc);
+		}
+
+		if (reqs[i] == NULL) {
+			rc = nvme_ns_map_failure_rc(lba_count, ns->sectors_per_max_io, ns->sectors_per_stripe,
+						    qpair->ctrlr->opts.io_queue_requests, rc);
+			while (i-- > 0) {
+				nvme_request_free_children(reqs[i]);
+				nvme_free_request(reqs[i]);
+			}
+			nvme_multi_write_put(mw);
+			return rc;
+		}
+	}
+
+	for (i = 0; i < num_targets; i++) {
+		mw->outstanding++;
+		rc = nvme_qpair_submit_request(targets[i].qpair, reqs[i]);
+		if (spdk_unlikely(rc != 0)) {
+			/* The request was freed without invoking its callback. */
+			mw->outstanding--;
+			mw->failed++;
+			mw->err_cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+			mw->err_cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+			if (first_rc == 0) {
+				first_rc = rc;
+			}
+			continue;
+		}
+		submitted++;
+	}
+
+	if (submitted == 0) {
+		nvme_multi_write_put(mw);
+		return first_rc;
+	}
+
+	mw->submitting = false;
+	nvme_multi_write_check_quorum(mw);
+	nvme_multi_write_put_ref(mw);
+
+	return 0;
+}
+
 int
 spdk_nvme_ns_cmd_write_zeroes(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
 			      uint64_t lba, uint32_t lba_count,
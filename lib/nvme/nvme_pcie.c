@@ -1107,6 +1107,8 @@ const struct spdk_nvme_transport_ops pcie_ops = {
 	.qpair_reset = nvme_pcie_qpair_reset,
 	.qpair_submit_request = nvme_pcie_qpair_submit_request,
 	.qpair_process_completions = nvme_pcie_qpair_process_completions,
+	.qpair_submit_batch_begin = nvme_pcie_qpair_submit_batch_begin,
+	.qpair_submit_batch_end = nvme_pcie_qpair_submit_batch_end,
 	.qpair_iterate_requests = nvme_pcie_qpair_iterate_requests,
 	.admin_qpair_abort_aers = nvme_pcie_admin_qpair_abort_aers,
 
@@ -663,9 +663,39 @@ nvme_pcie_qpair_submit_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracke
 		SPDK_ERRLOG("sq_tail is passing sq_head!\n");
 	}
 
+	if (!pqpair->flags.delay_cmd_submit && !pqpair->flags.in_submit_batch) {
+		nvme_pcie_qpair_ring_sq_doorbell(qpair);
+	}
+}
+
+void
+nvme_pcie_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+
+	pqpair->flags.in_submit_batch = 1;
 	if (!pqpair->flags.delay_cmd_submit) {
+		/* last_sq_tail is only maintained in delayed mode */
+		pqpair->last_sq_tail = pqpair->sq_tail;
+	}
+}
+
+/*
+ * Ring the SQ tail doorbell once for all commands copied to the submission queue
+ * during the batch.
+ */
+int
+nvme_pcie_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+
+	pqpair->flags.in_submit_batch = 0;
+	if (pqpair->last_sq_tail != pqpair->sq_tail) {
 		nvme_pcie_qpair_ring_sq_doorbell(qpair);
+		pqpair->last_sq_tail = pqpair->sq_tail;
 	}
+
+	return 0;
 }
 
 void
@@ -1187,6 +1217,69 @@ nvme_pcie_fail_request_bad_vtophys(struct spdk_nvme_qpair *qpair, struct nvme_tr
 						1 /* do not retry */, true);
 }
 
+/*
+ * Last physically contiguous region translated while building the PRP list of one
+ *  request. It covers at least the rest of the 2 MiB page, so the following pages and
+ *  SGEs that fall into it do not need another spdk_vtophys() lookup.
+ */
+struct nvme_pcie_vtophys_cache {
+	uintptr_t	vaddr;
+	uint64_t	paddr;
+	uint64_t	len;
+};
+
+static inline uint64_t
+nvme_pcie_vtophys_cached(struct spdk_nvme_ctrlr *ctrlr, struct nvme_pcie_vtophys_cache *cache,
+			 const void *buf, uint64_t len, uint64_t *contig_len)
+{
+	uintptr_t vaddr = (uintptr_t)buf;
+	uint64_t paddr, size;
+
+	/* Also false for vaddr below cache->vaddr, the subtraction wraps around */
+	if (vaddr - cache->vaddr < cache->len) {
+		*contig_len = cache->len - (vaddr - cache->vaddr);
+		return cache->paddr + (vaddr - cache->vaddr);
+	}
+
+	/* The memory maps have a 2 MiB granularity, so the rest of the page is translatable */
+	size = spdk_max(len, VALUE_2MB - (vaddr & MASK_2MB));
+	paddr = nvme_pcie_vtophys(ctrlr, buf, &size);
+	if (spdk_unlikely(paddr == SPDK_VTOPHYS_ERROR)) {
+		return SPDK_VTOPHYS_ERROR;
+	}
+
+	cache->vaddr = vaddr;
+	cache->paddr = paddr;
+	cache->len = size;
+	*contig_len = size;
+
+	return paddr;
+}
+
+/*
+ * Fill count PRP entries for physically contiguous pages starting at phys_addr.
+ */
+static inline void
+nvme_pcie_prp_fill(uint64_t *prp, uint64_t phys_addr, uint32_t count, uint32_t page_size)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	__m128i addr = _mm_set_epi64x(phys_addr + page_size, phys_addr);
+	__m128i step = _mm_set1_epi64x(2 * (uint64_t)page_size);
+
+	for (; i + 2 <= count; i += 2) {
+		_mm_storeu_si128((__m128i *)&prp[i], addr);
+		addr = _mm_add_epi64(addr, step);
+	}
+	phys_addr += (uint64_t)i * page_size;
+#endif
+	for (; i < count; i++) {
+		prp[i] = phys_addr;
+		phys_addr += page_size;
+	}
+}
+
 /*
  * Append PRP list entries to describe a virtually contiguous buffer starting at virt_addr of len bytes.
  *
@@ -1194,13 +1287,13 @@ nvme_pcie_fail_request_bad_vtophys(struct spdk_nvme_qpair *qpair, struct nvme_tr
  */
 static inline int
 nvme_pcie_prp_list_append(struct spdk_nvme_ctrlr *ctrlr, struct nvme_tracker *tr,
-			  uint32_t *prp_index, void *virt_addr, size_t len,
-			  uint32_t page_size)
+			  struct nvme_pcie_vtophys_cache *cache, uint32_t *prp_index,
+			  void *virt_addr, size_t len, uint32_t page_size)
 {
 	struct spdk_nvme_cmd *cmd = &tr->req->cmd;
 	uintptr_t page_mask = page_size - 1;
-	uint64_t phys_addr;
-	uint32_t i;
+	uint64_t phys_addr, contig_len;
+	uint32_t i, num_pages;
 
 	SPDK_DEBUGLOG(nvme, "prp_index:%u virt_addr:%p len:%u\n",
 		      *prp_index, virt_addr, (uint32_t)len);
@@ -1223,7 +1316,7 @@ nvme_pcie_prp_list_append(struct spdk_nvme_ctrlr *ctrlr, struct nvme_tracker *tr
 			return -EFAULT;
 		}
 
-		phys_addr = nvme_pcie_vtophys(ctrlr, virt_addr, NULL);
+		phys_addr = nvme_pcie_vtophys_cached(ctrlr, cache, virt_addr, len, &contig_len);
 		if (spdk_unlikely(phys_addr == SPDK_VTOPHYS_ERROR)) {
 			SPDK_ERRLOG("vtophys(%p) failed\n", virt_addr);
 			return -EFAULT;
@@ -1232,22 +1325,29 @@ nvme_pcie_prp_list_append(struct spdk_nvme_ctrlr *ctrlr, struct nvme_tracker *tr
 		if (i == 0) {
 			SPDK_DEBUGLOG(nvme, "prp1 = %p\n", (void *)phys_addr);
 			cmd->dptr.prp.prp1 = phys_addr;
-			seg_len = page_size - ((uintptr_t)virt_addr & page_mask);
+			seg_len = spdk_min(page_size - ((uintptr_t)virt_addr & page_mask), len);
+			num_pages = 1;
 		} else {
 			if ((phys_addr & page_mask) != 0) {
 				SPDK_ERRLOG("PRP %u not page aligned (%p)\n", i, virt_addr);
 				return -EFAULT;
 			}
 
-			SPDK_DEBUGLOG(nvme, "prp[%u] = %p\n", i - 1, (void *)phys_addr);
-			tr->u.prp[i - 1] = phys_addr;
-			seg_len = page_size;
+			/* All pages of the physically contiguous run go into the list at once */
+			seg_len = spdk_min(contig_len, len);
+			num_pages = SPDK_CEIL_DIV(seg_len, page_size);
+			if (spdk_unlikely(i + num_pages - 1 > SPDK_COUNTOF(tr->u.prp))) {
+				SPDK_ERRLOG("out of PRP entries\n");
+				return -EFAULT;
+			}
+
+			SPDK_DEBUGLOG(nvme, "prp[%u..%u] = %p\n", i - 1, i + num_pages - 2, (void *)phys_addr);
+			nvme_pcie_prp_fill(&tr->u.prp[i - 1], phys_addr, num_pages, page_size);
 		}
 
-		seg_len = spdk_min(seg_len, len);
 		virt_addr = (uint8_t *)virt_addr + seg_len;
 		len -= seg_len;
-		i++;
+		i += num_pages;
 	}
 
 	cmd->psdt = SPDK_NVME_PSDT_PRP;
@@ -1281,12 +1381,30 @@ static int
 nvme_pcie_qpair_build_contig_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req,
 				     struct nvme_tracker *tr, bool dword_aligned)
 {
+	struct nvme_pcie_vtophys_cache cache = {};
 	uint32_t prp_index = 0;
+	uint32_t page_size = qpair->ctrlr->page_size;
+	uint8_t *virt_addr = (uint8_t *)req->payload.contig_or_cb_arg + req->payload_offset;
+	uint64_t phys_addr;
 	int rc;
 
-	rc = nvme_pcie_prp_list_append(qpair->ctrlr, tr, &prp_index,
-				       (uint8_t *)req->payload.contig_or_cb_arg + req->payload_offset,
-				       req->payload_size, qpair->ctrlr->page_size);
+	/*
+	 * Most I/O fits in a single page and only needs prp1. Don't pay for the call
+	 * and the translation cache of the PRP list walk in that case.
+	 */
+	if (spdk_likely(req->payload_size != 0 && ((uintptr_t)virt_addr & 3) == 0 &&
+			((uintptr_t)virt_addr & (page_size - 1)) + req->payload_size <= page_size)) {
+		phys_addr = nvme_pcie_vtophys(qpair->ctrlr, virt_addr, NULL);
+		if (spdk_likely(phys_addr != SPDK_VTOPHYS_ERROR)) {
+			req->cmd.psdt = SPDK_NVME_PSDT_PRP;
+			req->cmd.dptr.prp.prp1 = phys_addr;
+			req->cmd.dptr.prp.prp2 = 0;
+			return 0;
+		}
+	}
+
+	rc = nvme_pcie_prp_list_append(qpair->ctrlr, tr, &cache, &prp_index, virt_addr,
+				       req->payload_size, page_size);
 	if (rc) {
 		nvme_pcie_fail_request_bad_vtophys(qpair, tr);
 	}
@@ -1523,6 +1641,7 @@ nvme_pcie_qpair_build_prps_sgl_request(struct spdk_nvme_qpair *qpair, struct nvm
 	uint32_t remaining_transfer_len, length;
 	uint32_t prp_index = 0;
 	uint32_t page_size = qpair->ctrlr->page_size;
+	struct nvme_pcie_vtophys_cache cache = {};
 
 	/*
 	 * Build scattered payloads.
@@ -1551,7 +1670,8 @@ nvme_pcie_qpair_build_prps_sgl_request(struct spdk_nvme_qpair *qpair, struct nvm
 		assert((length == remaining_transfer_len) ||
 		       _is_page_aligned((uintptr_t)virt_addr + length, page_size));
 
-		rc = nvme_pcie_prp_list_append(qpair->ctrlr, tr, &prp_index, virt_addr, length, page_size);
+		rc = nvme_pcie_prp_list_append(qpair->ctrlr, tr, &cache, &prp_index, virt_addr, length,
+					       page_size);
 		if (rc) {
 			nvme_pcie_fail_request_bad_vtophys(qpair, tr);
 			return rc;
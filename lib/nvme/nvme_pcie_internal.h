@@ -162,6 +162,7 @@ struct nvme_pcie_qpair {
 		uint8_t has_shadow_doorbell	: 1;
 		uint8_t has_pending_vtophys_failures : 1;
 		uint8_t defer_destruction	: 1;
+		uint8_t in_submit_batch		: 1;
 	} flags;
 
 	/*
@@ -329,6 +330,8 @@ struct spdk_nvme_qpair *nvme_pcie_ctrlr_create_io_qpair(struct spdk_nvme_ctrlr *
 		const struct spdk_nvme_io_qpair_opts *opts);
 int nvme_pcie_ctrlr_delete_io_qpair(struct spdk_nvme_ctrlr *ctrlr, struct spdk_nvme_qpair *qpair);
 int nvme_pcie_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req);
+void nvme_pcie_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair);
+int nvme_pcie_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair);
 int nvme_pcie_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 				   struct spdk_nvme_transport_poll_group_stat **_stats);
 void nvme_pcie_poll_group_free_stats(struct spdk_nvme_transport_poll_group *tgroup,
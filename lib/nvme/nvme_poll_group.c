@@ -137,6 +137,37 @@ nvme_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair)
 	return nvme_transport_poll_group_disconnect_qpair(qpair);
 }
 
+static void
+nvme_poll_group_flush_cpl_batch(struct spdk_nvme_qpair *qpair)
+{
+	/* Let batch_fn free the qpair the same way a completion callback can */
+	qpair->in_completion_context = 1;
+	nvme_qpair_flush_cpl_batch(qpair);
+	qpair->in_completion_context = 0;
+
+	if (qpair->delete_after_completion_context) {
+		spdk_nvme_ctrlr_free_io_qpair(qpair);
+	}
+}
+
+static void
+nvme_poll_group_flush_cpl_batches(struct spdk_nvme_transport_poll_group *tgroup)
+{
+	struct spdk_nvme_qpair *qpair, *tmp;
+
+	STAILQ_FOREACH_SAFE(qpair, &tgroup->connected_qpairs, poll_group_stailq, tmp) {
+		if (spdk_unlikely(qpair->cpl_batch != NULL && qpair->cpl_batch->num_entries > 0)) {
+			nvme_poll_group_flush_cpl_batch(qpair);
+		}
+	}
+
+	STAILQ_FOREACH_SAFE(qpair, &tgroup->disconnected_qpairs, poll_group_stailq, tmp) {
+		if (spdk_unlikely(qpair->cpl_batch != NULL && qpair->cpl_batch->num_entries > 0)) {
+			nvme_poll_group_flush_cpl_batch(qpair);
+		}
+	}
+}
+
 int64_t
 spdk_nvme_poll_group_process_completions(struct spdk_nvme_poll_group *group,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
@@ -156,6 +187,7 @@ spdk_nvme_poll_group_process_completions(struct spdk_nvme_poll_group *group,
 	STAILQ_FOREACH(tgroup, &group->tgroups, link) {
 		local_completions = nvme_transport_poll_group_process_completions(tgroup, completions_per_qpair,
 				    disconnected_qpair_cb);
+		nvme_poll_group_flush_cpl_batches(tgroup);
 		if (local_completions < 0 && error_reason == 0) {
 			error_reason = local_completions;
 		} else {
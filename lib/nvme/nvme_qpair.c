@@ -756,6 +756,71 @@ nvme_complete_register_operations(struct spdk_nvme_qpair *qpair)
 	}
 }
 
+/*
+ * Returns true if this call to spdk_nvme_qpair_process_completions() is not expected
+ *  to find any completion and can skip polling the transport.
+ */
+static inline bool
+nvme_qpair_adaptive_poll_skip(struct spdk_nvme_qpair *qpair)
+{
+	/* Wraps around after a long idle period, which only shortens one gap sample */
+	qpair->poll_calls++;
+
+	if (nvme_qpair_get_state(qpair) != NVME_QPAIR_ENABLED ||
+	    !STAILQ_EMPTY(&qpair->queued_req) || !STAILQ_EMPTY(&qpair->err_req_head)) {
+		return false;
+	}
+
+	if (qpair->num_outstanding_reqs == 0) {
+		/* Nothing can complete, but keep looking at the queue now and then for transport errors */
+		return qpair->poll_calls % NVME_ADAPTIVE_POLL_IDLE_INTERVAL != 0;
+	}
+
+	if (qpair->poll_skip > 0) {
+		qpair->poll_skip--;
+		return true;
+	}
+
+	return false;
+}
+
+static inline uint32_t
+nvme_qpair_adaptive_poll_chunk(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
+{
+	uint32_t chunk;
+
+	/* Twice the usual number of completions per poll, poll_rate is in 1/16 units */
+	chunk = spdk_max((uint32_t)qpair->poll_rate / 8, NVME_ADAPTIVE_POLL_MIN_CHUNK);
+	chunk = spdk_min(chunk, NVME_ADAPTIVE_POLL_MAX_CHUNK);
+
+	return max_completions == 0 ? chunk : spdk_min(max_completions, chunk);
+}
+
+static inline void
+nvme_qpair_adaptive_poll_update(struct spdk_nvme_qpair *qpair, int32_t ret, uint32_t chunk)
+{
+	uint32_t gap;
+
+	if (ret <= 0) {
+		return;
+	}
+
+	gap = spdk_min(qpair->poll_calls, 2 * NVME_ADAPTIVE_POLL_MAX_SKIP);
+	qpair->poll_gap = (3 * qpair->poll_gap + 16 * gap) / 4;
+	qpair->poll_rate = (3 * qpair->poll_rate + 16 * (uint32_t)ret) / 4;
+	qpair->poll_calls = 0;
+
+	/*
+	 * Completions show up about every poll_gap calls, so skip the first half of the
+	 *  next gap. Do not skip if the chunk was full, there are likely more to reap.
+	 */
+	if ((uint32_t)ret < chunk) {
+		qpair->poll_skip = spdk_min(qpair->poll_gap / 32, NVME_ADAPTIVE_POLL_MAX_SKIP);
+	} else {
+		qpair->poll_skip = 0;
+	}
+}
+
 int32_t
 spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
 {
@@ -787,6 +852,13 @@ spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 		return -ENXIO;
 	}
 
+	if (spdk_unlikely(qpair->adaptive_polling)) {
+		if (nvme_qpair_adaptive_poll_skip(qpair)) {
+			return 0;
+		}
+		max_completions = nvme_qpair_adaptive_poll_chunk(qpair, max_completions);
+	}
+
 	/* error injection for those queued error requests */
 	if (spdk_unlikely(!STAILQ_EMPTY(&qpair->err_req_head))) {
 		STAILQ_FOREACH_SAFE(req, &qpair->err_req_head, stailq, tmp) {
@@ -812,6 +884,13 @@ spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 			}
 		}
 	}
+	if (spdk_unlikely(qpair->adaptive_polling)) {
+		nvme_qpair_adaptive_poll_update(qpair, ret, max_completions);
+	}
+	if (spdk_unlikely(qpair->cpl_batch != NULL)) {
+		/* Still in completion context, so batch_fn can free the qpair safely */
+		nvme_qpair_flush_cpl_batch(qpair);
+	}
 	qpair->in_completion_context = 0;
 	if (qpair->delete_after_completion_context) {
 		/*
@@ -854,6 +933,87 @@ spdk_nvme_qpair_is_connected(struct spdk_nvme_qpair *qpair)
 	       nvme_qpair_get_state(qpair) <= NVME_QPAIR_ENABLED;
 }
 
+int
+spdk_nvme_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair)
+{
+	if (qpair->in_submit_batch) {
+		return -EINVAL;
+	}
+
+	qpair->in_submit_batch = 1;
+	nvme_transport_qpair_submit_batch_begin(qpair);
+
+	return 0;
+}
+
+int
+spdk_nvme_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair)
+{
+	if (!qpair->in_submit_batch) {
+		return -EINVAL;
+	}
+
+	qpair->in_submit_batch = 0;
+
+	return nvme_transport_qpair_submit_batch_end(qpair);
+}
+
+void
+nvme_qpair_flush_cpl_batch(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_qpair_cpl_batch *batch = qpair->cpl_batch;
+	uint32_t num_entries;
+
+	if (batch == NULL || batch->num_entries == 0 || batch->flushing) {
+		return;
+	}
+
+	num_entries = batch->num_entries;
+	batch->num_entries = 0;
+	batch->flushing = true;
+	batch->batch_fn(batch->ctx, batch->entries, num_entries);
+	batch->flushing = false;
+}
+
+int
+spdk_nvme_qpair_set_batch_cb(struct spdk_nvme_qpair *qpair, spdk_nvme_cmd_cb cb_fn,
+			     spdk_nvme_cmd_batch_cb batch_fn, void *ctx)
+{
+	struct nvme_qpair_cpl_batch *batch = qpair->cpl_batch;
+
+	if (nvme_qpair_is_admin_queue(qpair) || (batch_fn != NULL && cb_fn == NULL)) {
+		return -EINVAL;
+	}
+
+	if (batch != NULL) {
+		if (batch->flushing) {
+			return -EBUSY;
+		}
+		nvme_qpair_flush_cpl_batch(qpair);
+	}
+
+	if (batch_fn == NULL) {
+		free(batch);
+		qpair->cpl_batch = NULL;
+		return 0;
+	}
+
+	if (batch == NULL) {
+		batch = calloc(1, sizeof(*batch));
+		if (batch == NULL) {
+			SPDK_ERRLOG("Failed to allocate completion batch for qpair %hu\n", qpair->id);
+			return -ENOMEM;
+		}
+		qpair->cpl_batch = batch;
+	}
+
+	batch->cb_fn = cb_fn;
+	batch->batch_fn = batch_fn;
+	batch->ctx = ctx;
+
+	return 0;
+}
+
 int
 nvme_qpair_init(struct spdk_nvme_qpair *qpair, uint16_t id,
 		struct spdk_nvme_ctrlr *ctrlr,
@@ -876,7 +1036,12 @@ nvme_qpair_init(struct spdk_nvme_qpair *qpair, uint16_t id,
 	qpair->is_new_qpair = true;
 	qpair->async = async;
 	qpair->poll_status = NULL;
+	qpair->cpl_batch = NULL;
 	qpair->num_outstanding_reqs = 0;
+	qpair->poll_skip = 0;
+	qpair->poll_calls = 0;
+	qpair->poll_gap = 0;
+	qpair->poll_rate = 0;
 
 	STAILQ_INIT(&qpair->free_req);
 	STAILQ_INIT(&qpair->queued_req);
@@ -939,6 +1104,10 @@ nvme_qpair_deinit(struct spdk_nvme_qpair *qpair)
 		spdk_free(cmd);
 	}
 
+	nvme_qpair_flush_cpl_batch(qpair);
+	free(qpair->cpl_batch);
+	qpair->cpl_batch = NULL;
+
 	spdk_free(qpair->req_buf);
 }
 
@@ -1098,6 +1267,11 @@ nvme_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *re
 {
 	int rc;
 
+	if (spdk_unlikely(qpair->poll_skip != 0)) {
+		/* Poll again right away, the transport may only ring the doorbell from there */
+		qpair->poll_skip = 0;
+	}
+
     // 不进入
 	if (spdk_unlikely(!STAILQ_EMPTY(&qpair->queued_req) && req->num_children == 0)) {
 		/*
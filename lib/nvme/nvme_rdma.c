@@ -210,6 +210,9 @@ struct nvme_rdma_qpair {
 
 	bool					delay_cmd_submit;
 
+	/* A submission batch is open, send WRs are posted when it ends */
+	bool					in_submit_batch;
+
 	uint32_t				num_completions;
 	uint32_t				num_outstanding_reqs;
 
@@ -2363,7 +2366,7 @@ nvme_rdma_qpair_submit_request(struct spdk_nvme_qpair *qpair,
 
 	spdk_rdma_qp_queue_send_wrs(rqpair->rdma_qp, wr);
 
-	if (!rqpair->delay_cmd_submit) {
+	if (!rqpair->delay_cmd_submit && !rqpair->in_submit_batch) {
 		return nvme_rdma_qpair_submit_sends(rqpair);
 	}
 
@@ -2478,6 +2481,38 @@ nvme_rdma_fail_qpair(struct spdk_nvme_qpair *qpair, int failure_reason)
 	nvme_ctrlr_disconnect_qpair(qpair);
 }
 
+static void
+nvme_rdma_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_rdma_qpair *rqpair = nvme_rdma_qpair(qpair);
+
+	rqpair->in_submit_batch = true;
+}
+
+/*
+ * Post the send WRs queued during the batch with a single ibv_post_send(). In
+ * delayed mode they would otherwise wait for the next completion poll.
+ */
+static int
+nvme_rdma_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_rdma_qpair *rqpair = nvme_rdma_qpair(qpair);
+	int rc;
+
+	rqpair->in_submit_batch = false;
+	if (spdk_unlikely(rqpair->rdma_qp == NULL)) {
+		return 0;
+	}
+
+	rc = nvme_rdma_qpair_submit_sends(rqpair);
+	if (spdk_unlikely(rc)) {
+		nvme_rdma_fail_qpair(qpair, 0);
+		return -rc;
+	}
+
+	return 0;
+}
+
 static struct nvme_rdma_qpair *
 get_rdma_qpair_from_wc(struct nvme_rdma_poll_group *group, struct ibv_wc *wc)
 {
@@ -3416,6 +3451,8 @@ const struct spdk_nvme_transport_ops rdma_ops = {
 	.qpair_submit_request = nvme_rdma_qpair_submit_request,
 	.qpair_process_completions = nvme_rdma_qpair_process_completions,
 	.qpair_iterate_requests = nvme_rdma_qpair_iterate_requests,
+	.qpair_submit_batch_begin = nvme_rdma_qpair_submit_batch_begin,
+	.qpair_submit_batch_end = nvme_rdma_qpair_submit_batch_end,
 	.admin_qpair_abort_aers = nvme_rdma_admin_qpair_abort_aers,
 
 	.poll_group_create = nvme_rdma_poll_group_create,
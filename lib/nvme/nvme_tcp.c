@@ -59,6 +59,8 @@ struct nvme_tcp_poll_group {
 
 	TAILQ_HEAD(, nvme_tcp_qpair) needs_poll;
 	struct spdk_nvme_tcp_stat stats;
+	/* Bumped by every sock group poll, which flushes all sockets of the group */
+	uint64_t flush_epoch;
 };
 
 /* NVMe TCP qpair extensions for spdk_nvme_qpair */
@@ -85,9 +87,18 @@ struct nvme_tcp_qpair {
 		uint16_t host_ddgst_enable: 1;
 		uint16_t icreq_send_ack: 1;
 		uint16_t in_connect_poll: 1;
-		uint16_t reserved: 12;
+		/* PDUs are held in send_queue until the submission batch ends */
+		uint16_t in_submit_batch: 1;
+		/* See spdk_nvme_transport_opts.tcp_cycle_stats */
+		uint16_t cycle_stats: 1;
+		uint16_t reserved: 10;
 	} flags;
 
+	/* First PDU of send_queue not handed to the socket yet */
+	struct nvme_tcp_pdu			*batch_pdu;
+	/* Flush epoch in which PDUs were last handed to the socket, 0 once flushed */
+	uint64_t				unflushed_epoch;
+
 	/** Specifies the maximum number of PDU-Data bytes per H2C Data Transfer PDU */
 	uint32_t				maxh2cdata;
 
@@ -104,6 +115,11 @@ struct nvme_tcp_qpair {
 	uint64_t				icreq_timeout_tsc;
 
 	bool					shared_stats;
+
+	/* Per qpair accounting, reported by spdk_nvme_poll_group_get_stats() */
+	uint64_t				submitted_ios;
+	uint64_t				completed_ios;
+	struct spdk_nvme_tcp_cycles		cycles;
 };
 
 enum nvme_tcp_req_state {
@@ -159,6 +175,16 @@ struct nvme_tcp_req {
 
 static struct spdk_nvme_tcp_stat g_dummy_stats = {};
 
+/* Start of a stage of the I/O path that may contain other stages, see spdk_nvme_tcp_cycles */
+struct nvme_tcp_stage {
+	uint64_t				tsc;
+	uint64_t				nested;
+};
+
+/* Cycles charged to stages of any qpair on this thread. A completion callback may
+ * submit to other qpairs, so stages nest across qpairs. */
+static __thread uint64_t g_nvme_tcp_thread_cycles;
+
 static void nvme_tcp_send_h2c_data(struct nvme_tcp_req *tcp_req);
 static int64_t nvme_tcp_poll_group_process_completions(struct spdk_nvme_transport_poll_group
 		*tgroup, uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb);
@@ -179,6 +205,70 @@ nvme_tcp_poll_group(struct spdk_nvme_transport_poll_group *group)
 	return SPDK_CONTAINEROF(group, struct nvme_tcp_poll_group, group);
 }
 
+static inline uint64_t
+nvme_tcp_qpair_flush_epoch(struct nvme_tcp_qpair *tqpair)
+{
+	struct spdk_nvme_transport_poll_group *tgroup = tqpair->qpair.poll_group;
+
+	/* Qpairs outside a poll group are flushed explicitly on each poll */
+	return tgroup != NULL ? nvme_tcp_poll_group(tgroup)->flush_epoch : 1;
+}
+
+/*
+ * Account for the flush that will send the PDUs just handed to the socket. Only
+ * the first hand-over since the last flush, whether explicit or done by the sock
+ * group poll, costs one, so sock_flushes counts flushes that had data to send.
+ */
+static inline void
+nvme_tcp_qpair_mark_unflushed(struct nvme_tcp_qpair *tqpair)
+{
+	uint64_t epoch = nvme_tcp_qpair_flush_epoch(tqpair);
+
+	if (tqpair->unflushed_epoch != epoch) {
+		tqpair->unflushed_epoch = epoch;
+		tqpair->stats->sock_flushes++;
+	}
+}
+
+static inline void
+nvme_tcp_cycles_add(struct spdk_nvme_tcp_cycles *dst, const struct spdk_nvme_tcp_cycles *src)
+{
+	dst->pdu_build += src->pdu_build;
+	dst->digest += src->digest;
+	dst->sock_write += src->sock_write;
+	dst->sock_read += src->sock_read;
+	dst->pdu_parse += src->pdu_parse;
+	dst->completion += src->completion;
+}
+
+static inline void
+nvme_tcp_stage_begin(struct nvme_tcp_qpair *tqpair, struct nvme_tcp_stage *stage)
+{
+	stage->tsc = 0;
+	if (spdk_likely(!tqpair->flags.cycle_stats)) {
+		return;
+	}
+
+	stage->nested = g_nvme_tcp_thread_cycles;
+	stage->tsc = spdk_get_ticks();
+}
+
+/* Charge the time since nvme_tcp_stage_begin() to counter, minus what the stages
+ * nested in it already charged. */
+static inline void
+nvme_tcp_stage_end(struct nvme_tcp_qpair *tqpair, struct nvme_tcp_stage *stage, uint64_t *counter)
+{
+	uint64_t cycles;
+
+	if (spdk_likely(stage->tsc == 0)) {
+		return;
+	}
+
+	cycles = spdk_get_ticks() - stage->tsc - (g_nvme_tcp_thread_cycles - stage->nested);
+	*counter += cycles;
+	g_nvme_tcp_thread_cycles += cycles;
+}
+
 static inline struct nvme_tcp_ctrlr *
 nvme_tcp_ctrlr(struct spdk_nvme_ctrlr *ctrlr)
 {
@@ -357,6 +447,7 @@ nvme_tcp_ctrlr_disconnect_qpair(struct spdk_nvme_ctrlr *ctrlr, struct spdk_nvme_
 	}
 
 	/* clear the send_queue */
+	tqpair->batch_pdu = NULL;
 	while (!TAILQ_EMPTY(&tqpair->send_queue)) {
 		pdu = TAILQ_FIRST(&tqpair->send_queue);
 		/* Remove the pdu from the send_queue to prevent the wrong sending out
@@ -474,6 +565,7 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 {
 	uint32_t mapped_length = 0;
 	struct nvme_tcp_qpair *tqpair = pdu->qpair;
+	struct nvme_tcp_stage stage;
 
 	pdu->sock_req.iovcnt = nvme_tcp_build_iovs(pdu->iov, SPDK_COUNTOF(pdu->iov), pdu,
 			       (bool)tqpair->flags.host_hdgst_enable, (bool)tqpair->flags.host_ddgst_enable,
@@ -488,7 +580,17 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 	pdu->sock_req.cb_fn = pdu_write_done;
 	pdu->sock_req.cb_arg = pdu;
 	tqpair->stats->submitted_requests++;
+	if (tqpair->flags.in_submit_batch) {
+		/* Deferred PDUs are always at the tail of send_queue */
+		if (tqpair->batch_pdu == NULL) {
+			tqpair->batch_pdu = pdu;
+		}
+		return;
+	}
+	nvme_tcp_qpair_mark_unflushed(tqpair);
+	nvme_tcp_stage_begin(tqpair, &stage);
 	spdk_sock_writev_async(tqpair->sock, &pdu->sock_req);
+	nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_write);
 }
 
 static void
@@ -673,6 +775,7 @@ pdu_compute_crc32(struct nvme_tcp_pdu *pdu)
 	struct nvme_tcp_qpair *tqpair = pdu->qpair;
 	struct nvme_tcp_poll_group *tgroup;
 	struct nvme_request *req;
+	struct nvme_tcp_stage stage;
 	uint32_t crc32c;
 
 	/* Data Digest */
@@ -690,9 +793,11 @@ pdu_compute_crc32(struct nvme_tcp_pdu *pdu)
 			return;
 		}
 
+		nvme_tcp_stage_begin(tqpair, &stage);
 		crc32c = nvme_tcp_pdu_calc_data_digest(pdu);
 		crc32c = crc32c ^ SPDK_CRC32C_XOR;
 		MAKE_DIGEST_WORD(pdu->data_digest, crc32c);
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.digest);
 	}
 
 	tcp_write_pdu(pdu);
@@ -705,6 +810,7 @@ nvme_tcp_qpair_write_pdu(struct nvme_tcp_qpair *tqpair,
 			 void *cb_arg)
 {
 	int hlen;
+	struct nvme_tcp_stage stage;
 	uint32_t crc32c;
 
 	hlen = pdu->hdr.common.hlen;
@@ -714,8 +820,10 @@ nvme_tcp_qpair_write_pdu(struct nvme_tcp_qpair *tqpair,
 
 	/* Header Digest */
 	if (g_nvme_tcp_hdgst[pdu->hdr.common.pdu_type] && tqpair->flags.host_hdgst_enable) {
+		nvme_tcp_stage_begin(tqpair, &stage);
 		crc32c = nvme_tcp_pdu_calc_header_digest(pdu);
 		MAKE_DIGEST_WORD((uint8_t *)&pdu->hdr.raw[hlen], crc32c);
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.digest);
 	}
 
 	pdu_compute_crc32(pdu);
@@ -883,11 +991,16 @@ nvme_tcp_req_init(struct nvme_tcp_qpair *tqpair, struct nvme_request *req,
 			max_in_capsule_data_size = SPDK_NVME_TCP_IN_CAPSULE_DATA_MAX_SIZE;
 		}
 
+		/* ioccsz_bytes is the target's in-capsule data size, so every write that
+		 * fits goes out with the command and saves the R2T round trip. */
 		if (req->payload_size <= max_in_capsule_data_size) {
 			req->cmd.dptr.sgl1.unkeyed.type = SPDK_NVME_SGL_TYPE_DATA_BLOCK;
 			req->cmd.dptr.sgl1.unkeyed.subtype = SPDK_NVME_SGL_SUBTYPE_OFFSET;
 			req->cmd.dptr.sgl1.address = 0;
 			tcp_req->in_capsule_data = true;
+			tqpair->stats->in_capsule_writes++;
+		} else {
+			tqpair->stats->r2t_writes++;
 		}
 	}
 
@@ -1002,11 +1115,14 @@ nvme_tcp_qpair_submit_request(struct spdk_nvme_qpair *qpair,
 {
 	struct nvme_tcp_qpair *tqpair;
 	struct nvme_tcp_req *tcp_req;
+	struct nvme_tcp_stage stage;
+	int rc;
 
 	tqpair = nvme_tcp_qpair(qpair);
 	assert(tqpair != NULL);
 	assert(req != NULL);
 
+	nvme_tcp_stage_begin(tqpair, &stage);
 	tcp_req = nvme_tcp_req_get(tqpair);
 	if (!tcp_req) {
 		tqpair->stats->queued_requests++;
@@ -1025,7 +1141,69 @@ nvme_tcp_qpair_submit_request(struct spdk_nvme_qpair *qpair,
 			  (uint32_t)req->cmd.cid, (uint32_t)req->cmd.opc,
 			  req->cmd.cdw10, req->cmd.cdw11, req->cmd.cdw12, tqpair->qpair.queue_depth);
 	TAILQ_INSERT_TAIL(&tqpair->outstanding_reqs, tcp_req, link);
-	return nvme_tcp_qpair_capsule_cmd_send(tqpair, tcp_req);
+	tqpair->stats->submitted_ios++;
+	tqpair->submitted_ios++;
+	rc = nvme_tcp_qpair_capsule_cmd_send(tqpair, tcp_req);
+	nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.pdu_build);
+
+	return rc;
+}
+
+static void
+nvme_tcp_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_tcp_qpair *tqpair = nvme_tcp_qpair(qpair);
+
+	assert(tqpair->batch_pdu == NULL);
+	tqpair->flags.in_submit_batch = 1;
+}
+
+/*
+ * Hand all PDUs queued during the batch to the socket as one chain and flush it
+ * with a single call, instead of relying on what the next flush of the sock group
+ * happens to gather.
+ */
+static int
+nvme_tcp_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_tcp_qpair *tqpair = nvme_tcp_qpair(qpair);
+	struct nvme_tcp_pdu *pdu;
+	struct nvme_tcp_stage stage;
+	int rc;
+
+	if (tqpair->batch_pdu == NULL) {
+		tqpair->flags.in_submit_batch = 0;
+		return 0;
+	}
+
+	tqpair->stats->submit_batches++;
+	nvme_tcp_stage_begin(tqpair, &stage);
+
+	/* Keep deferring while the chain is handed over, so that PDUs queued from
+	 * completion callbacks of an intermediate flush stay behind it. A disconnect
+	 * clears batch_pdu. */
+	while ((pdu = tqpair->batch_pdu) != NULL) {
+		tqpair->batch_pdu = TAILQ_NEXT(pdu, tailq);
+		spdk_sock_writev_async(tqpair->sock, &pdu->sock_req);
+	}
+	tqpair->flags.in_submit_batch = 0;
+
+	if (tqpair->sock == NULL) {
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_write);
+		return -ENXIO;
+	}
+
+	nvme_tcp_qpair_mark_unflushed(tqpair);
+	tqpair->unflushed_epoch = 0;
+	rc = spdk_sock_flush(tqpair->sock);
+	nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_write);
+	if (rc < 0 && errno != EAGAIN) {
+		SPDK_ERRLOG("Failed to flush tqpair=%p (%d): %s\n", tqpair,
+			    errno, spdk_strerror(errno));
+		return -errno;
+	}
+
+	return 0;
 }
 
 static int
@@ -1043,6 +1221,7 @@ nvme_tcp_req_complete(struct nvme_tcp_req *tcp_req,
 	struct spdk_nvme_cpl	cpl;
 	struct spdk_nvme_qpair	*qpair;
 	struct nvme_request	*req;
+	struct nvme_tcp_stage	stage;
 	bool			print_error;
 
 	assert(tcp_req->req != NULL);
@@ -1069,7 +1248,10 @@ nvme_tcp_req_complete(struct nvme_tcp_req *tcp_req,
 			  (uint32_t)req->cmd.cid, (uint32_t)cpl.status_raw, tqpair->qpair.queue_depth);
 	TAILQ_REMOVE(&tcp_req->tqpair->outstanding_reqs, tcp_req, link);
 	nvme_tcp_req_put(tqpair, tcp_req);
+	tqpair->completed_ios++;
+	nvme_tcp_stage_begin(tqpair, &stage);
 	nvme_complete_request(req->cb_fn, req->cb_arg, req->qpair, req, &cpl);
+	nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.completion);
 }
 
 static void
@@ -1505,6 +1687,7 @@ nvme_tcp_pdu_payload_handle(struct nvme_tcp_qpair *tqpair,
 {
 	int rc = 0;
 	struct nvme_tcp_pdu *pdu = tqpair->recv_pdu;
+	struct nvme_tcp_stage stage;
 	uint32_t crc32c;
 	struct nvme_tcp_req *tcp_req = pdu->req;
 
@@ -1524,9 +1707,11 @@ nvme_tcp_pdu_payload_handle(struct nvme_tcp_qpair *tqpair,
 			return;
 		}
 
+		nvme_tcp_stage_begin(tqpair, &stage);
 		crc32c = nvme_tcp_pdu_calc_data_digest(pdu);
 		crc32c = crc32c ^ SPDK_CRC32C_XOR;
 		rc = MATCH_DIGEST_WORD(pdu->data_digest, crc32c);
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.digest);
 		if (rc == 0) {
 			SPDK_ERRLOG("data digest error on tqpair=(%p) with pdu=%p\n", tqpair, pdu);
 			tcp_req = pdu->req;
@@ -1957,6 +2142,7 @@ nvme_tcp_pdu_psh_handle(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 {
 	struct nvme_tcp_pdu *pdu;
 	int rc;
+	struct nvme_tcp_stage stage;
 	uint32_t crc32c, error_offset = 0;
 	enum spdk_nvme_tcp_term_req_fes fes;
 
@@ -1966,8 +2152,10 @@ nvme_tcp_pdu_psh_handle(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 	SPDK_DEBUGLOG(nvme, "enter: pdu type =%u\n", pdu->hdr.common.pdu_type);
 	/* check header digest if needed */
 	if (pdu->has_hdgst) {
+		nvme_tcp_stage_begin(tqpair, &stage);
 		crc32c = nvme_tcp_pdu_calc_header_digest(pdu);
 		rc = MATCH_DIGEST_WORD((uint8_t *)pdu->hdr.raw + pdu->hdr.common.hlen, crc32c);
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.digest);
 		if (rc == 0) {
 			SPDK_ERRLOG("header digest error on tqpair=(%p) with pdu=%p\n", tqpair, pdu);
 			fes = SPDK_NVME_TCP_TERM_REQ_FES_HDGST_ERROR;
@@ -2010,6 +2198,7 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 {
 	int rc = 0;
 	struct nvme_tcp_pdu *pdu;
+	struct nvme_tcp_stage stage;
 	uint32_t data_len;
 	enum nvme_tcp_pdu_recv_state prev_state;
 
@@ -2033,9 +2222,11 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 		/* Wait for the pdu common header */
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH:
 			assert(pdu->ch_valid_bytes < sizeof(struct spdk_nvme_tcp_common_pdu_hdr));
+			nvme_tcp_stage_begin(tqpair, &stage);
 			rc = nvme_tcp_read_data(tqpair->sock,
 						sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
 						(uint8_t *)&pdu->hdr.common + pdu->ch_valid_bytes);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_read);
 			if (rc < 0) {
 				nvme_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
@@ -2046,14 +2237,18 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 			}
 
 			/* The command header of this PDU has now been read from the socket. */
+			nvme_tcp_stage_begin(tqpair, &stage);
 			nvme_tcp_pdu_ch_handle(tqpair);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.pdu_parse);
 			break;
 		/* Wait for the pdu specific header  */
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH:
 			assert(pdu->psh_valid_bytes < pdu->psh_len);
+			nvme_tcp_stage_begin(tqpair, &stage);
 			rc = nvme_tcp_read_data(tqpair->sock,
 						pdu->psh_len - pdu->psh_valid_bytes,
 						(uint8_t *)&pdu->hdr.raw + sizeof(struct spdk_nvme_tcp_common_pdu_hdr) + pdu->psh_valid_bytes);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_read);
 			if (rc < 0) {
 				nvme_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
@@ -2065,7 +2260,9 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 			}
 
 			/* All header(ch, psh, head digist) of this PDU has now been read from the socket. */
+			nvme_tcp_stage_begin(tqpair, &stage);
 			nvme_tcp_pdu_psh_handle(tqpair, reaped);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.pdu_parse);
 			break;
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD:
 			/* check whether the data is valid, if not we just return */
@@ -2081,7 +2278,9 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 				pdu->ddgst_enable = true;
 			}
 
+			nvme_tcp_stage_begin(tqpair, &stage);
 			rc = nvme_tcp_read_payload_data(tqpair->sock, pdu);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_read);
 			if (rc < 0) {
 				nvme_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
@@ -2094,7 +2293,9 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped, uint32_t max_
 
 			assert(pdu->rw_offset == data_len);
 			/* All of this PDU has now been read from the socket. */
+			nvme_tcp_stage_begin(tqpair, &stage);
 			nvme_tcp_pdu_payload_handle(tqpair, reaped);
+			nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.pdu_parse);
 			break;
 		case NVME_TCP_PDU_RECV_STATE_QUIESCING:
 			if (TAILQ_EMPTY(&tqpair->outstanding_reqs)) {
@@ -2167,11 +2368,15 @@ static int
 nvme_tcp_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
 {
 	struct nvme_tcp_qpair *tqpair = nvme_tcp_qpair(qpair);
+	struct nvme_tcp_stage stage;
 	uint32_t reaped;
 	int rc;
 
 	if (qpair->poll_group == NULL) {
+		tqpair->unflushed_epoch = 0;
+		nvme_tcp_stage_begin(tqpair, &stage);
 		rc = spdk_sock_flush(tqpair->sock);
+		nvme_tcp_stage_end(tqpair, &stage, &tqpair->cycles.sock_write);
 		if (rc < 0 && errno != EAGAIN) {
 			SPDK_ERRLOG("Failed to flush tqpair=%p (%d): %s\n", tqpair,
 				    errno, spdk_strerror(errno));
@@ -2520,6 +2725,7 @@ nvme_tcp_ctrlr_create_qpair(struct spdk_nvme_ctrlr *ctrlr,
 	 * one slot shall always remain empty.
 	 */
 	tqpair->num_entries = qsize - 1;
+	tqpair->flags.cycle_stats = g_spdk_nvme_transport_opts.tcp_cycle_stats;
 	qpair = &tqpair->qpair;
 	rc = nvme_qpair_init(qpair, qid, ctrlr, qprio, num_requests, async);
 	if (rc != 0) {
@@ -2780,6 +2986,7 @@ nvme_tcp_poll_group_create(void)
 	}
 
 	TAILQ_INIT(&group->needs_poll);
+	group->flush_epoch = 1;
 
 	group->sock_group = spdk_sock_group_create(group);
 	if (group->sock_group == NULL) {
@@ -2869,6 +3076,12 @@ nvme_tcp_poll_group_remove(struct spdk_nvme_transport_poll_group *tgroup,
 	assert(tqpair->shared_stats == true);
 	tqpair->stats = &g_dummy_stats;
 
+	/* Keep the cycles of removed qpairs in the group totals. */
+	nvme_tcp_cycles_add(&group->stats.cycles, &tqpair->cycles);
+	memset(&tqpair->cycles, 0, sizeof(tqpair->cycles));
+	tqpair->submitted_ios = 0;
+	tqpair->completed_ios = 0;
+
 	if (tqpair->needs_poll) {
 		TAILQ_REMOVE(&group->needs_poll, tqpair, link);
 		tqpair->needs_poll = false;
@@ -2890,6 +3103,9 @@ nvme_tcp_poll_group_process_completions(struct spdk_nvme_transport_poll_group *t
 	group->num_completions = 0;
 	group->stats.polls++;
 
+	/* The poll flushes every socket of the group, so PDUs handed over from now on
+	 * need another flush. */
+	group->flush_epoch++;
 	num_events = spdk_sock_group_poll(group->sock_group);
 
 	STAILQ_FOREACH_SAFE(qpair, &tgroup->disconnected_qpairs, poll_group_stailq, tmp_qpair) {
@@ -2944,12 +3160,26 @@ nvme_tcp_poll_group_destroy(struct spdk_nvme_transport_poll_group *tgroup)
 	return 0;
 }
 
+static void
+nvme_tcp_qpair_get_stat(struct spdk_nvme_qpair *qpair, struct spdk_nvme_tcp_qpair_stat *stat)
+{
+	struct nvme_tcp_qpair *tqpair = nvme_tcp_qpair(qpair);
+
+	stat->qpair = qpair;
+	stat->qid = qpair->id;
+	stat->submitted_ios = tqpair->submitted_ios;
+	stat->completed_ios = tqpair->completed_ios;
+	stat->cycles = tqpair->cycles;
+}
+
 static int
 nvme_tcp_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 			      struct spdk_nvme_transport_poll_group_stat **_stats)
 {
 	struct nvme_tcp_poll_group *group;
 	struct spdk_nvme_transport_poll_group_stat *stats;
+	struct spdk_nvme_qpair *qpair;
+	uint32_t num_qpairs, i;
 
 	if (tgroup == NULL || _stats == NULL) {
 		SPDK_ERRLOG("Invalid stats or group pointer\n");
@@ -2966,6 +3196,34 @@ nvme_tcp_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 	stats->trtype = SPDK_NVME_TRANSPORT_TCP;
 	memcpy(&stats->tcp, &group->stats, sizeof(group->stats));
 
+	num_qpairs = 0;
+	STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+		num_qpairs++;
+	}
+	STAILQ_FOREACH(qpair, &tgroup->disconnected_qpairs, poll_group_stailq) {
+		num_qpairs++;
+	}
+
+	if (num_qpairs != 0) {
+		stats->tcp.qpair_stats = calloc(num_qpairs, sizeof(*stats->tcp.qpair_stats));
+		if (!stats->tcp.qpair_stats) {
+			SPDK_ERRLOG("Can't allocate memory for TCP qpair stats\n");
+			free(stats);
+			return -ENOMEM;
+		}
+
+		STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+			nvme_tcp_qpair_get_stat(qpair, &stats->tcp.qpair_stats[stats->tcp.num_qpairs++]);
+		}
+		STAILQ_FOREACH(qpair, &tgroup->disconnected_qpairs, poll_group_stailq) {
+			nvme_tcp_qpair_get_stat(qpair, &stats->tcp.qpair_stats[stats->tcp.num_qpairs++]);
+		}
+	}
+
+	for (i = 0; i < stats->tcp.num_qpairs; i++) {
+		nvme_tcp_cycles_add(&stats->tcp.cycles, &stats->tcp.qpair_stats[i].cycles);
+	}
+
 	*_stats = stats;
 
 	return 0;
@@ -2975,6 +3233,9 @@ static void
 nvme_tcp_poll_group_free_stats(struct spdk_nvme_transport_poll_group *tgroup,
 			       struct spdk_nvme_transport_poll_group_stat *stats)
 {
+	if (stats) {
+		free(stats->tcp.qpair_stats);
+	}
 	free(stats);
 }
 
@@ -3020,6 +3281,8 @@ const struct spdk_nvme_transport_ops tcp_ops = {
 	.qpair_reset = nvme_tcp_qpair_reset,
 	.qpair_submit_request = nvme_tcp_qpair_submit_request,
 	.qpair_process_completions = nvme_tcp_qpair_process_completions,
+	.qpair_submit_batch_begin = nvme_tcp_qpair_submit_batch_begin,
+	.qpair_submit_batch_end = nvme_tcp_qpair_submit_batch_end,
 	.qpair_iterate_requests = nvme_tcp_qpair_iterate_requests,
 	.admin_qpair_abort_aers = nvme_tcp_admin_qpair_abort_aers,
 
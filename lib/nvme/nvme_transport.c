@@ -28,7 +28,8 @@ int g_current_transport_index = 0;
 struct spdk_nvme_transport_opts g_spdk_nvme_transport_opts = {
 	.rdma_srq_size = 0,
 	.rdma_max_cq_size = 0,
-	.rdma_cm_event_timeout_ms = 1000
+	.rdma_cm_event_timeout_ms = 1000,
+	.tcp_cycle_stats = false
 };
 
 const struct spdk_nvme_transport *
@@ -616,6 +617,38 @@ nvme_transport_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t
 	return transport->ops.qpair_process_completions(qpair, max_completions);
 }
 
+void
+nvme_transport_qpair_submit_batch_begin(struct spdk_nvme_qpair *qpair)
+{
+	const struct spdk_nvme_transport *transport = qpair->transport;
+
+	if (spdk_unlikely(nvme_qpair_is_admin_queue(qpair))) {
+		transport = nvme_get_transport(qpair->ctrlr->trid.trstring);
+		assert(transport != NULL);
+	}
+
+	if (transport->ops.qpair_submit_batch_begin) {
+		transport->ops.qpair_submit_batch_begin(qpair);
+	}
+}
+
+int
+nvme_transport_qpair_submit_batch_end(struct spdk_nvme_qpair *qpair)
+{
+	const struct spdk_nvme_transport *transport = qpair->transport;
+
+	if (spdk_unlikely(nvme_qpair_is_admin_queue(qpair))) {
+		transport = nvme_get_transport(qpair->ctrlr->trid.trstring);
+		assert(transport != NULL);
+	}
+
+	if (transport->ops.qpair_submit_batch_end) {
+		return transport->ops.qpair_submit_batch_end(qpair);
+	}
+
+	return 0;
+}
+
 int
 nvme_transport_qpair_iterate_requests(struct spdk_nvme_qpair *qpair,
 				      int (*iter_fn)(struct nvme_request *req, void *arg),
@@ -826,6 +859,7 @@ spdk_nvme_transport_get_opts(struct spdk_nvme_transport_opts *opts, size_t opts_
 	SET_FIELD(rdma_srq_size);
 	SET_FIELD(rdma_max_cq_size);
 	SET_FIELD(rdma_cm_event_timeout_ms);
+	SET_FIELD(tcp_cycle_stats);
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
@@ -855,6 +889,7 @@ spdk_nvme_transport_set_opts(const struct spdk_nvme_transport_opts *opts, size_t
 	SET_FIELD(rdma_srq_size);
 	SET_FIELD(rdma_max_cq_size);
 	SET_FIELD(rdma_cm_event_timeout_ms);
+	SET_FIELD(tcp_cycle_stats);
 
 	g_spdk_nvme_transport_opts.opts_size = opts->opts_size;
 
@@ -346,6 +346,8 @@ const struct spdk_nvme_transport_ops vfio_ops = {
 	.qpair_abort_reqs = nvme_pcie_qpair_abort_reqs,
 	.qpair_submit_request = nvme_pcie_qpair_submit_request,
 	.qpair_process_completions = nvme_pcie_qpair_process_completions,
+	.qpair_submit_batch_begin = nvme_pcie_qpair_submit_batch_begin,
+	.qpair_submit_batch_end = nvme_pcie_qpair_submit_batch_end,
 
 	.poll_group_create = nvme_pcie_poll_group_create,
 	.poll_group_connect_qpair = nvme_pcie_poll_group_connect_qpair,
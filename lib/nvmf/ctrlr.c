@@ -348,6 +348,7 @@ _nvmf_subsystem_add_ctrlr(void *ctx)
 	struct spdk_nvmf_qpair *qpair = req->qpair;
 	struct spdk_nvmf_fabric_connect_rsp *rsp = &req->rsp->connect_rsp;
 	struct spdk_nvmf_ctrlr *ctrlr = qpair->ctrlr;
+	struct spdk_nvmf_host_qos_opts qos_opts;
 
 	if (nvmf_subsystem_add_ctrlr(ctrlr->subsys, ctrlr)) {
 		SPDK_ERRLOG("Unable to add controller to subsystem\n");
@@ -359,6 +360,11 @@ _nvmf_subsystem_add_ctrlr(void *ctx)
 		return;
 	}
 
+	/* Updates of the host's QoS are sent to this thread as well, so they can't be missed */
+	if (spdk_nvmf_subsystem_get_host_qos(ctrlr->subsys, ctrlr->hostnqn, &qos_opts) == 0) {
+		nvmf_ctrlr_qos_set(ctrlr, &qos_opts);
+	}
+
 	spdk_thread_send_msg(ctrlr->thread, _nvmf_ctrlr_add_admin_qpair, req);
 }
 
@@ -438,6 +444,7 @@ nvmf_ctrlr_create(struct spdk_nvmf_subsystem *subsystem,
 		SPDK_ERRLOG("Memory allocation failed\n");
 		return NULL;
 	}
+	ctrlr->qos.weight = SPDK_NVMF_HOST_QOS_DEFAULT_WEIGHT;
 
 	if (spdk_nvme_trtype_is_fabrics(transport->ops->type)) {
 		ctrlr->dynamic_ctrlr = true;
@@ -2062,7 +2069,7 @@ nvmf_ctrlr_set_features_number_of_queues(struct spdk_nvmf_request *req)
 	return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 }
 
-SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ctrlr) == 4928,
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ctrlr) == 4984,
 		   "Please check migration fields that need to be added or not");
 
 static void
@@ -4296,6 +4303,89 @@ nvmf_ctrlr_use_zcopy(struct spdk_nvmf_request *req)
 	return true;
 }
 
+void
+nvmf_ctrlr_qos_set(struct spdk_nvmf_ctrlr *ctrlr, const struct spdk_nvmf_host_qos_opts *opts)
+{
+	struct spdk_nvmf_ctrlr_qos *qos = &ctrlr->qos;
+	uint64_t timeslices_per_sec = SPDK_SEC_TO_USEC / NVMF_CTRLR_QOS_TIMESLICE_IN_USEC;
+	int64_t ios_per_timeslice = 0, bytes_per_timeslice = 0;
+
+	if (opts != NULL) {
+		ios_per_timeslice = spdk_divide_round_up(opts->rw_ios_per_sec, timeslices_per_sec);
+		bytes_per_timeslice = spdk_divide_round_up(opts->rw_mbytes_per_sec * 1024 * 1024,
+				      timeslices_per_sec);
+	}
+
+	/* Stop admission checks first, the limits are only read while limited is set */
+	__atomic_store_n(&qos->limited, false, __ATOMIC_RELEASE);
+
+	qos->weight = (opts != NULL && opts->weight != 0) ? opts->weight :
+		      SPDK_NVMF_HOST_QOS_DEFAULT_WEIGHT;
+	qos->timeslice_size = NVMF_CTRLR_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	qos->ios_per_timeslice = ios_per_timeslice;
+	qos->bytes_per_timeslice = bytes_per_timeslice;
+	__atomic_store_n(&qos->remaining_ios, ios_per_timeslice, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos->remaining_bytes, bytes_per_timeslice, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos->last_timeslice, spdk_get_ticks(), __ATOMIC_RELAXED);
+
+	__atomic_store_n(&qos->limited, ios_per_timeslice != 0 || bytes_per_timeslice != 0,
+			 __ATOMIC_RELEASE);
+}
+
+static inline void
+nvmf_ctrlr_qos_refill(int64_t *remaining, int64_t per_timeslice, uint64_t timeslices)
+{
+	int64_t cur, target;
+
+	if (per_timeslice == 0) {
+		return;
+	}
+
+	/* Debt is paid off by the elapsed timeslices, but unused quota isn't banked */
+	cur = __atomic_load_n(remaining, __ATOMIC_RELAXED);
+	target = spdk_min(cur + (int64_t)spdk_min(timeslices, (uint64_t)INT32_MAX) * per_timeslice,
+			  per_timeslice);
+	__atomic_add_fetch(remaining, target - cur, __ATOMIC_RELAXED);
+}
+
+bool
+nvmf_ctrlr_qos_admit(struct spdk_nvmf_ctrlr *ctrlr, uint32_t length)
+{
+	struct spdk_nvmf_ctrlr_qos *qos = &ctrlr->qos;
+	uint64_t now, last, timeslices;
+
+	if (spdk_likely(!__atomic_load_n(&qos->limited, __ATOMIC_ACQUIRE))) {
+		return true;
+	}
+
+	now = spdk_get_ticks();
+	last = __atomic_load_n(&qos->last_timeslice, __ATOMIC_RELAXED);
+	timeslices = (now - last) / qos->timeslice_size;
+	/* Only the poll group that moves the timeslice forward refills the quota */
+	if (timeslices != 0 &&
+	    __atomic_compare_exchange_n(&qos->last_timeslice, &last, last + timeslices * qos->timeslice_size,
+					false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		nvmf_ctrlr_qos_refill(&qos->remaining_ios, qos->ios_per_timeslice, timeslices);
+		nvmf_ctrlr_qos_refill(&qos->remaining_bytes, qos->bytes_per_timeslice, timeslices);
+	}
+
+	/* Like the bdev layer, let the request through as long as some quota is left */
+	if ((qos->ios_per_timeslice != 0 && __atomic_load_n(&qos->remaining_ios, __ATOMIC_RELAXED) <= 0) ||
+	    (qos->bytes_per_timeslice != 0 &&
+	     __atomic_load_n(&qos->remaining_bytes, __ATOMIC_RELAXED) <= 0)) {
+		return false;
+	}
+
+	if (qos->ios_per_timeslice != 0) {
+		__atomic_sub_fetch(&qos->remaining_ios, 1, __ATOMIC_RELAXED);
+	}
+	if (qos->bytes_per_timeslice != 0) {
+		__atomic_sub_fetch(&qos->remaining_bytes, length, __ATOMIC_RELAXED);
+	}
+
+	return true;
+}
+
 void
 spdk_nvmf_request_zcopy_start(struct spdk_nvmf_request *req)
 {
@@ -4540,6 +4630,7 @@ _nvmf_request_complete(void *ctx)
 				/* NOTE: This implicitly also checks for 0, since 0 - 1 wraps around to UINT32_MAX. */
 				if (spdk_likely(nsid - 1 < sgroup->num_ns)) {
 					sgroup->ns_info[nsid - 1].io_outstanding--;
+					qpair->group->outstanding_io--;
 				}
 			}
 		}
@@ -4642,6 +4733,7 @@ nvmf_check_subsystem_active(struct spdk_nvmf_request *req)
 			req->rsp->nvme_cpl.status.dnr = 1;
 			TAILQ_INSERT_TAIL(&qpair->outstanding, req, link);
 			ns_info->io_outstanding++;
+			qpair->group->outstanding_io++;
 			_nvmf_request_complete(req);
 			return false;
 		}
@@ -4653,6 +4745,7 @@ nvmf_check_subsystem_active(struct spdk_nvmf_request *req)
 		}
 
 		ns_info->io_outstanding++;
+		qpair->group->outstanding_io++;
 	}
 
 	return true;
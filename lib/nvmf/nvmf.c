@@ -154,6 +154,10 @@ nvmf_poll_group_poll(void *ctx)
 	struct spdk_nvmf_transport_poll_group *tgroup;
 
 	TAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		if (tgroup->idle) {
+			/* It polls itself */
+			continue;
+		}
 		rc = nvmf_transport_poll_group_poll(tgroup);
 		if (rc < 0) {
 			return SPDK_POLLER_BUSY;
@@ -164,6 +168,49 @@ nvmf_poll_group_poll(void *ctx)
 	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+/*
+ * Run the poller only while some transport poll group is busy. It's unregistered
+ * rather than paused, because in interrupt mode a busy poller's eventfd keeps
+ * firing even while the poller is paused.
+ */
+static void
+nvmf_poll_group_update_poller(struct spdk_nvmf_poll_group *group)
+{
+	struct spdk_nvmf_transport_poll_group *tgroup;
+	bool idle = !TAILQ_EMPTY(&group->tgroups);
+
+	if (group->polling_paused) {
+		return;
+	}
+
+	TAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		if (!tgroup->idle) {
+			idle = false;
+			break;
+		}
+	}
+
+	if (idle) {
+		spdk_poller_unregister(&group->poller);
+	} else if (group->poller == NULL) {
+		group->poller = SPDK_POLLER_REGISTER(nvmf_poll_group_poll, group, 0);
+		if (group->poller == NULL) {
+			SPDK_ERRLOG("Unable to register poller for poll group %p\n", group);
+		}
+	}
+}
+
+void
+spdk_nvmf_transport_poll_group_set_idle(struct spdk_nvmf_transport_poll_group *tgroup, bool idle)
+{
+	if (tgroup->idle == idle) {
+		return;
+	}
+
+	tgroup->idle = idle;
+	nvmf_poll_group_update_poller(tgroup->group);
+}
+
 /*
  * Reset and clean up the poll group (I/O channel code will actually free the
  * group).
@@ -247,6 +294,7 @@ nvmf_poll_group_add_transport(struct spdk_nvmf_poll_group *group,
 
 	tgroup->group = group;
 	TAILQ_INSERT_TAIL(&group->tgroups, tgroup, link);
+	nvmf_poll_group_update_poller(group);
 
 	return 0;
 }
@@ -550,6 +598,7 @@ nvmf_write_nvme_subsystem_config(struct spdk_json_write_ctx *w,
 				 struct spdk_nvmf_subsystem *subsystem)
 {
 	struct spdk_nvmf_host *host;
+	struct spdk_nvmf_host_qos *host_qos;
 	struct spdk_nvmf_ns *ns;
 	struct spdk_nvmf_ns_opts ns_opts;
 	uint32_t max_namespaces;
@@ -615,6 +664,26 @@ nvmf_write_nvme_subsystem_config(struct spdk_json_write_ctx *w,
 		spdk_json_write_object_end(w);
 	}
 
+	TAILQ_FOREACH(host_qos, &subsystem->host_qos, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "nvmf_subsystem_set_host_qos");
+
+		/*     "params" : { */
+		spdk_json_write_named_object_begin(w, "params");
+
+		spdk_json_write_named_string(w, "nqn", spdk_nvmf_subsystem_get_nqn(subsystem));
+		spdk_json_write_named_string(w, "host", host_qos->nqn);
+		spdk_json_write_named_uint32(w, "weight", host_qos->opts.weight);
+		spdk_json_write_named_uint64(w, "rw_ios_per_sec", host_qos->opts.rw_ios_per_sec);
+		spdk_json_write_named_uint64(w, "rw_mbytes_per_sec", host_qos->opts.rw_mbytes_per_sec);
+
+		/*     } "params" */
+		spdk_json_write_object_end(w);
+
+		/* } */
+		spdk_json_write_object_end(w);
+	}
+
 	for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
 	     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
 		spdk_nvmf_ns_get_opts(ns, &ns_opts, sizeof(ns_opts));
@@ -742,6 +811,17 @@ spdk_nvmf_tgt_write_config_json(struct spdk_json_write_ctx *w, struct spdk_nvmf_
 		spdk_json_write_named_string(w, "method", "nvmf_create_transport");
 		nvmf_transport_dump_opts(transport, w, true);
 		spdk_json_write_object_end(w);
+
+		if (transport->qpair_placement != SPDK_NVMF_QPAIR_PLACEMENT_TRANSPORT) {
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "method", "nvmf_transport_set_qpair_placement");
+			spdk_json_write_named_object_begin(w, "params");
+			spdk_json_write_named_string(w, "trtype", spdk_nvmf_get_transport_name(transport));
+			spdk_json_write_named_string(w, "placement",
+						     spdk_nvmf_qpair_placement_str(transport->qpair_placement));
+			spdk_json_write_object_end(w);
+			spdk_json_write_object_end(w);
+		}
 	}
 
 	TAILQ_FOREACH(referral, &tgt->referrals, link) {
@@ -889,6 +969,7 @@ _nvmf_tgt_remove_transport(struct spdk_io_channel_iter *i)
 			nvmf_transport_poll_group_destroy(tgroup);
 		}
 	}
+	nvmf_poll_group_update_poller(group);
 
 	spdk_for_each_channel_continue(i, 0);
 }
@@ -980,6 +1061,7 @@ _nvmf_tgt_pause_polling(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct spdk_nvmf_poll_group *group = spdk_io_channel_get_ctx(ch);
 
+	group->polling_paused = true;
 	spdk_poller_unregister(&group->poller);
 
 	spdk_for_each_channel_continue(i, 0);
@@ -1040,7 +1122,8 @@ _nvmf_tgt_resume_polling(struct spdk_io_channel_iter *i)
 	struct spdk_nvmf_poll_group *group = spdk_io_channel_get_ctx(ch);
 
 	assert(group->poller == NULL);
-	group->poller = SPDK_POLLER_REGISTER(nvmf_poll_group_poll, group, 0);
+	group->polling_paused = false;
+	nvmf_poll_group_update_poller(group);
 
 	spdk_for_each_channel_continue(i, 0);
 }
@@ -1903,10 +1986,166 @@ fini:
 }
 
 
+/* Must be called with tgt->mutex held. */
+static struct spdk_nvmf_poll_group *
+nvmf_tgt_get_nth_poll_group(struct spdk_nvmf_tgt *tgt, uint32_t n)
+{
+	struct spdk_nvmf_poll_group *group;
+
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		if (n-- == 0) {
+			return group;
+		}
+	}
+
+	return NULL;
+}
+
+static struct spdk_nvmf_poll_group *
+nvmf_place_qpair_least_loaded(struct spdk_nvmf_tgt *tgt)
+{
+	struct spdk_nvmf_poll_group *group, *best = NULL;
+	uint32_t io, qpairs, best_io = UINT32_MAX, best_qpairs = UINT32_MAX;
+
+	pthread_mutex_lock(&tgt->mutex);
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		/* Updated on the poll group threads, a stale value is good enough here. */
+		io = __atomic_load_n(&group->outstanding_io, __ATOMIC_RELAXED);
+
+		pthread_mutex_lock(&group->mutex);
+		qpairs = group->stat.current_io_qpairs + group->current_unassociated_qpairs;
+		pthread_mutex_unlock(&group->mutex);
+
+		/* New qpairs carry no IO yet, so ties are broken by qpair count to keep
+		 * a burst of connections from landing on the same poll group.
+		 */
+		if (io < best_io || (io == best_io && qpairs < best_qpairs)) {
+			best = group;
+			best_io = io;
+			best_qpairs = qpairs;
+		}
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	return best;
+}
+
+/* FNV-1a, stable across restarts so placement is reproducible. */
+static uint32_t
+nvmf_placement_hash(const char *str)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *str != '\0'; str++) {
+		hash = (hash ^ (uint8_t)*str) * 16777619u;
+	}
+
+	return hash;
+}
+
+static struct spdk_nvmf_poll_group *
+nvmf_place_qpair_by_host(struct spdk_nvmf_tgt *tgt, struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvme_transport_id trid;
+	struct nvmf_host_placement *slot;
+	struct spdk_nvmf_poll_group *group = NULL;
+	uint32_t hash;
+
+	if (spdk_nvmf_qpair_get_peer_trid(qpair, &trid) != 0) {
+		return NULL;
+	}
+
+	hash = nvmf_placement_hash(trid.traddr);
+
+	pthread_mutex_lock(&tgt->mutex);
+	if (tgt->num_poll_groups != 0) {
+		slot = &tgt->host_placement[hash % NVMF_HOST_PLACEMENT_SLOTS];
+		if (slot->hash != hash) {
+			slot->hash = hash;
+			slot->next = 0;
+		}
+		group = nvmf_tgt_get_nth_poll_group(tgt, (hash + slot->next) % tgt->num_poll_groups);
+		slot->next++;
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	return group;
+}
+
+static struct spdk_nvmf_poll_group *
+nvmf_place_qpair_by_bdev(struct spdk_nvmf_tgt *tgt, struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvme_transport_id trid;
+	struct spdk_nvmf_subsystem *subsystem, *target = NULL;
+	struct spdk_nvmf_poll_group *group = NULL;
+	struct spdk_bdev *bdev;
+	uint32_t hash;
+
+	if (spdk_nvmf_qpair_get_listen_trid(qpair, &trid) != 0) {
+		return NULL;
+	}
+
+	/* The subsystem the host connects to is only known once CONNECT arrives,
+	 * after placement. It's implied by the listener only if no other subsystem
+	 * listens on the same address, otherwise the qpair is left to round-robin.
+	 */
+	for (subsystem = spdk_nvmf_subsystem_get_first(tgt); subsystem != NULL;
+	     subsystem = spdk_nvmf_subsystem_get_next(subsystem)) {
+		if (spdk_nvmf_subsystem_is_discovery(subsystem) ||
+		    spdk_nvmf_subsystem_get_first_ns(subsystem) == NULL ||
+		    nvmf_subsystem_find_listener(subsystem, &trid) == NULL) {
+			continue;
+		}
+
+		if (target != NULL) {
+			return NULL;
+		}
+		target = subsystem;
+	}
+
+	if (target == NULL) {
+		return NULL;
+	}
+
+	/* Every qpair that reaches this namespace's bdev lands on the same poll
+	 * group, and different bdevs spread over the poll groups.
+	 */
+	bdev = spdk_nvmf_ns_get_bdev(spdk_nvmf_subsystem_get_first_ns(target));
+	hash = nvmf_placement_hash(spdk_bdev_get_name(bdev));
+
+	pthread_mutex_lock(&tgt->mutex);
+	if (tgt->num_poll_groups != 0) {
+		group = nvmf_tgt_get_nth_poll_group(tgt, hash % tgt->num_poll_groups);
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	return group;
+}
+
 struct spdk_nvmf_poll_group *
 spdk_nvmf_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 {
 	struct spdk_nvmf_transport_poll_group *tgroup;
+	struct spdk_nvmf_tgt *tgt = qpair->transport->tgt;
+	struct spdk_nvmf_poll_group *group = NULL;
+
+	switch (spdk_nvmf_transport_get_qpair_placement(qpair->transport)) {
+	case SPDK_NVMF_QPAIR_PLACEMENT_LEAST_LOADED:
+		group = nvmf_place_qpair_least_loaded(tgt);
+		break;
+	case SPDK_NVMF_QPAIR_PLACEMENT_HOST:
+		group = nvmf_place_qpair_by_host(tgt, qpair);
+		break;
+	case SPDK_NVMF_QPAIR_PLACEMENT_BDEV:
+		group = nvmf_place_qpair_by_bdev(tgt, qpair);
+		break;
+	default:
+		break;
+	}
+
+	if (group != NULL) {
+		return group;
+	}
 
 	tgroup = nvmf_transport_get_optimal_poll_group(qpair->transport, qpair);
 
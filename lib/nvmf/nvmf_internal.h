@@ -48,6 +48,14 @@ enum spdk_nvmf_subsystem_state {
 
 RB_HEAD(subsystem_tree, spdk_nvmf_subsystem);
 
+#define NVMF_HOST_PLACEMENT_SLOTS	64
+
+/* Where the next qpair of a host goes with SPDK_NVMF_QPAIR_PLACEMENT_HOST */
+struct nvmf_host_placement {
+	uint32_t	hash;
+	uint32_t	next;
+};
+
 struct spdk_nvmf_tgt {
 	char					name[NVMF_TGT_NAME_MAX_LENGTH];
 
@@ -72,6 +80,9 @@ struct spdk_nvmf_tgt {
 	/* Used for round-robin assignment of connections to poll groups */
 	struct spdk_nvmf_poll_group		*next_poll_group;
 
+	/* Protected by mutex */
+	struct nvmf_host_placement		host_placement[NVMF_HOST_PLACEMENT_SLOTS];
+
 	spdk_nvmf_tgt_destroy_done_fn		*destroy_cb_fn;
 	void					*destroy_cb_arg;
 
@@ -92,6 +103,31 @@ struct spdk_nvmf_host {
 	TAILQ_ENTRY(spdk_nvmf_host)	link;
 };
 
+struct spdk_nvmf_host_qos {
+	char				nqn[SPDK_NVMF_NQN_MAX_LEN + 1];
+	struct spdk_nvmf_host_qos_opts	opts;
+	TAILQ_ENTRY(spdk_nvmf_host_qos)	link;
+};
+
+#define NVMF_CTRLR_QOS_TIMESLICE_IN_USEC	1000
+
+/*
+ * Rate limits of a host, enforced per controller. The quota is refilled every timeslice
+ * the same way the bdev layer does it, but the controller's queue pairs live on several
+ * poll groups, so the counters are updated atomically. A request may overshoot the quota,
+ * the debt is then carried over into the next timeslice.
+ */
+struct spdk_nvmf_ctrlr_qos {
+	uint32_t			weight;
+	bool				limited;
+	uint64_t			timeslice_size;
+	uint64_t			last_timeslice;
+	int64_t				ios_per_timeslice;
+	int64_t				bytes_per_timeslice;
+	int64_t				remaining_ios;
+	int64_t				remaining_bytes;
+};
+
 struct spdk_nvmf_subsystem_listener {
 	struct spdk_nvmf_subsystem			*subsystem;
 	spdk_nvmf_tgt_subsystem_listen_done_fn		cb_fn;
@@ -257,6 +293,8 @@ struct spdk_nvmf_ctrlr {
 	bool				acre_enabled;
 	bool				dynamic_ctrlr;
 
+	struct spdk_nvmf_ctrlr_qos	qos;
+
 	TAILQ_ENTRY(spdk_nvmf_ctrlr)	link;
 };
 
@@ -327,6 +365,10 @@ struct spdk_nvmf_subsystem {
 	pthread_mutex_t					mutex;
 	/* Protected against concurrent access by ->mutex */
 	TAILQ_HEAD(, spdk_nvmf_host)			hosts;
+	/* Protected against concurrent access by ->mutex */
+	TAILQ_HEAD(, spdk_nvmf_host_qos)		host_qos;
+	/* Host QoS updates sent to ->thread that haven't run yet, destruction waits for them */
+	uint32_t					host_qos_updates;
 	TAILQ_HEAD(, spdk_nvmf_subsystem_listener)	listeners;
 	struct spdk_bit_array				*used_listener_ids;
 
@@ -384,6 +426,8 @@ bool nvmf_ctrlr_write_zeroes_supported(struct spdk_nvmf_ctrlr *ctrlr);
 bool nvmf_ctrlr_copy_supported(struct spdk_nvmf_ctrlr *ctrlr);
 void nvmf_ctrlr_ns_changed(struct spdk_nvmf_ctrlr *ctrlr, uint32_t nsid);
 bool nvmf_ctrlr_use_zcopy(struct spdk_nvmf_request *req);
+void nvmf_ctrlr_qos_set(struct spdk_nvmf_ctrlr *ctrlr, const struct spdk_nvmf_host_qos_opts *opts);
+bool nvmf_ctrlr_qos_admit(struct spdk_nvmf_ctrlr *ctrlr, uint32_t length);
 
 void nvmf_bdev_ctrlr_identify_ns(struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *nsdata,
 				 bool dif_insert_or_strip);
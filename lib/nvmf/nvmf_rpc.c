@@ -2108,6 +2108,78 @@ rpc_nvmf_subsystem_allow_any_host(struct spdk_jsonrpc_request *request,
 SPDK_RPC_REGISTER("nvmf_subsystem_allow_any_host", rpc_nvmf_subsystem_allow_any_host,
 		  SPDK_RPC_RUNTIME)
 
+struct nvmf_rpc_host_qos_ctx {
+	char				*nqn;
+	char				*host;
+	char				*tgt_name;
+	struct spdk_nvmf_host_qos_opts	opts;
+};
+
+static const struct spdk_json_object_decoder nvmf_rpc_subsystem_host_qos_decoder[] = {
+	{"nqn", offsetof(struct nvmf_rpc_host_qos_ctx, nqn), spdk_json_decode_string},
+	{"host", offsetof(struct nvmf_rpc_host_qos_ctx, host), spdk_json_decode_string},
+	{"tgt_name", offsetof(struct nvmf_rpc_host_qos_ctx, tgt_name), spdk_json_decode_string, true},
+	{"weight", offsetof(struct nvmf_rpc_host_qos_ctx, opts.weight), spdk_json_decode_uint32, true},
+	{"rw_ios_per_sec", offsetof(struct nvmf_rpc_host_qos_ctx, opts.rw_ios_per_sec), spdk_json_decode_uint64, true},
+	{"rw_mbytes_per_sec", offsetof(struct nvmf_rpc_host_qos_ctx, opts.rw_mbytes_per_sec), spdk_json_decode_uint64, true},
+};
+
+static void
+nvmf_rpc_host_qos_ctx_free(struct nvmf_rpc_host_qos_ctx *ctx)
+{
+	free(ctx->nqn);
+	free(ctx->host);
+	free(ctx->tgt_name);
+}
+
+static void
+rpc_nvmf_subsystem_set_host_qos(struct spdk_jsonrpc_request *request,
+				const struct spdk_json_val *params)
+{
+	struct nvmf_rpc_host_qos_ctx ctx = {};
+	struct spdk_nvmf_subsystem *subsystem;
+	struct spdk_nvmf_tgt *tgt;
+	int rc;
+
+	if (spdk_json_decode_object(params, nvmf_rpc_subsystem_host_qos_decoder,
+				    SPDK_COUNTOF(nvmf_rpc_subsystem_host_qos_decoder),
+				    &ctx)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		nvmf_rpc_host_qos_ctx_free(&ctx);
+		return;
+	}
+
+	tgt = spdk_nvmf_get_tgt(ctx.tgt_name);
+	if (!tgt) {
+		SPDK_ERRLOG("Unable to find a target object.\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Unable to find a target.");
+		nvmf_rpc_host_qos_ctx_free(&ctx);
+		return;
+	}
+
+	subsystem = spdk_nvmf_tgt_find_subsystem(tgt, ctx.nqn);
+	if (!subsystem) {
+		SPDK_ERRLOG("Unable to find subsystem with NQN %s\n", ctx.nqn);
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		nvmf_rpc_host_qos_ctx_free(&ctx);
+		return;
+	}
+
+	rc = spdk_nvmf_subsystem_set_host_qos(subsystem, ctx.host, &ctx.opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		nvmf_rpc_host_qos_ctx_free(&ctx);
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+	nvmf_rpc_host_qos_ctx_free(&ctx);
+}
+SPDK_RPC_REGISTER("nvmf_subsystem_set_host_qos", rpc_nvmf_subsystem_set_host_qos,
+		  SPDK_RPC_RUNTIME)
+
 struct nvmf_rpc_target_ctx {
 	char *name;
 	uint32_t max_subsystems;
@@ -2582,6 +2654,66 @@ rpc_nvmf_get_transports(struct spdk_jsonrpc_request *request,
 }
 SPDK_RPC_REGISTER("nvmf_get_transports", rpc_nvmf_get_transports, SPDK_RPC_RUNTIME)
 
+struct rpc_transport_set_qpair_placement {
+	char *trtype;
+	char *tgt_name;
+	char *placement;
+};
+
+static const struct spdk_json_object_decoder rpc_transport_set_qpair_placement_decoders[] = {
+	{"trtype", offsetof(struct rpc_transport_set_qpair_placement, trtype), spdk_json_decode_string},
+	{"tgt_name", offsetof(struct rpc_transport_set_qpair_placement, tgt_name), spdk_json_decode_string, true},
+	{"placement", offsetof(struct rpc_transport_set_qpair_placement, placement), spdk_json_decode_string},
+};
+
+static void
+rpc_nvmf_transport_set_qpair_placement(struct spdk_jsonrpc_request *request,
+				       const struct spdk_json_val *params)
+{
+	struct rpc_transport_set_qpair_placement req = { 0 };
+	struct spdk_nvmf_transport *transport;
+	struct spdk_nvmf_tgt *tgt;
+	enum spdk_nvmf_qpair_placement placement;
+
+	if (spdk_json_decode_object(params, rpc_transport_set_qpair_placement_decoders,
+				    SPDK_COUNTOF(rpc_transport_set_qpair_placement_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		goto cleanup;
+	}
+
+	tgt = spdk_nvmf_get_tgt(req.tgt_name);
+	if (!tgt) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Unable to find a target.");
+		goto cleanup;
+	}
+
+	transport = spdk_nvmf_tgt_get_transport(tgt, req.trtype);
+	if (transport == NULL) {
+		SPDK_ERRLOG("transport '%s' does not exist\n", req.trtype);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	if (spdk_nvmf_qpair_placement_parse(req.placement, &placement) != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Unknown placement policy '%s'", req.placement);
+		goto cleanup;
+	}
+
+	spdk_nvmf_transport_set_qpair_placement(transport, placement);
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.trtype);
+	free(req.tgt_name);
+	free(req.placement);
+}
+SPDK_RPC_REGISTER("nvmf_transport_set_qpair_placement", rpc_nvmf_transport_set_qpair_placement,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_nvmf_get_stats_ctx {
 	char *tgt_name;
 	struct spdk_nvmf_tgt *tgt;
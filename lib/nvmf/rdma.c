@@ -2151,7 +2151,7 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 			}
 
 			rdma_req->state = RDMA_REQUEST_STATE_NEED_BUFFER;
-			STAILQ_INSERT_TAIL(&rgroup->group.pending_buf_queue, &rdma_req->req, buf_link);
+			nvmf_transport_req_queue_buf(&rgroup->group, &rdma_req->req);
 			break;
 		case RDMA_REQUEST_STATE_NEED_BUFFER:
 			spdk_trace_record(TRACE_RDMA_REQUEST_STATE_NEED_BUFFER, 0, 0,
@@ -2159,7 +2159,12 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 
 			assert(rdma_req->req.xfer != SPDK_NVME_DATA_NONE);
 
-			if (&rdma_req->req != STAILQ_FIRST(&rgroup->group.pending_buf_queue)) {
+			if (spdk_unlikely(rdma_req->req.qos_held) && !nvmf_transport_req_qos_release(&rdma_req->req)) {
+				/* The host is over its rate limits, try again in the next timeslice */
+				break;
+			}
+
+			if (&rdma_req->req != nvmf_transport_req_first_pending_buf(&rgroup->group)) {
 				/* This request needs to wait in line to obtain a buffer */
 				break;
 			}
@@ -2167,7 +2172,7 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 			/* Try to get a data buffer */
 			rc = nvmf_rdma_request_parse_sgl(rtransport, device, rdma_req);
 			if (spdk_unlikely(rc < 0)) {
-				STAILQ_REMOVE_HEAD(&rgroup->group.pending_buf_queue, buf_link);
+				nvmf_transport_req_dequeue_buf(&rgroup->group, &rdma_req->req);
 				STAILQ_INSERT_TAIL(&rqpair->pending_rdma_send_queue, rdma_req, state_link);
 				rdma_req->state = RDMA_REQUEST_STATE_READY_TO_COMPLETE_PENDING;
 				break;
@@ -2179,7 +2184,7 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 				break;
 			}
 
-			STAILQ_REMOVE_HEAD(&rgroup->group.pending_buf_queue, buf_link);
+			nvmf_transport_req_dequeue_buf(&rgroup->group, &rdma_req->req);
 
 			/* If data is transferring from host to controller and the data didn't
 			 * arrive using in capsule data, we need to do a transfer from the host.
@@ -2439,14 +2444,7 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 
 			rqpair->poller->stat.request_latency += spdk_get_ticks() - rdma_req->receive_tsc;
 			#ifdef TARGET_LATENCY_LOG
-			pthread_mutex_lock(&log_mutex);
-			struct timespec end_time;
-			struct timespec sub_time;
-			clock_gettime(CLOCK_REALTIME, &end_time);
-			timespec_sub(&sub_time, &end_time, &rdma_req->start_time);
-			timespec_add(&(module_log.target.latency_time), &(module_log.target.latency_time), &sub_time);
-			module_log.target.io_num++;
-			pthread_mutex_unlock(&log_mutex);
+			latency_module_log_record(LATENCY_MODULE_TARGET, &rdma_req->start_time);
 			#endif
 			_nvmf_rdma_request_free(rdma_req, rtransport);
 			break;
@@ -3424,7 +3422,7 @@ nvmf_rdma_poller_process_pending_buf_queue(struct spdk_nvmf_rdma_transport *rtra
 
 	STAILQ_FOREACH_SAFE(req, &rpoller->group->group.pending_buf_queue, buf_link, tmp) {
 		rdma_req = SPDK_CONTAINEROF(req, struct spdk_nvmf_rdma_request, req);
-		if (nvmf_rdma_request_process(rtransport, rdma_req) == false) {
+		if (nvmf_rdma_request_process(rtransport, rdma_req) == false && !req->qos_held) {
 			break;
 		}
 	}
@@ -269,6 +269,7 @@ spdk_nvmf_subsystem_create(struct spdk_nvmf_tgt *tgt,
 	pthread_mutex_init(&subsystem->mutex, NULL);
 	TAILQ_INIT(&subsystem->listeners);
 	TAILQ_INIT(&subsystem->hosts);
+	TAILQ_INIT(&subsystem->host_qos);
 	TAILQ_INIT(&subsystem->ctrlrs);
 	TAILQ_INIT(&subsystem->state_changes);
 	subsystem->used_listener_ids = spdk_bit_array_create(NVMF_MAX_LISTENERS_PER_SUBSYSTEM);
@@ -374,8 +375,10 @@ _nvmf_subsystem_destroy(struct spdk_nvmf_subsystem *subsystem)
 	void				*async_destroy_cb_arg = NULL;
 	int				rc;
 
-	if (!TAILQ_EMPTY(&subsystem->ctrlrs)) {
-		SPDK_DEBUGLOG(nvmf, "subsystem %p %s has active controllers\n", subsystem, subsystem->subnqn);
+	if (!TAILQ_EMPTY(&subsystem->ctrlrs) ||
+	    __atomic_load_n(&subsystem->host_qos_updates, __ATOMIC_ACQUIRE) != 0) {
+		SPDK_DEBUGLOG(nvmf, "subsystem %p %s has active controllers or host QoS updates\n",
+			      subsystem, subsystem->subnqn);
 		subsystem->async_destroy = true;
 		rc = spdk_thread_send_msg(subsystem->thread, _nvmf_subsystem_destroy_msg, subsystem);
 		if (rc) {
@@ -446,6 +449,7 @@ spdk_nvmf_subsystem_destroy(struct spdk_nvmf_subsystem *subsystem, nvmf_subsyste
 			    void *cpl_cb_arg)
 {
 	struct spdk_nvmf_host *host, *host_tmp;
+	struct spdk_nvmf_host_qos *host_qos, *host_qos_tmp;
 	struct spdk_nvmf_transport *transport;
 
 	if (!subsystem) {
@@ -485,6 +489,11 @@ spdk_nvmf_subsystem_destroy(struct spdk_nvmf_subsystem *subsystem, nvmf_subsyste
 		nvmf_subsystem_remove_host(subsystem, host);
 	}
 
+	TAILQ_FOREACH_SAFE(host_qos, &subsystem->host_qos, link, host_qos_tmp) {
+		TAILQ_REMOVE(&subsystem->host_qos, host_qos, link);
+		free(host_qos);
+	}
+
 	pthread_mutex_unlock(&subsystem->mutex);
 
 	subsystem->async_destroy_cb = cpl_cb;
@@ -1186,6 +1195,133 @@ spdk_nvmf_subsystem_disconnect_host(struct spdk_nvmf_subsystem *subsystem,
 	return 0;
 }
 
+/* Must hold subsystem->mutex while calling this function */
+static struct spdk_nvmf_host_qos *
+nvmf_subsystem_find_host_qos(struct spdk_nvmf_subsystem *subsystem, const char *hostnqn)
+{
+	struct spdk_nvmf_host_qos *host_qos;
+
+	TAILQ_FOREACH(host_qos, &subsystem->host_qos, link) {
+		if (strcmp(hostnqn, host_qos->nqn) == 0) {
+			return host_qos;
+		}
+	}
+
+	return NULL;
+}
+
+struct nvmf_subsystem_host_qos_ctx {
+	struct spdk_nvmf_subsystem	*subsystem;
+	char				hostnqn[SPDK_NVMF_NQN_MAX_LEN + 1];
+};
+
+static void
+_nvmf_subsystem_update_host_qos(void *_ctx)
+{
+	struct nvmf_subsystem_host_qos_ctx *ctx = _ctx;
+	struct spdk_nvmf_host_qos_opts opts;
+	struct spdk_nvmf_ctrlr *ctrlr;
+	bool found;
+
+	found = spdk_nvmf_subsystem_get_host_qos(ctx->subsystem, ctx->hostnqn, &opts) == 0;
+
+	TAILQ_FOREACH(ctrlr, &ctx->subsystem->ctrlrs, link) {
+		if (strcmp(ctrlr->hostnqn, ctx->hostnqn) == 0) {
+			nvmf_ctrlr_qos_set(ctrlr, found ? &opts : NULL);
+		}
+	}
+
+	/* Lets a destruction that is waiting for this update go on */
+	__atomic_fetch_sub(&ctx->subsystem->host_qos_updates, 1, __ATOMIC_RELEASE);
+	free(ctx);
+}
+
+int
+spdk_nvmf_subsystem_set_host_qos(struct spdk_nvmf_subsystem *subsystem, const char *hostnqn,
+				 const struct spdk_nvmf_host_qos_opts *opts)
+{
+	struct spdk_nvmf_host_qos *host_qos;
+	struct nvmf_subsystem_host_qos_ctx *ctx;
+	bool remove;
+
+	if (!nvmf_nqn_is_valid(hostnqn)) {
+		return -EINVAL;
+	}
+
+	if (subsystem->destroying) {
+		return -EBUSY;
+	}
+
+	remove = opts == NULL || (opts->weight == 0 && opts->rw_ios_per_sec == 0 &&
+				  opts->rw_mbytes_per_sec == 0);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->subsystem = subsystem;
+	snprintf(ctx->hostnqn, sizeof(ctx->hostnqn), "%s", hostnqn);
+
+	pthread_mutex_lock(&subsystem->mutex);
+
+	host_qos = nvmf_subsystem_find_host_qos(subsystem, hostnqn);
+	if (remove) {
+		if (host_qos == NULL) {
+			pthread_mutex_unlock(&subsystem->mutex);
+			free(ctx);
+			return 0;
+		}
+		TAILQ_REMOVE(&subsystem->host_qos, host_qos, link);
+		free(host_qos);
+	} else {
+		if (host_qos == NULL) {
+			host_qos = calloc(1, sizeof(*host_qos));
+			if (host_qos == NULL) {
+				pthread_mutex_unlock(&subsystem->mutex);
+				free(ctx);
+				return -ENOMEM;
+			}
+			snprintf(host_qos->nqn, sizeof(host_qos->nqn), "%s", hostnqn);
+			TAILQ_INSERT_TAIL(&subsystem->host_qos, host_qos, link);
+		}
+		host_qos->opts = *opts;
+		if (host_qos->opts.weight == 0) {
+			host_qos->opts.weight = SPDK_NVMF_HOST_QOS_DEFAULT_WEIGHT;
+		}
+	}
+
+	/* Keeps the subsystem alive until the update has run */
+	__atomic_fetch_add(&subsystem->host_qos_updates, 1, __ATOMIC_ACQ_REL);
+
+	pthread_mutex_unlock(&subsystem->mutex);
+
+	/* The controller list is only touched on the subsystem's thread */
+	spdk_thread_send_msg(subsystem->thread, _nvmf_subsystem_update_host_qos, ctx);
+
+	return 0;
+}
+
+int
+spdk_nvmf_subsystem_get_host_qos(struct spdk_nvmf_subsystem *subsystem, const char *hostnqn,
+				 struct spdk_nvmf_host_qos_opts *opts)
+{
+	struct spdk_nvmf_host_qos *host_qos;
+	int rc = -ENOENT;
+
+	pthread_mutex_lock(&subsystem->mutex);
+
+	host_qos = nvmf_subsystem_find_host_qos(subsystem, hostnqn);
+	if (host_qos != NULL) {
+		*opts = host_qos->opts;
+		rc = 0;
+	}
+
+	pthread_mutex_unlock(&subsystem->mutex);
+
+	return rc;
+}
+
 int
 spdk_nvmf_subsystem_set_allow_any_host(struct spdk_nvmf_subsystem *subsystem, bool allow_any_host)
 {
@@ -22,6 +22,7 @@
 #include "spdk_internal/sock.h"
 
 #include "nvmf_internal.h"
+#include "transport.h"
 
 #include "spdk_internal/trace_defs.h"
 
@@ -30,6 +31,20 @@
 #define SPDK_NVMF_TCP_DEFAULT_SOCK_PRIORITY 0
 #define SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM 32
 #define SPDK_NVMF_TCP_DEFAULT_SUCCESS_OPTIMIZATION true
+#define SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_IDLE_COUNT 0
+#define SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_INTERVAL_US 100
+#define SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_WAKE_EVENTS 1
+#define SPDK_NVMF_TCP_DEFAULT_REQ_POOL_MIN_PER_QPAIR 0
+
+/* Requests allocated at once when the request pool of a poll group runs dry */
+#define NVMF_TCP_REQ_POOL_CHUNK_SIZE 32
+/* Period in which the peak use of a request pool is tracked before it is shrunk to it */
+#define NVMF_TCP_REQ_POOL_SHRINK_PERIOD_US (1000 * 1000)
+/* Receive PDUs of a qpair that borrows its requests */
+#define NVMF_TCP_REQ_POOL_MIN_RECV_PDUS 8
+
+/* Maximum number of data digests chained into a single accel sequence */
+#define NVMF_TCP_DIGEST_BATCH_SIZE 32
 
 #define SPDK_NVMF_TCP_MIN_IO_QUEUE_DEPTH 2
 #define SPDK_NVMF_TCP_MAX_IO_QUEUE_DEPTH 65535
@@ -46,6 +61,9 @@
 #define SPDK_NVMF_TCP_DEFAULT_BUFFER_CACHE_SIZE UINT32_MAX
 #define SPDK_NVMF_TCP_DEFAULT_DIF_INSERT_OR_STRIP false
 #define SPDK_NVMF_TCP_DEFAULT_ABORT_TIMEOUT_SEC 1
+/* In-capsule data up to this size is received into per-request buffers, larger
+ * in-capsule data is received into buffers from the shared pool. */
+#define SPDK_NVMF_TCP_MAX_ICD_BUF_SIZE 4096
 
 #define TCP_PSK_INVALID_PERMISSIONS 0177
 
@@ -219,6 +237,9 @@ struct spdk_nvmf_tcp_req  {
 	/* In-capsule data buffer */
 	uint8_t					*buf;
 
+	/* Chunk of the poll group's pool the request belongs to, NULL if owned by the qpair */
+	struct nvmf_tcp_req_chunk		*chunk;
+
 	struct spdk_nvmf_tcp_req		*fused_pair;
 
 	/*
@@ -245,6 +266,15 @@ struct spdk_nvmf_tcp_req  {
 	TAILQ_ENTRY(spdk_nvmf_tcp_req)		state_link;
 };
 
+/* Requests of a poll group's pool, with their response PDUs and in-capsule data buffers */
+struct nvmf_tcp_req_chunk {
+	struct spdk_nvmf_tcp_req		reqs[NVMF_TCP_REQ_POOL_CHUNK_SIZE];
+	struct nvme_tcp_pdu			*pdus;
+	void					*bufs;
+	uint32_t				num_free;
+	TAILQ_ENTRY(nvmf_tcp_req_chunk)		link;
+};
+
 struct spdk_nvmf_tcp_qpair {
 	struct spdk_nvmf_qpair			qpair;
 	struct spdk_nvmf_tcp_poll_group		*group;
@@ -279,11 +309,19 @@ struct spdk_nvmf_tcp_qpair {
 	struct nvme_tcp_pdu			*mgmt_pdu;
 
 	/* Arrays of in-capsule buffers, requests, and pdus.
-	 * Each array is 'resource_count' number of elements */
+	 * Each array is 'num_reqs' number of elements, which is 'resource_count' unless
+	 * the requests beyond the first 'num_reqs' are borrowed from the poll group */
 	void					*bufs;
 	struct spdk_nvmf_tcp_req		*reqs;
 	struct nvme_tcp_pdu			*pdus;
 	uint32_t				resource_count;
+	uint32_t				num_reqs;
+	/* Borrowed requests, indexed by their ttag - num_reqs - 1 */
+	struct spdk_nvmf_tcp_req		**borrowed_reqs;
+	uint32_t				*free_slots;
+	uint32_t				num_free_slots;
+	/* Size of each of the in-capsule buffers, without metadata */
+	uint32_t				icd_buf_size;
 	uint32_t				recv_buf_size;
 
 	struct spdk_nvmf_tcp_port		*port;
@@ -319,6 +357,37 @@ struct spdk_nvmf_tcp_control_msg_list {
 	STAILQ_HEAD(, spdk_nvmf_tcp_control_msg) free_msgs;
 };
 
+struct spdk_nvmf_tcp_poll_group;
+
+struct nvmf_tcp_digest_batch_pdu {
+	struct nvme_tcp_pdu			*pdu;
+	spdk_accel_completion_cb		cb_fn;
+};
+
+/* Data digests of several PDUs computed by one accel sequence */
+struct nvmf_tcp_digest_batch {
+	struct spdk_nvmf_tcp_poll_group		*tgroup;
+	struct spdk_accel_sequence		*seq;
+	uint32_t				num_pdus;
+	struct nvmf_tcp_digest_batch_pdu	pdus[NVMF_TCP_DIGEST_BATCH_SIZE];
+	STAILQ_ENTRY(nvmf_tcp_digest_batch)	link;
+};
+
+struct spdk_nvmf_tcp_poll_group_stat {
+	/* Accel sequences executed for data digests */
+	uint64_t				digest_batches;
+	/* PDUs whose data digest was computed by one of these sequences */
+	uint64_t				digest_pdus;
+	/* Switches of the adaptive polling from busy polling to interval polling */
+	uint64_t				interval_poll_enters;
+	/* ... and back */
+	uint64_t				busy_poll_enters;
+	/* Chunks of requests allocated and freed by the request pool */
+	uint64_t				req_pool_grows;
+	uint64_t				req_pool_shrinks;
+	uint64_t				req_pool_grow_failures;
+};
+
 struct spdk_nvmf_tcp_poll_group {
 	struct spdk_nvmf_transport_poll_group	group;
 	struct spdk_sock_group			*sock_group;
@@ -329,6 +398,37 @@ struct spdk_nvmf_tcp_poll_group {
 	struct spdk_io_channel			*accel_channel;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
+	/* Batch collecting the data digests of the current poll, executed at its end */
+	struct nvmf_tcp_digest_batch		*digest_batch;
+	STAILQ_HEAD(, nvmf_tcp_digest_batch)	free_digest_batches;
+	/* Batches whose sequence is executing. They keep a destroyed poll group and
+	 * its accel channel around until they complete. */
+	STAILQ_HEAD(, nvmf_tcp_digest_batch)	inflight_digest_batches;
+	bool					destroyed;
+
+	/* Adaptive polling: once idle, the poll group is marked idle, which stops the
+	 * nvmf poll group from polling it, and is polled by interval_poller instead. The
+	 * latter only exists while interval polling, so an interrupt mode reactor can
+	 * sleep on its timerfd between the intervals. */
+	struct spdk_poller			*interval_poller;
+	uint32_t				idle_polls;
+	bool					interval_polling;
+
+	/* Requests the qpairs borrow beyond their reserved ones, see req_pool_min_per_qpair */
+	TAILQ_HEAD(, nvmf_tcp_req_chunk)	req_chunks;
+	TAILQ_HEAD(, spdk_nvmf_tcp_req)		free_reqs;
+	uint32_t				num_req_chunks;
+	uint32_t				num_borrowed_reqs;
+	/* Peak of num_borrowed_reqs in the current shrink period */
+	uint32_t				max_borrowed_reqs;
+	/* Growing isn't retried until a request is returned after it failed, unless
+	 * there is none to wait for */
+	bool					req_pool_grow_failed;
+	uint64_t				req_pool_errlog_tsc;
+	struct spdk_poller			*req_pool_poller;
+
+	struct spdk_nvmf_tcp_poll_group_stat	stat;
+
 	TAILQ_ENTRY(spdk_nvmf_tcp_poll_group)	link;
 };
 
@@ -342,6 +442,14 @@ struct tcp_transport_opts {
 	bool		c2h_success;
 	uint16_t	control_msg_num;
 	uint32_t	sock_priority;
+	/* Empty polls after which a poll group switches to interval polling, 0 disables it */
+	uint32_t	adaptive_poll_idle_count;
+	uint32_t	adaptive_poll_interval_us;
+	/* Socket events within one interval that switch back to busy polling */
+	uint32_t	adaptive_poll_wake_events;
+	/* Requests reserved for each qpair, the others come from a per poll group pool that
+	 * grows and shrinks with the load. 0 preallocates max_queue_depth requests per qpair. */
+	uint32_t	req_pool_min_per_qpair;
 };
 
 struct tcp_psk_entry {
@@ -386,6 +494,22 @@ static const struct spdk_json_object_decoder tcp_transport_opts_decoder[] = {
 		"sock_priority", offsetof(struct tcp_transport_opts, sock_priority),
 		spdk_json_decode_uint32, true
 	},
+	{
+		"adaptive_poll_idle_count", offsetof(struct tcp_transport_opts, adaptive_poll_idle_count),
+		spdk_json_decode_uint32, true
+	},
+	{
+		"adaptive_poll_interval_us", offsetof(struct tcp_transport_opts, adaptive_poll_interval_us),
+		spdk_json_decode_uint32, true
+	},
+	{
+		"adaptive_poll_wake_events", offsetof(struct tcp_transport_opts, adaptive_poll_wake_events),
+		spdk_json_decode_uint32, true
+	},
+	{
+		"req_pool_min_per_qpair", offsetof(struct tcp_transport_opts, req_pool_min_per_qpair),
+		spdk_json_decode_uint32, true
+	},
 };
 
 static bool nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
@@ -423,6 +547,77 @@ nvmf_tcp_req_pdu_init(struct spdk_nvmf_tcp_req *tcp_req)
 	return tcp_req->pdu;
 }
 
+static int nvmf_tcp_req_pool_grow(struct spdk_nvmf_tcp_poll_group *tgroup);
+
+static struct spdk_nvmf_tcp_req *
+nvmf_tcp_req_borrow(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = tqpair->group;
+	struct spdk_nvmf_tcp_req *tcp_req;
+	uint32_t slot;
+
+	if (tqpair->num_free_slots == 0) {
+		return NULL;
+	}
+
+	tcp_req = TAILQ_FIRST(&tgroup->free_reqs);
+	if (tcp_req == NULL) {
+		if ((tgroup->req_pool_grow_failed && tgroup->num_borrowed_reqs != 0) ||
+		    nvmf_tcp_req_pool_grow(tgroup) != 0) {
+			return NULL;
+		}
+		tcp_req = TAILQ_FIRST(&tgroup->free_reqs);
+	}
+
+	TAILQ_REMOVE(&tgroup->free_reqs, tcp_req, state_link);
+	tcp_req->chunk->num_free--;
+	tgroup->num_borrowed_reqs++;
+	tgroup->max_borrowed_reqs = spdk_max(tgroup->max_borrowed_reqs, tgroup->num_borrowed_reqs);
+
+	slot = tqpair->free_slots[--tqpair->num_free_slots];
+	tqpair->borrowed_reqs[slot] = tcp_req;
+	tcp_req->ttag = tqpair->num_reqs + slot + 1;
+	tcp_req->req.qpair = &tqpair->qpair;
+	tcp_req->pdu->qpair = tqpair;
+
+	TAILQ_INSERT_TAIL(&tqpair->tcp_req_free_queue, tcp_req, state_link);
+	tqpair->state_cntr[TCP_REQUEST_STATE_FREE]++;
+
+	return tcp_req;
+}
+
+static void
+nvmf_tcp_req_return(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *tcp_req)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = tqpair->group;
+	uint32_t slot = tcp_req->ttag - tqpair->num_reqs - 1;
+
+	assert(tcp_req->state == TCP_REQUEST_STATE_FREE);
+	assert(tqpair->borrowed_reqs[slot] == tcp_req);
+
+	TAILQ_REMOVE(&tqpair->tcp_req_free_queue, tcp_req, state_link);
+	tqpair->state_cntr[TCP_REQUEST_STATE_FREE]--;
+	tqpair->borrowed_reqs[slot] = NULL;
+	tqpair->free_slots[tqpair->num_free_slots++] = slot;
+
+	tcp_req->chunk->num_free++;
+	tgroup->num_borrowed_reqs--;
+	tgroup->req_pool_grow_failed = false;
+	TAILQ_INSERT_HEAD(&tgroup->free_reqs, tcp_req, state_link);
+}
+
+static inline struct spdk_nvmf_tcp_req *
+nvmf_tcp_qpair_get_req_by_ttag(struct spdk_nvmf_tcp_qpair *tqpair, uint16_t ttag)
+{
+	assert(ttag != 0 && ttag <= tqpair->resource_count);
+
+	if (spdk_likely(ttag <= tqpair->num_reqs)) {
+		return &tqpair->reqs[ttag - 1];
+	}
+
+	return tqpair->borrowed_reqs[ttag - tqpair->num_reqs - 1];
+}
+
 static struct spdk_nvmf_tcp_req *
 nvmf_tcp_req_get(struct spdk_nvmf_tcp_qpair *tqpair)
 {
@@ -430,7 +625,11 @@ nvmf_tcp_req_get(struct spdk_nvmf_tcp_qpair *tqpair)
 
 	tcp_req = TAILQ_FIRST(&tqpair->tcp_req_free_queue);
 	if (spdk_unlikely(!tcp_req)) {
-		return NULL;
+		/* The reserved requests are in use, take one from the poll group */
+		tcp_req = nvmf_tcp_req_borrow(tqpair);
+		if (!tcp_req) {
+			return NULL;
+		}
 	}
 
 	memset(&tcp_req->rsp, 0, sizeof(tcp_req->rsp));
@@ -455,6 +654,10 @@ nvmf_tcp_req_put(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *t
 	TAILQ_INSERT_TAIL(&tqpair->tcp_req_free_queue, tcp_req, state_link);
 	tqpair->qpair.queue_depth--;
 	nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_FREE);
+
+	if (tcp_req->chunk != NULL) {
+		nvmf_tcp_req_return(tqpair, tcp_req);
+	}
 }
 
 static void
@@ -552,10 +755,10 @@ _nvmf_tcp_qpair_destroy(void *_tqpair)
 	assert(err == 0);
 	nvmf_tcp_cleanup_all_states(tqpair);
 
-	if (tqpair->state_cntr[TCP_REQUEST_STATE_FREE] != tqpair->resource_count) {
+	if (tqpair->state_cntr[TCP_REQUEST_STATE_FREE] != tqpair->num_reqs) {
 		SPDK_ERRLOG("tqpair(%p) free tcp request num is %u but should be %u\n", tqpair,
 			    tqpair->state_cntr[TCP_REQUEST_STATE_FREE],
-			    tqpair->resource_count);
+			    tqpair->num_reqs);
 		err++;
 	}
 
@@ -570,6 +773,8 @@ _nvmf_tcp_qpair_destroy(void *_tqpair)
 	spdk_dma_free(tqpair->pdus);
 	free(tqpair->reqs);
 	spdk_free(tqpair->bufs);
+	free(tqpair->borrowed_reqs);
+	free(tqpair->free_slots);
 	spdk_trace_unregister_owner(tqpair->qpair.trace_id);
 	free(tqpair);
 
@@ -599,6 +804,14 @@ nvmf_tcp_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json_write
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 	spdk_json_write_named_bool(w, "c2h_success", ttransport->tcp_opts.c2h_success);
 	spdk_json_write_named_uint32(w, "sock_priority", ttransport->tcp_opts.sock_priority);
+	spdk_json_write_named_uint32(w, "adaptive_poll_idle_count",
+				     ttransport->tcp_opts.adaptive_poll_idle_count);
+	spdk_json_write_named_uint32(w, "adaptive_poll_interval_us",
+				     ttransport->tcp_opts.adaptive_poll_interval_us);
+	spdk_json_write_named_uint32(w, "adaptive_poll_wake_events",
+				     ttransport->tcp_opts.adaptive_poll_wake_events);
+	spdk_json_write_named_uint32(w, "req_pool_min_per_qpair",
+				     ttransport->tcp_opts.req_pool_min_per_qpair);
 }
 
 static void
@@ -660,6 +873,10 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 	ttransport->tcp_opts.c2h_success = SPDK_NVMF_TCP_DEFAULT_SUCCESS_OPTIMIZATION;
 	ttransport->tcp_opts.sock_priority = SPDK_NVMF_TCP_DEFAULT_SOCK_PRIORITY;
 	ttransport->tcp_opts.control_msg_num = SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM;
+	ttransport->tcp_opts.adaptive_poll_idle_count = SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_IDLE_COUNT;
+	ttransport->tcp_opts.adaptive_poll_interval_us = SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_INTERVAL_US;
+	ttransport->tcp_opts.adaptive_poll_wake_events = SPDK_NVMF_TCP_DEFAULT_ADAPTIVE_POLL_WAKE_EVENTS;
+	ttransport->tcp_opts.req_pool_min_per_qpair = SPDK_NVMF_TCP_DEFAULT_REQ_POOL_MIN_PER_QPAIR;
 	if (opts->transport_specific != NULL &&
 	    spdk_json_decode_object_relaxed(opts->transport_specific, tcp_transport_opts_decoder,
 					    SPDK_COUNTOF(tcp_transport_opts_decoder),
@@ -678,7 +895,9 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     "  num_shared_buffers=%d, c2h_success=%d,\n"
 		     "  dif_insert_or_strip=%d, sock_priority=%d\n"
 		     "  abort_timeout_sec=%d, control_msg_num=%hu\n"
-		     "  ack_timeout=%d\n",
+		     "  ack_timeout=%d, adaptive_poll_idle_count=%u\n"
+		     "  adaptive_poll_interval_us=%u, adaptive_poll_wake_events=%u\n"
+		     "  req_pool_min_per_qpair=%u\n",
 		     opts->max_queue_depth,
 		     opts->max_io_size,
 		     opts->max_qpairs_per_ctrlr - 1,
@@ -691,7 +910,11 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     ttransport->tcp_opts.sock_priority,
 		     opts->abort_timeout_sec,
 		     ttransport->tcp_opts.control_msg_num,
-		     opts->ack_timeout);
+		     opts->ack_timeout,
+		     ttransport->tcp_opts.adaptive_poll_idle_count,
+		     ttransport->tcp_opts.adaptive_poll_interval_us,
+		     ttransport->tcp_opts.adaptive_poll_wake_events,
+		     ttransport->tcp_opts.req_pool_min_per_qpair);
 
 	if (ttransport->tcp_opts.sock_priority > SPDK_NVMF_TCP_DEFAULT_MAX_SOCK_PRIORITY) {
 		SPDK_ERRLOG("Unsupported socket_priority=%d, the current range is: 0 to %d\n"
@@ -701,6 +924,15 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		return NULL;
 	}
 
+	if (ttransport->tcp_opts.adaptive_poll_idle_count != 0 &&
+	    (ttransport->tcp_opts.adaptive_poll_interval_us == 0 ||
+	     ttransport->tcp_opts.adaptive_poll_wake_events == 0)) {
+		SPDK_ERRLOG("TCP param adaptive_poll_interval_us and adaptive_poll_wake_events can't be 0 "
+			    "if adaptive polling is enabled\n");
+		free(ttransport);
+		return NULL;
+	}
+
 	if (ttransport->tcp_opts.control_msg_num == 0 &&
 	    opts->in_capsule_data_size < SPDK_NVME_TCP_IN_CAPSULE_DATA_MAX_SIZE) {
 		SPDK_WARNLOG("TCP param control_msg_num can't be 0 if ICD is less than %u bytes. Using default value %u\n",
@@ -1088,9 +1320,104 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 				    "IC_RESP" : "TERM_REQ", rc, errno);
 			_pdu_write_done(pdu, rc >= 0 ? -EAGAIN : -errno);
 		}
+	} else if (spdk_unlikely(tqpair->group != NULL && tqpair->group->interval_polling)) {
+		/* The sock group, which flushes queued writes, isn't polled until the next
+		 * interval, so don't let the PDU wait for it. */
+		spdk_sock_flush(tqpair->sock);
+	}
+}
+
+static void nvmf_tcp_poll_group_free(struct spdk_nvmf_tcp_poll_group *tgroup);
+
+static void
+nvmf_tcp_digest_batch_done(void *cb_arg, int status)
+{
+	struct nvmf_tcp_digest_batch *batch = cb_arg;
+	struct spdk_nvmf_tcp_poll_group *tgroup = batch->tgroup;
+	struct nvmf_tcp_digest_batch_pdu pdus[NVMF_TCP_DIGEST_BATCH_SIZE];
+	uint32_t i, num_pdus = batch->num_pdus;
+
+	STAILQ_REMOVE(&tgroup->inflight_digest_batches, batch, nvmf_tcp_digest_batch, link);
+	if (spdk_unlikely(tgroup->destroyed)) {
+		/* The qpairs the PDUs belonged to are gone already */
+		free(batch);
+		if (STAILQ_EMPTY(&tgroup->inflight_digest_batches)) {
+			nvmf_tcp_poll_group_free(tgroup);
+		}
+		return;
+	}
+
+	/* The callbacks may start a new batch, which can reuse this one right away */
+	memcpy(pdus, batch->pdus, num_pdus * sizeof(pdus[0]));
+	batch->seq = NULL;
+	batch->num_pdus = 0;
+	STAILQ_INSERT_HEAD(&tgroup->free_digest_batches, batch, link);
+
+	for (i = 0; i < num_pdus; i++) {
+		pdus[i].cb_fn(pdus[i].pdu, status);
 	}
 }
 
+static void
+nvmf_tcp_digest_batch_flush(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	struct nvmf_tcp_digest_batch *batch = tgroup->digest_batch;
+
+	if (batch == NULL) {
+		return;
+	}
+
+	tgroup->digest_batch = NULL;
+	tgroup->stat.digest_batches++;
+	tgroup->stat.digest_pdus += batch->num_pdus;
+	STAILQ_INSERT_TAIL(&tgroup->inflight_digest_batches, batch, link);
+	spdk_accel_sequence_finish(batch->seq, nvmf_tcp_digest_batch_done, batch);
+}
+
+/* Add the data digest of a PDU to the poll group's current batch. cb_fn is called
+ * once the digest is in pdu->data_digest_crc32, at the latest after the next poll.
+ */
+static int
+nvmf_tcp_digest_batch_append(struct spdk_nvmf_tcp_poll_group *tgroup, struct nvme_tcp_pdu *pdu,
+			     spdk_accel_completion_cb cb_fn)
+{
+	struct nvmf_tcp_digest_batch *batch = tgroup->digest_batch;
+	int rc;
+
+	if (batch == NULL) {
+		batch = STAILQ_FIRST(&tgroup->free_digest_batches);
+		if (batch != NULL) {
+			STAILQ_REMOVE_HEAD(&tgroup->free_digest_batches, link);
+		} else {
+			batch = calloc(1, sizeof(*batch));
+			if (batch == NULL) {
+				return -ENOMEM;
+			}
+			batch->tgroup = tgroup;
+		}
+		tgroup->digest_batch = batch;
+	}
+
+	rc = spdk_accel_append_crc32c(&batch->seq, tgroup->accel_channel, &pdu->data_digest_crc32,
+				      pdu->data_iov, pdu->data_iovcnt, NULL, NULL, 0, NULL, NULL);
+	if (spdk_unlikely(rc != 0)) {
+		if (batch->num_pdus == 0) {
+			tgroup->digest_batch = NULL;
+			STAILQ_INSERT_HEAD(&tgroup->free_digest_batches, batch, link);
+		}
+		return rc;
+	}
+
+	batch->pdus[batch->num_pdus].pdu = pdu;
+	batch->pdus[batch->num_pdus].cb_fn = cb_fn;
+	/* While interval polling, there may not be another poll soon */
+	if (++batch->num_pdus == NVMF_TCP_DIGEST_BATCH_SIZE || spdk_unlikely(tgroup->interval_polling)) {
+		nvmf_tcp_digest_batch_flush(tgroup);
+	}
+
+	return 0;
+}
+
 static void
 data_crc32_accel_done(void *cb_arg, int status)
 {
@@ -1119,6 +1446,10 @@ pdu_data_crc32_compute(struct nvme_tcp_pdu *pdu)
 		/* Only support this limitated case for the first step */
 		if (spdk_likely(!pdu->dif_ctx && (pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT == 0)
 				&& tqpair->group)) {
+			rc = nvmf_tcp_digest_batch_append(tqpair->group, pdu, data_crc32_accel_done);
+			if (spdk_likely(rc == 0)) {
+				return;
+			}
 			rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &pdu->data_digest_crc32, pdu->data_iov,
 						       pdu->data_iovcnt, 0, data_crc32_accel_done, pdu);
 			if (spdk_likely(rc == 0)) {
@@ -1191,30 +1522,67 @@ nvmf_tcp_qpair_write_req_pdu(struct spdk_nvmf_tcp_qpair *tqpair,
 	nvmf_tcp_qpair_write_pdu(tqpair, pdu, cb_fn, cb_arg);
 }
 
+static inline uint32_t
+nvmf_tcp_icd_buf_alloc_size(const struct spdk_nvmf_transport_opts *opts)
+{
+	/* Large in-capsule data sizes don't cost memory per request, see nvmf_tcp_req_parse_sgl() */
+	uint32_t size = spdk_min(opts->in_capsule_data_size, SPDK_NVMF_TCP_MAX_ICD_BUF_SIZE);
+
+	if (opts->dif_insert_or_strip) {
+		size = SPDK_BDEV_BUF_SIZE_WITH_MD(size);
+	}
+
+	return size;
+}
+
 static int
 nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair)
 {
-	uint32_t i;
+	uint32_t i, num_recv_pdus, min_reqs;
 	struct spdk_nvmf_transport_opts *opts;
+	struct spdk_nvmf_tcp_transport *ttransport;
 	uint32_t in_capsule_data_size;
 
 	opts = &tqpair->qpair.transport->opts;
+	ttransport = SPDK_CONTAINEROF(tqpair->qpair.transport, struct spdk_nvmf_tcp_transport, transport);
 
-	in_capsule_data_size = opts->in_capsule_data_size;
-	if (opts->dif_insert_or_strip) {
-		in_capsule_data_size = SPDK_BDEV_BUF_SIZE_WITH_MD(in_capsule_data_size);
-	}
+	tqpair->icd_buf_size = spdk_min(opts->in_capsule_data_size, SPDK_NVMF_TCP_MAX_ICD_BUF_SIZE);
+	in_capsule_data_size = nvmf_tcp_icd_buf_alloc_size(opts);
 
 	tqpair->resource_count = opts->max_queue_depth;
+	tqpair->num_reqs = tqpair->resource_count;
+	num_recv_pdus = tqpair->resource_count;
+
+	min_reqs = ttransport->tcp_opts.req_pool_min_per_qpair;
+	if (min_reqs != 0 && min_reqs < tqpair->resource_count) {
+		/* Only the reserved requests are allocated up front, the others are borrowed
+		 * from the poll group while the qpair is busy, see nvmf_tcp_req_borrow() */
+		tqpair->num_reqs = min_reqs;
+		num_recv_pdus = spdk_min(spdk_max(min_reqs, NVMF_TCP_REQ_POOL_MIN_RECV_PDUS),
+					 tqpair->resource_count);
+		tqpair->num_free_slots = tqpair->resource_count - min_reqs;
+
+		tqpair->borrowed_reqs = calloc(tqpair->num_free_slots, sizeof(*tqpair->borrowed_reqs));
+		tqpair->free_slots = calloc(tqpair->num_free_slots, sizeof(*tqpair->free_slots));
+		if (!tqpair->borrowed_reqs || !tqpair->free_slots) {
+			SPDK_ERRLOG("Unable to allocate borrowed reqs on tqpair=%p\n", tqpair);
+			return -1;
+		}
 
-	tqpair->reqs = calloc(tqpair->resource_count, sizeof(*tqpair->reqs));
+		/* Hand out the lowest ttags first */
+		for (i = 0; i < tqpair->num_free_slots; i++) {
+			tqpair->free_slots[i] = tqpair->num_free_slots - i - 1;
+		}
+	}
+
+	tqpair->reqs = calloc(tqpair->num_reqs, sizeof(*tqpair->reqs));
 	if (!tqpair->reqs) {
 		SPDK_ERRLOG("Unable to allocate reqs on tqpair=%p\n", tqpair);
 		return -1;
 	}
 
 	if (in_capsule_data_size) {
-		tqpair->bufs = spdk_zmalloc(tqpair->resource_count * in_capsule_data_size, 0x1000,
+		tqpair->bufs = spdk_zmalloc(tqpair->num_reqs * in_capsule_data_size, 0x1000,
 					    NULL, SPDK_ENV_LCORE_ID_ANY,
 					    SPDK_MALLOC_DMA);
 		if (!tqpair->bufs) {
@@ -1224,14 +1592,14 @@ nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair)
 	}
 	/* prepare memory space for receiving pdus and tcp_req */
 	/* Add additional 1 member, which will be used for mgmt_pdu owned by the tqpair */
-	tqpair->pdus = spdk_dma_zmalloc((2 * tqpair->resource_count + 1) * sizeof(*tqpair->pdus), 0x1000,
-					NULL);
+	tqpair->pdus = spdk_dma_zmalloc((tqpair->num_reqs + num_recv_pdus + 1) * sizeof(*tqpair->pdus),
+					0x1000, NULL);
 	if (!tqpair->pdus) {
 		SPDK_ERRLOG("Unable to allocate pdu pool on tqpair =%p.\n", tqpair);
 		return -1;
 	}
 
-	for (i = 0; i < tqpair->resource_count; i++) {
+	for (i = 0; i < tqpair->num_reqs; i++) {
 		struct spdk_nvmf_tcp_req *tcp_req = &tqpair->reqs[i];
 
 		tcp_req->ttag = i + 1;
@@ -1257,7 +1625,7 @@ nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair)
 		tqpair->state_cntr[TCP_REQUEST_STATE_FREE]++;
 	}
 
-	for (; i < 2 * tqpair->resource_count; i++) {
+	for (; i < tqpair->num_reqs + num_recv_pdus; i++) {
 		struct nvme_tcp_pdu *pdu = &tqpair->pdus[i];
 
 		pdu->qpair = tqpair;
@@ -1270,6 +1638,10 @@ nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair)
 	SLIST_REMOVE_HEAD(&tqpair->tcp_pdu_free_queue, slist);
 	tqpair->tcp_pdu_working_count = 1;
 
+	in_capsule_data_size = opts->in_capsule_data_size;
+	if (opts->dif_insert_or_strip) {
+		in_capsule_data_size = SPDK_BDEV_BUF_SIZE_WITH_MD(in_capsule_data_size);
+	}
 	tqpair->recv_buf_size = (in_capsule_data_size + sizeof(struct spdk_nvme_tcp_cmd) + 2 *
 				 SPDK_NVME_TCP_DIGEST_LEN) * SPDK_NVMF_TCP_RECV_BUF_SIZE_FACTOR;
 
@@ -1466,6 +1838,158 @@ nvmf_tcp_control_msg_list_free(struct spdk_nvmf_tcp_control_msg_list *list)
 	free(list);
 }
 
+static int nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group);
+
+static int
+nvmf_tcp_poll_group_interval_poll(void *ctx)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = ctx;
+
+	return nvmf_tcp_poll_group_poll(&tgroup->group) != 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+nvmf_tcp_poll_group_set_interval_polling(struct spdk_nvmf_tcp_poll_group *tgroup, bool enable)
+{
+	struct spdk_nvmf_tcp_transport *ttransport;
+
+	if (tgroup->interval_polling == enable) {
+		return;
+	}
+
+	tgroup->idle_polls = 0;
+	if (enable) {
+		/* Pollers are registered and unregistered rather than paused and resumed,
+		 * as a paused poller still fires in interrupt mode. */
+		ttransport = SPDK_CONTAINEROF(tgroup->group.transport, struct spdk_nvmf_tcp_transport,
+					      transport);
+		tgroup->interval_poller = SPDK_POLLER_REGISTER(nvmf_tcp_poll_group_interval_poll, tgroup,
+					  ttransport->tcp_opts.adaptive_poll_interval_us);
+		if (tgroup->interval_poller == NULL) {
+			SPDK_ERRLOG("Cannot create interval poller for tgroup=%p\n", tgroup);
+			return;
+		}
+		tgroup->stat.interval_poll_enters++;
+	} else {
+		spdk_poller_unregister(&tgroup->interval_poller);
+		tgroup->stat.busy_poll_enters++;
+	}
+
+	tgroup->interval_polling = enable;
+	spdk_nvmf_transport_poll_group_set_idle(&tgroup->group, enable);
+}
+
+static int
+nvmf_tcp_req_pool_grow(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	struct spdk_nvmf_transport_opts *opts = &tgroup->group.transport->opts;
+	struct nvmf_tcp_req_chunk *chunk;
+	uint32_t i, in_capsule_data_size;
+
+	in_capsule_data_size = nvmf_tcp_icd_buf_alloc_size(opts);
+
+	chunk = calloc(1, sizeof(*chunk));
+	if (!chunk) {
+		goto err;
+	}
+
+	chunk->pdus = spdk_dma_zmalloc(NVMF_TCP_REQ_POOL_CHUNK_SIZE * sizeof(*chunk->pdus), 0x1000, NULL);
+	if (!chunk->pdus) {
+		goto err;
+	}
+
+	if (in_capsule_data_size) {
+		chunk->bufs = spdk_zmalloc(NVMF_TCP_REQ_POOL_CHUNK_SIZE * in_capsule_data_size, 0x1000,
+					   NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+		if (!chunk->bufs) {
+			goto err;
+		}
+	}
+
+	for (i = 0; i < NVMF_TCP_REQ_POOL_CHUNK_SIZE; i++) {
+		struct spdk_nvmf_tcp_req *tcp_req = &chunk->reqs[i];
+
+		/* ttag, req.qpair and pdu->qpair are set whenever the request is borrowed */
+		tcp_req->chunk = chunk;
+		tcp_req->pdu = &chunk->pdus[i];
+		if (chunk->bufs) {
+			tcp_req->buf = (void *)((uintptr_t)chunk->bufs + (i * in_capsule_data_size));
+		}
+		tcp_req->req.rsp = (union nvmf_c2h_msg *)&tcp_req->rsp;
+		tcp_req->req.cmd = (union nvmf_h2c_msg *)&tcp_req->cmd;
+		tcp_req->req.stripped_data = NULL;
+		tcp_req->state = TCP_REQUEST_STATE_FREE;
+		TAILQ_INSERT_TAIL(&tgroup->free_reqs, tcp_req, state_link);
+	}
+
+	chunk->num_free = NVMF_TCP_REQ_POOL_CHUNK_SIZE;
+	TAILQ_INSERT_TAIL(&tgroup->req_chunks, chunk, link);
+	tgroup->num_req_chunks++;
+	tgroup->stat.req_pool_grows++;
+
+	return 0;
+err:
+	tgroup->req_pool_grow_failed = true;
+	tgroup->stat.req_pool_grow_failures++;
+	/* At most once a second, memory may stay short for a while */
+	if (spdk_get_ticks() - tgroup->req_pool_errlog_tsc >= spdk_get_ticks_hz()) {
+		tgroup->req_pool_errlog_tsc = spdk_get_ticks();
+		SPDK_ERRLOG("Unable to grow the request pool of tgroup=%p (%" PRIu64 " failures)\n",
+			    tgroup, tgroup->stat.req_pool_grow_failures);
+	}
+	if (chunk) {
+		spdk_dma_free(chunk->pdus);
+		free(chunk);
+	}
+	return -ENOMEM;
+}
+
+static void
+nvmf_tcp_req_chunk_free(struct spdk_nvmf_tcp_poll_group *tgroup, struct nvmf_tcp_req_chunk *chunk)
+{
+	uint32_t i;
+
+	assert(chunk->num_free == NVMF_TCP_REQ_POOL_CHUNK_SIZE);
+
+	for (i = 0; i < NVMF_TCP_REQ_POOL_CHUNK_SIZE; i++) {
+		TAILQ_REMOVE(&tgroup->free_reqs, &chunk->reqs[i], state_link);
+	}
+
+	TAILQ_REMOVE(&tgroup->req_chunks, chunk, link);
+	tgroup->num_req_chunks--;
+
+	spdk_free(chunk->bufs);
+	spdk_dma_free(chunk->pdus);
+	free(chunk);
+}
+
+static int
+nvmf_tcp_req_pool_shrink(void *ctx)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = ctx;
+	struct nvmf_tcp_req_chunk *chunk, *tmp;
+	uint32_t target;
+	int count = 0;
+
+	/* Keep what the busiest moment of the last period needed, plus one chunk of headroom */
+	target = tgroup->max_borrowed_reqs + NVMF_TCP_REQ_POOL_CHUNK_SIZE;
+	tgroup->max_borrowed_reqs = tgroup->num_borrowed_reqs;
+
+	TAILQ_FOREACH_SAFE(chunk, &tgroup->req_chunks, link, tmp) {
+		if (tgroup->num_req_chunks * NVMF_TCP_REQ_POOL_CHUNK_SIZE <= target) {
+			break;
+		}
+
+		if (chunk->num_free == NVMF_TCP_REQ_POOL_CHUNK_SIZE) {
+			nvmf_tcp_req_chunk_free(tgroup, chunk);
+			tgroup->stat.req_pool_shrinks++;
+			count++;
+		}
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 			   struct spdk_nvmf_poll_group *group)
@@ -1485,6 +2009,10 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 
 	TAILQ_INIT(&tgroup->qpairs);
 	TAILQ_INIT(&tgroup->await_req);
+	STAILQ_INIT(&tgroup->free_digest_batches);
+	STAILQ_INIT(&tgroup->inflight_digest_batches);
+	TAILQ_INIT(&tgroup->req_chunks);
+	TAILQ_INIT(&tgroup->free_reqs);
 
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 
@@ -1504,6 +2032,15 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 		goto cleanup;
 	}
 
+	if (ttransport->tcp_opts.req_pool_min_per_qpair != 0) {
+		tgroup->req_pool_poller = SPDK_POLLER_REGISTER(nvmf_tcp_req_pool_shrink, tgroup,
+					  NVMF_TCP_REQ_POOL_SHRINK_PERIOD_US);
+		if (!tgroup->req_pool_poller) {
+			SPDK_ERRLOG("Cannot create request pool poller for tgroup=%p\n", tgroup);
+			goto cleanup;
+		}
+	}
+
 	TAILQ_INSERT_TAIL(&ttransport->poll_groups, tgroup, link);
 	if (ttransport->next_pg == NULL) {
 		ttransport->next_pg = tgroup;
@@ -1553,26 +2090,51 @@ nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 	return spdk_sock_group_get_ctx(hint);
 }
 
+static void
+nvmf_tcp_poll_group_free(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	if (tgroup->accel_channel) {
+		spdk_put_io_channel(tgroup->accel_channel);
+	}
+
+	free(tgroup);
+}
+
 static void
 nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 {
 	struct spdk_nvmf_tcp_poll_group *tgroup, *next_tgroup;
 	struct spdk_nvmf_tcp_transport *ttransport;
+	struct nvmf_tcp_digest_batch *batch;
+	struct nvmf_tcp_req_chunk *chunk;
 
 	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	spdk_poller_unregister(&tgroup->interval_poller);
+	spdk_poller_unregister(&tgroup->req_pool_poller);
 	spdk_sock_group_close(&tgroup->sock_group);
 	if (tgroup->control_msg_list) {
 		nvmf_tcp_control_msg_list_free(tgroup->control_msg_list);
 	}
 
-	if (tgroup->accel_channel) {
-		spdk_put_io_channel(tgroup->accel_channel);
+	if (tgroup->digest_batch != NULL) {
+		/* The qpairs the PDUs belonged to are gone already */
+		spdk_accel_sequence_abort(tgroup->digest_batch->seq);
+		free(tgroup->digest_batch);
+	}
+	while ((batch = STAILQ_FIRST(&tgroup->free_digest_batches)) != NULL) {
+		STAILQ_REMOVE_HEAD(&tgroup->free_digest_batches, link);
+		free(batch);
+	}
+
+	/* The qpairs are gone, so all borrowed requests have been returned */
+	while ((chunk = TAILQ_FIRST(&tgroup->req_chunks)) != NULL) {
+		nvmf_tcp_req_chunk_free(tgroup, chunk);
 	}
 
 	if (tgroup->group.transport == NULL) {
 		/* Transport can be NULL when nvmf_tcp_poll_group_create()
 		 * calls this function directly in a failure path. */
-		free(tgroup);
+		nvmf_tcp_poll_group_free(tgroup);
 		return;
 	}
 
@@ -1587,7 +2149,14 @@ nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 		ttransport->next_pg = next_tgroup;
 	}
 
-	free(tgroup);
+	if (!STAILQ_EMPTY(&tgroup->inflight_digest_batches)) {
+		/* Sequences can't be aborted once executing, the last one to complete
+		 * frees the poll group. */
+		tgroup->destroyed = true;
+		return;
+	}
+
+	nvmf_tcp_poll_group_free(tgroup);
 }
 
 static void
@@ -1686,6 +2255,15 @@ nvmf_tcp_send_c2h_term_req(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_p
 	nvmf_tcp_qpair_write_mgmt_pdu(tqpair, nvmf_tcp_send_c2h_term_req_complete, tqpair);
 }
 
+/* Whether the request's in-capsule data fits its own buffer, so it doesn't wait
+ * in line for buffers from the shared pool. */
+static inline bool
+nvmf_tcp_req_uses_icd_buf(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *tcp_req)
+{
+	return tcp_req->has_in_capsule_data &&
+	       tcp_req->req.cmd->nvme_cmd.dptr.sgl1.unkeyed.length <= tqpair->icd_buf_size;
+}
+
 static void
 nvmf_tcp_capsule_cmd_hdr_handle(struct spdk_nvmf_tcp_transport *ttransport,
 				struct spdk_nvmf_tcp_qpair *tqpair,
@@ -1696,6 +2274,12 @@ nvmf_tcp_capsule_cmd_hdr_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	assert(pdu->psh_valid_bytes == pdu->psh_len);
 	assert(pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD);
 
+	if (spdk_unlikely(pdu->req != NULL)) {
+		/* The request of this capsule is still waiting for the buffers its in-capsule
+		 * data will be received into (e.g. a zero-copy start in progress). */
+		return;
+	}
+
 	tcp_req = nvmf_tcp_req_get(tqpair);
 	if (!tcp_req) {
 		/* Directly return and make the allocation retry again.  This can happen if we're
@@ -1709,6 +2293,11 @@ nvmf_tcp_capsule_cmd_hdr_handle(struct spdk_nvmf_tcp_transport *ttransport,
 			return;
 		}
 
+		/* The poll group's request pool couldn't grow, retry once requests are returned */
+		if (tqpair->num_free_slots != 0) {
+			return;
+		}
+
 		/* The host sent more commands than the maximum queue depth. */
 		SPDK_ERRLOG("Cannot allocate tcp_req on tqpair=%p\n", tqpair);
 		nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
@@ -1735,9 +2324,6 @@ nvmf_tcp_capsule_cmd_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	tcp_req = pdu->req;
 	assert(tcp_req != NULL);
 
-	/* Zero-copy requests don't support ICD */
-	assert(!spdk_nvmf_request_using_zcopy(&tcp_req->req));
-
 	if (capsule_cmd->common.pdo > SPDK_NVME_TCP_PDU_PDO_MAX_OFFSET) {
 		SPDK_ERRLOG("Expected ICReq capsule_cmd pdu offset <= %d, got %c\n",
 			    SPDK_NVME_TCP_PDU_PDO_MAX_OFFSET, capsule_cmd->common.pdo);
@@ -1747,7 +2333,8 @@ nvmf_tcp_capsule_cmd_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	}
 
 	rsp = &tcp_req->req.rsp->nvme_cpl;
-	if (spdk_unlikely(rsp->status.sc == SPDK_NVME_SC_COMMAND_TRANSIENT_TRANSPORT_ERROR)) {
+	if (spdk_unlikely(rsp->status.sc == SPDK_NVME_SC_COMMAND_TRANSIENT_TRANSPORT_ERROR ||
+			  tcp_req->req.zcopy_phase == NVMF_ZCOPY_PHASE_INIT_FAILED)) {
 		nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_READY_TO_COMPLETE);
 	} else {
 		nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_READY_TO_EXECUTE);
@@ -1775,18 +2362,19 @@ nvmf_tcp_h2c_data_hdr_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	SPDK_DEBUGLOG(nvmf_tcp, "tqpair=%p, r2t_info: datao=%u, datal=%u, cccid=%u, ttag=%u\n",
 		      tqpair, h2c_data->datao, h2c_data->datal, h2c_data->cccid, h2c_data->ttag);
 
-	if (h2c_data->ttag > tqpair->resource_count) {
-		SPDK_DEBUGLOG(nvmf_tcp, "ttag %u is larger than allowed %u.\n", h2c_data->ttag,
+	if (h2c_data->ttag == 0 || h2c_data->ttag > tqpair->resource_count) {
+		SPDK_DEBUGLOG(nvmf_tcp, "ttag %u is outside of the allowed range 1-%u.\n", h2c_data->ttag,
 			      tqpair->resource_count);
 		fes = SPDK_NVME_TCP_TERM_REQ_FES_PDU_SEQUENCE_ERROR;
 		error_offset = offsetof(struct spdk_nvme_tcp_h2c_data_hdr, ttag);
 		goto err;
 	}
 
-	tcp_req = &tqpair->reqs[h2c_data->ttag - 1];
+	tcp_req = nvmf_tcp_qpair_get_req_by_ttag(tqpair, h2c_data->ttag);
 
-	if (spdk_unlikely(tcp_req->state != TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER &&
-			  tcp_req->state != TCP_REQUEST_STATE_AWAITING_R2T_ACK)) {
+	if (spdk_unlikely(tcp_req == NULL ||
+			  (tcp_req->state != TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER &&
+			   tcp_req->state != TCP_REQUEST_STATE_AWAITING_R2T_ACK))) {
 		SPDK_DEBUGLOG(nvmf_tcp, "tcp_req(%p), tqpair=%p, has error state in %d\n", tcp_req, tqpair,
 			      tcp_req->state);
 		fes = SPDK_NVME_TCP_TERM_REQ_FES_INVALID_HEADER_FIELD;
@@ -2075,6 +2663,10 @@ nvmf_tcp_pdu_payload_handle(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_
 	if (pdu->ddgst_enable) {
 		if (tqpair->qpair.qid != 0 && !pdu->dif_ctx && tqpair->group &&
 		    (pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT == 0)) {
+			rc = nvmf_tcp_digest_batch_append(tqpair->group, pdu, data_crc32_calc_done);
+			if (spdk_likely(rc == 0)) {
+				return;
+			}
 			rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &pdu->data_digest_crc32, pdu->data_iov,
 						       pdu->data_iovcnt, 0, data_crc32_calc_done, pdu);
 			if (spdk_likely(rc == 0)) {
@@ -2595,6 +3187,32 @@ nvmf_tcp_req_parse_sgl(struct spdk_nvmf_tcp_req *tcp_req,
 				fes = SPDK_NVME_TCP_TERM_REQ_FES_DATA_TRANSFER_LIMIT_EXCEEDED;
 				goto fatal_err;
 			}
+		} else if (!req->dif_enabled &&
+			   length <= tqpair->icd_buf_size * SPDK_NVMF_MAX_SGL_ENTRIES &&
+			   nvmf_ctrlr_use_zcopy(req)) {
+			/* The bdev supplies the buffers and the in-capsule data is read from the
+			 * socket straight into them once the zero-copy start completes. */
+			SPDK_DEBUGLOG(nvmf_tcp, "Using zero-copy to receive in-capsule data of request %p\n",
+				      tcp_req);
+			req->length = length;
+			req->data_from_pool = false;
+			return 0;
+		} else if (length > tqpair->icd_buf_size) {
+			/* Receive the data straight into buffers from the shared pool, the
+			 * same ones an R2T transfer would have used. */
+			req->length = length;
+			if (spdk_unlikely(req->dif_enabled)) {
+				req->dif.orig_length = length;
+				length = spdk_dif_get_length_with_md(length, &req->dif.dif_ctx);
+				req->dif.elba_length = length;
+			}
+
+			if (spdk_nvmf_request_get_buffers(req, group, transport, length)) {
+				/* No available buffers. Queue this request up. */
+				SPDK_DEBUGLOG(nvmf_tcp, "No available ICD buffers. Queueing request %p\n", tcp_req);
+			}
+
+			return 0;
 		} else {
 			req->iov[0].iov_base = tcp_req->buf;
 		}
@@ -2859,6 +3477,27 @@ nvmf_tcp_check_fused_ordering(struct spdk_nvmf_tcp_transport *ttransport,
 	}
 }
 
+/* Receive the in-capsule data of a request that failed to get its zero-copy buffers
+ * into the request's own ICD buffer, overwriting it, so that it's discarded. */
+static void
+nvmf_tcp_req_drain_icd(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *tcp_req)
+{
+	uint32_t remaining = tcp_req->req.length;
+	int i;
+
+	for (i = 0; remaining > 0; i++) {
+		assert(i < SPDK_NVMF_MAX_SGL_ENTRIES);
+		tcp_req->req.iov[i].iov_base = tcp_req->buf;
+		tcp_req->req.iov[i].iov_len = spdk_min(remaining, tqpair->icd_buf_size);
+		remaining -= tcp_req->req.iov[i].iov_len;
+	}
+	tcp_req->req.iovcnt = i;
+
+	nvme_tcp_pdu_set_data_buf(tqpair->pdu_in_progress, tcp_req->req.iov, tcp_req->req.iovcnt,
+				  0, tcp_req->req.length);
+	nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD);
+}
+
 static bool
 nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 		     struct spdk_nvmf_tcp_req *tcp_req)
@@ -2942,7 +3581,7 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 			}
 
 			nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_NEED_BUFFER);
-			STAILQ_INSERT_TAIL(&group->pending_buf_queue, &tcp_req->req, buf_link);
+			nvmf_transport_req_queue_buf(group, &tcp_req->req);
 			break;
 		case TCP_REQUEST_STATE_NEED_BUFFER:
 			spdk_trace_record(TRACE_TCP_REQUEST_STATE_NEED_BUFFER, tqpair->qpair.trace_id, 0,
@@ -2950,7 +3589,13 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 
 			assert(tcp_req->req.xfer != SPDK_NVME_DATA_NONE);
 
-			if (!tcp_req->has_in_capsule_data && (&tcp_req->req != STAILQ_FIRST(&group->pending_buf_queue))) {
+			if (spdk_unlikely(tcp_req->req.qos_held) && !nvmf_transport_req_qos_release(&tcp_req->req)) {
+				/* The host is over its rate limits, try again in the next timeslice */
+				break;
+			}
+
+			if (!nvmf_tcp_req_uses_icd_buf(tqpair, tcp_req) &&
+			    &tcp_req->req != nvmf_transport_req_first_pending_buf(group)) {
 				SPDK_DEBUGLOG(nvmf_tcp,
 					      "Not the first element to wait for the buf for tcp_req(%p) on tqpair=%p\n",
 					      tcp_req, tqpair);
@@ -2970,7 +3615,7 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 					tcp_req->req.length = tcp_req->req.dif.elba_length;
 				}
 
-				STAILQ_REMOVE(&group->pending_buf_queue, &tcp_req->req, spdk_nvmf_request, buf_link);
+				nvmf_transport_req_dequeue_buf(group, &tcp_req->req);
 				nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_AWAITING_ZCOPY_START);
 				spdk_nvmf_request_zcopy_start(&tcp_req->req);
 				break;
@@ -2983,11 +3628,11 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 				break;
 			}
 
-			STAILQ_REMOVE(&group->pending_buf_queue, &tcp_req->req, spdk_nvmf_request, buf_link);
+			nvmf_transport_req_dequeue_buf(group, &tcp_req->req);
 
 			/* If data is transferring from host to controller, we need to do a transfer from the host. */
 			if (tcp_req->req.xfer == SPDK_NVME_DATA_HOST_TO_CONTROLLER) {
-				if (tcp_req->req.data_from_pool) {
+				if (!tcp_req->has_in_capsule_data) {
 					SPDK_DEBUGLOG(nvmf_tcp, "Sending R2T for tcp_req(%p) on tqpair=%p\n", tcp_req, tqpair);
 					nvmf_tcp_send_r2t_pdu(tqpair, tcp_req);
 				} else {
@@ -3020,12 +3665,26 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 			if (spdk_unlikely(spdk_nvme_cpl_is_error(&tcp_req->req.rsp->nvme_cpl))) {
 				SPDK_DEBUGLOG(nvmf_tcp, "Zero-copy start failed for tcp_req(%p) on tqpair=%p\n",
 					      tcp_req, tqpair);
+				if (tcp_req->has_in_capsule_data) {
+					/* The in-capsule data still has to be drained from the socket */
+					nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER);
+					nvmf_tcp_req_drain_icd(tqpair, tcp_req);
+					break;
+				}
 				nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_READY_TO_COMPLETE);
 				break;
 			}
 			if (tcp_req->req.xfer == SPDK_NVME_DATA_HOST_TO_CONTROLLER) {
-				SPDK_DEBUGLOG(nvmf_tcp, "Sending R2T for tcp_req(%p) on tqpair=%p\n", tcp_req, tqpair);
-				nvmf_tcp_send_r2t_pdu(tqpair, tcp_req);
+				if (tcp_req->has_in_capsule_data) {
+					/* Read the in-capsule data straight into the bdev buffers */
+					nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER);
+					nvme_tcp_pdu_set_data_buf(tqpair->pdu_in_progress, tcp_req->req.iov,
+								  tcp_req->req.iovcnt, 0, tcp_req->req.length);
+					nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD);
+				} else {
+					SPDK_DEBUGLOG(nvmf_tcp, "Sending R2T for tcp_req(%p) on tqpair=%p\n", tcp_req, tqpair);
+					nvmf_tcp_send_r2t_pdu(tqpair, tcp_req);
+				}
 			} else {
 				nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_EXECUTED);
 			}
@@ -3271,6 +3930,9 @@ nvmf_tcp_poll_group_add(struct spdk_nvmf_transport_poll_group *group,
 	nvmf_tcp_qpair_set_state(tqpair, NVME_TCP_QPAIR_STATE_INVALID);
 	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
 
+	/* Expect the connection to be set up right away */
+	nvmf_tcp_poll_group_set_interval_polling(tgroup, false);
+
 	return 0;
 }
 
@@ -3368,13 +4030,16 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 
 	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
 
+	/* Digests appended since the last poll, e.g. for data of completed reads */
+	nvmf_tcp_digest_batch_flush(tgroup);
+
 	if (spdk_unlikely(TAILQ_EMPTY(&tgroup->qpairs) && TAILQ_EMPTY(&tgroup->await_req))) {
 		return 0;
 	}
 
 	STAILQ_FOREACH_SAFE(req, &group->pending_buf_queue, buf_link, req_tmp) {
 		tcp_req = SPDK_CONTAINEROF(req, struct spdk_nvmf_tcp_req, req);
-		if (nvmf_tcp_req_process(ttransport, tcp_req) == false) {
+		if (nvmf_tcp_req_process(ttransport, tcp_req) == false && !req->qos_held) {
 			break;
 		}
 	}
@@ -3382,6 +4047,20 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 	rc = spdk_sock_group_poll(tgroup->sock_group);
 	if (rc < 0) {
 		SPDK_ERRLOG("Failed to poll sock_group=%p\n", tgroup->sock_group);
+	} else if (tgroup->interval_polling) {
+		/* Go back to busy polling once the arrival rate picks up */
+		if ((uint32_t)rc >= ttransport->tcp_opts.adaptive_poll_wake_events) {
+			nvmf_tcp_poll_group_set_interval_polling(tgroup, false);
+		}
+	} else if (ttransport->tcp_opts.adaptive_poll_idle_count != 0) {
+		/* Requests waiting for buffers and qpairs waiting for requests are only
+		 * retried by polls */
+		if (rc > 0 || !STAILQ_EMPTY(&group->pending_buf_queue) ||
+		    !TAILQ_EMPTY(&tgroup->await_req)) {
+			tgroup->idle_polls = 0;
+		} else if (++tgroup->idle_polls >= ttransport->tcp_opts.adaptive_poll_idle_count) {
+			nvmf_tcp_poll_group_set_interval_polling(tgroup, true);
+		}
 	}
 
 	TAILQ_FOREACH_SAFE(tqpair, &tgroup->await_req, link, tqpair_tmp) {
@@ -3393,9 +4072,32 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		}
 	}
 
+	nvmf_tcp_digest_batch_flush(tgroup);
+
 	return rc;
 }
 
+static void
+nvmf_tcp_poll_group_dump_stat(struct spdk_nvmf_transport_poll_group *group,
+			      struct spdk_json_write_ctx *w)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup;
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+
+	spdk_json_write_named_uint64(w, "digest_batches", tgroup->stat.digest_batches);
+	spdk_json_write_named_uint64(w, "digest_pdus", tgroup->stat.digest_pdus);
+	spdk_json_write_named_bool(w, "interval_polling", tgroup->interval_polling);
+	spdk_json_write_named_uint64(w, "interval_poll_enters", tgroup->stat.interval_poll_enters);
+	spdk_json_write_named_uint64(w, "busy_poll_enters", tgroup->stat.busy_poll_enters);
+	spdk_json_write_named_uint32(w, "req_pool_size",
+				     tgroup->num_req_chunks * NVMF_TCP_REQ_POOL_CHUNK_SIZE);
+	spdk_json_write_named_uint32(w, "req_pool_borrowed", tgroup->num_borrowed_reqs);
+	spdk_json_write_named_uint64(w, "req_pool_grows", tgroup->stat.req_pool_grows);
+	spdk_json_write_named_uint64(w, "req_pool_shrinks", tgroup->stat.req_pool_shrinks);
+	spdk_json_write_named_uint64(w, "req_pool_grow_failures", tgroup->stat.req_pool_grow_failures);
+}
+
 static int
 nvmf_tcp_qpair_get_trid(struct spdk_nvmf_qpair *qpair,
 			struct spdk_nvme_transport_id *trid, bool peer)
@@ -3519,8 +4221,7 @@ nvmf_tcp_qpair_abort_request(struct spdk_nvmf_qpair *qpair,
 	struct spdk_nvmf_tcp_transport *ttransport;
 	struct spdk_nvmf_transport *transport;
 	uint16_t cid;
-	uint32_t i;
-	struct spdk_nvmf_tcp_req *tcp_req_to_abort = NULL;
+	struct spdk_nvmf_tcp_req *tcp_req, *tcp_req_to_abort = NULL;
 
 	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
 	ttransport = SPDK_CONTAINEROF(qpair->transport, struct spdk_nvmf_tcp_transport, transport);
@@ -3528,10 +4229,9 @@ nvmf_tcp_qpair_abort_request(struct spdk_nvmf_qpair *qpair,
 
 	cid = req->cmd->nvme_cmd.cdw10_bits.abort.cid;
 
-	for (i = 0; i < tqpair->resource_count; i++) {
-		if (tqpair->reqs[i].state != TCP_REQUEST_STATE_FREE &&
-		    tqpair->reqs[i].req.cmd->nvme_cmd.cid == cid) {
-			tcp_req_to_abort = &tqpair->reqs[i];
+	TAILQ_FOREACH(tcp_req, &tqpair->tcp_req_working_queue, state_link) {
+		if (tcp_req->req.cmd->nvme_cmd.cid == cid) {
+			tcp_req_to_abort = tcp_req;
 			break;
 		}
 	}
@@ -3837,6 +4537,7 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.poll_group_add = nvmf_tcp_poll_group_add,
 	.poll_group_remove = nvmf_tcp_poll_group_remove,
 	.poll_group_poll = nvmf_tcp_poll_group_poll,
+	.poll_group_dump_stat = nvmf_tcp_poll_group_dump_stat,
 
 	.req_free = nvmf_tcp_req_free,
 	.req_complete = nvmf_tcp_req_complete,
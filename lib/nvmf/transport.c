@@ -95,6 +95,11 @@ nvmf_transport_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json
 	spdk_json_write_named_uint32(w, "abort_timeout_sec", opts->abort_timeout_sec);
 	spdk_json_write_named_uint32(w, "ack_timeout", opts->ack_timeout);
 	spdk_json_write_named_uint32(w, "data_wr_pool_size", opts->data_wr_pool_size);
+	if (!named) {
+		/* Set with its own RPC, so it's not part of nvmf_create_transport params. */
+		spdk_json_write_named_string(w, "qpair_placement",
+					     spdk_nvmf_qpair_placement_str(transport->qpair_placement));
+	}
 	spdk_json_write_object_end(w);
 }
 
@@ -122,6 +127,59 @@ spdk_nvmf_get_transport_name(struct spdk_nvmf_transport *transport)
 	return transport->ops->name;
 }
 
+static const char *const g_qpair_placement_names[] = {
+	[SPDK_NVMF_QPAIR_PLACEMENT_TRANSPORT] = "transport",
+	[SPDK_NVMF_QPAIR_PLACEMENT_LEAST_LOADED] = "least_loaded",
+	[SPDK_NVMF_QPAIR_PLACEMENT_HOST] = "host",
+	[SPDK_NVMF_QPAIR_PLACEMENT_BDEV] = "bdev",
+};
+
+const char *
+spdk_nvmf_qpair_placement_str(enum spdk_nvmf_qpair_placement placement)
+{
+	if ((uint32_t)placement >= SPDK_COUNTOF(g_qpair_placement_names)) {
+		return NULL;
+	}
+
+	return g_qpair_placement_names[placement];
+}
+
+int
+spdk_nvmf_qpair_placement_parse(const char *str, enum spdk_nvmf_qpair_placement *placement)
+{
+	uint32_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_qpair_placement_names); i++) {
+		if (strcmp(str, g_qpair_placement_names[i]) == 0) {
+			*placement = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+int
+spdk_nvmf_transport_set_qpair_placement(struct spdk_nvmf_transport *transport,
+					enum spdk_nvmf_qpair_placement placement)
+{
+	if (spdk_nvmf_qpair_placement_str(placement) == NULL) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&transport->mutex);
+	transport->qpair_placement = placement;
+	pthread_mutex_unlock(&transport->mutex);
+
+	return 0;
+}
+
+enum spdk_nvmf_qpair_placement
+spdk_nvmf_transport_get_qpair_placement(struct spdk_nvmf_transport *transport)
+{
+	return transport->qpair_placement;
+}
+
 static void
 nvmf_transport_opts_copy(struct spdk_nvmf_transport_opts *opts,
 			 struct spdk_nvmf_transport_opts *opts_src,
@@ -580,6 +638,7 @@ nvmf_transport_poll_group_create(struct spdk_nvmf_transport *transport,
 		return NULL;
 	}
 	tgroup->transport = transport;
+	tgroup->idle = false;
 
 	STAILQ_INIT(&tgroup->pending_buf_queue);
 
@@ -780,6 +839,120 @@ nvmf_transport_qpair_abort_request(struct spdk_nvmf_qpair *qpair,
 	}
 }
 
+/* Fixed cost of a request in the fair queue, so that small IOs are not free */
+#define NVMF_TRANSPORT_QOS_REQ_COST	4096
+
+static inline uint32_t
+nvmf_transport_req_sgl_length(struct spdk_nvmf_request *req)
+{
+	struct spdk_nvme_sgl_descriptor *sgl = &req->cmd->nvme_cmd.dptr.sgl1;
+
+	/* The transport hasn't parsed the SGL yet, req->length isn't valid */
+	if (sgl->generic.type == SPDK_NVME_SGL_TYPE_KEYED_DATA_BLOCK) {
+		return sgl->keyed.length;
+	}
+
+	return sgl->unkeyed.length;
+}
+
+/*
+ * Host QoS admission and weighted fair queuing happen here, when a request starts
+ *  waiting for a data buffer, not when its request object is taken from the TCP
+ *  free queue (nvmf_tcp_req_get()) or the RDMA free_queue. Request objects mostly
+ *  come from pools owned by a single queue pair, so holding them back there would
+ *  stall that queue pair's receive path without arbitrating between hosts. The
+ *  data buffers are what the queue pairs of a poll group actually contend for.
+ *
+ * Fairness is per queue pair, weighted with the weight of the queue pair's host.
+ *  The virtual time is kept per poll group, while the queue pairs of one host are
+ *  spread over several poll groups, so per host tags would need state for every
+ *  host in every poll group. A host with more queue pairs in a poll group gets
+ *  correspondingly more of its buffers. The rate limits are per host.
+ */
+void
+nvmf_transport_req_queue_buf(struct spdk_nvmf_transport_poll_group *group,
+			     struct spdk_nvmf_request *req)
+{
+	struct spdk_nvmf_qpair *qpair = req->qpair;
+	struct spdk_nvmf_ctrlr *ctrlr = qpair->ctrlr;
+	struct spdk_nvmf_request *last, *prev, *tmp;
+	uint32_t weight = SPDK_NVMF_HOST_QOS_DEFAULT_WEIGHT;
+	uint32_t length = nvmf_transport_req_sgl_length(req);
+	uint64_t start;
+
+	req->qos_held = 0;
+	if (ctrlr != NULL && !nvmf_qpair_is_admin_queue(qpair)) {
+		weight = ctrlr->qos.weight;
+		req->qos_held = !nvmf_ctrlr_qos_admit(ctrlr, length);
+	}
+
+	/*
+	 * Start-time fair queuing: a queue pair that has been idle starts at the current
+	 * virtual time, a busy one can't get ahead of its share of the buffers.
+	 */
+	start = spdk_max(group->qos_vtime, qpair->qos_finish_tag);
+	qpair->qos_finish_tag = start + ((uint64_t)length + NVMF_TRANSPORT_QOS_REQ_COST) / weight;
+	req->qos_tag = start;
+
+	last = STAILQ_LAST(&group->pending_buf_queue, spdk_nvmf_request, buf_link);
+	if (spdk_likely(last == NULL || last->qos_tag <= start)) {
+		STAILQ_INSERT_TAIL(&group->pending_buf_queue, req, buf_link);
+		return;
+	}
+
+	prev = NULL;
+	STAILQ_FOREACH(tmp, &group->pending_buf_queue, buf_link) {
+		if (tmp->qos_tag > start) {
+			break;
+		}
+		prev = tmp;
+	}
+
+	if (prev == NULL) {
+		STAILQ_INSERT_HEAD(&group->pending_buf_queue, req, buf_link);
+	} else {
+		STAILQ_INSERT_AFTER(&group->pending_buf_queue, prev, req, buf_link);
+	}
+}
+
+void
+nvmf_transport_req_dequeue_buf(struct spdk_nvmf_transport_poll_group *group,
+			       struct spdk_nvmf_request *req)
+{
+	assert(!req->qos_held);
+
+	STAILQ_REMOVE(&group->pending_buf_queue, req, spdk_nvmf_request, buf_link);
+	group->qos_vtime = spdk_max(group->qos_vtime, req->qos_tag);
+}
+
+struct spdk_nvmf_request *
+nvmf_transport_req_first_pending_buf(struct spdk_nvmf_transport_poll_group *group)
+{
+	struct spdk_nvmf_request *req;
+
+	/* Requests held back by their host's rate limits don't block the others */
+	STAILQ_FOREACH(req, &group->pending_buf_queue, buf_link) {
+		if (spdk_likely(!req->qos_held)) {
+			return req;
+		}
+	}
+
+	return NULL;
+}
+
+bool
+nvmf_transport_req_qos_release(struct spdk_nvmf_request *req)
+{
+	assert(req->qos_held);
+
+	if (!nvmf_ctrlr_qos_admit(req->qpair->ctrlr, nvmf_transport_req_sgl_length(req))) {
+		return false;
+	}
+
+	req->qos_held = 0;
+	return true;
+}
+
 bool
 spdk_nvmf_transport_opts_init(const char *transport_name,
 			      struct spdk_nvmf_transport_opts *opts, size_t opts_size)
@@ -50,6 +50,21 @@ int nvmf_transport_qpair_get_listen_trid(struct spdk_nvmf_qpair *qpair,
 void nvmf_transport_qpair_abort_request(struct spdk_nvmf_qpair *qpair,
 					struct spdk_nvmf_request *req);
 
+/* Queue a request waiting for a data buffer in the group's weighted fair order */
+void nvmf_transport_req_queue_buf(struct spdk_nvmf_transport_poll_group *group,
+				  struct spdk_nvmf_request *req);
+
+/* Remove a request that obtained its data buffer from the pending_buf_queue */
+void nvmf_transport_req_dequeue_buf(struct spdk_nvmf_transport_poll_group *group,
+				    struct spdk_nvmf_request *req);
+
+/* First request of the pending_buf_queue that isn't held by its host's rate limits */
+struct spdk_nvmf_request *nvmf_transport_req_first_pending_buf(
+	struct spdk_nvmf_transport_poll_group *group);
+
+/* Check whether a held request fits in its host's rate limits now */
+bool nvmf_transport_req_qos_release(struct spdk_nvmf_request *req);
+
 void nvmf_request_free_stripped_buffers(struct spdk_nvmf_request *req,
 					struct spdk_nvmf_transport_poll_group *group,
 					struct spdk_nvmf_transport *transport);
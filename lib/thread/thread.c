@@ -22,6 +22,10 @@
 
 #include "spdk_internal/trace_defs.h"
 
+#ifdef TARGET_LATENCY_LOG
+#include "spdk/latency_shm.h"
+#endif
+
 #ifdef __linux__
 #include <sys/timerfd.h>
 #include <sys/eventfd.h>
@@ -3112,60 +3116,59 @@ spdk_spin_held(struct spdk_spinlock *sspin)
 }
 
 #ifdef TARGET_LATENCY_LOG
-void latency_log_1s(union sigval sv){
-	pthread_mutex_lock(&log_mutex);
-	if(module_log.bdev.io_num != 0 || module_log.driver.io_num != 0 || module_log.target.io_num != 0){
-		struct latency_module_log* temp = malloc(sizeof(struct latency_module_log));
-		temp->bdev.io_num = module_log.bdev.io_num;
-		temp->driver.io_num = module_log.driver.io_num;
-		temp->target.io_num = module_log.target.io_num;
-		temp->bdev.latency_time = module_log.bdev.latency_time;
-		temp->driver.latency_time = module_log.driver.latency_time;
-		temp->target.latency_time = module_log.target.latency_time;
-		module_log.bdev.io_num = module_log.driver.io_num = module_log.target.io_num = 0;
-		module_log.bdev.latency_time.tv_sec = module_log.bdev.latency_time.tv_nsec = 0;
-		module_log.driver.latency_time.tv_sec = module_log.driver.latency_time.tv_nsec = 0;
-		module_log.target.latency_time.tv_sec = module_log.target.latency_time.tv_nsec = 0;
-		spdk_thread_send_msg(spdk_thread_get_app_thread(), write_latency_log, temp);
-	}
-	pthread_mutex_unlock(&log_mutex); 
-}
+#define LATENCY_LOG_PERIOD_US	(1000 * 1000)
 
-void init_log_fn(){
-    pthread_mutex_init(&log_mutex, NULL);
+static struct spdk_poller *g_latency_log_poller;
+
+static int
+latency_log_poll(void *ctx)
+{
+	struct latency_module_log *log;
+
+	log = malloc(sizeof(*log));
+	if (log == NULL) {
+		return SPDK_POLLER_IDLE;
+	}
 
-	module_log.bdev.io_num = module_log.driver.io_num = module_log.target.io_num = 0;
-	module_log.bdev.latency_time.tv_sec = module_log.bdev.latency_time.tv_nsec = 0;
-	module_log.driver.latency_time.tv_sec = module_log.driver.latency_time.tv_nsec = 0;
-	module_log.target.latency_time.tv_sec = module_log.target.latency_time.tv_nsec = 0;
+	if (!latency_module_log_collect(log)) {
+		free(log);
+		return SPDK_POLLER_IDLE;
+	}
 
-    timer_t timerid;
-    struct sigevent sev;
-    struct itimerspec its;
+	/* write_latency_log() frees log */
+	write_latency_log(log);
+	return SPDK_POLLER_BUSY;
+}
 
-    sev.sigev_notify = SIGEV_THREAD;
-    sev.sigev_notify_function = latency_log_1s;
-    sev.sigev_notify_attributes = NULL;
-    sev.sigev_value.sival_ptr = &module_log;
+/*
+ * Must be called on the app thread. The interval aggregation runs as a poller on
+ * that thread and pulls from the per-thread slots, so no timer thread is spawned
+ * and the reactors never contend on a lock.
+ */
+void init_log_fn(){
+	struct latency_module_log discard;
+	char shm_name[64];
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
 
-    if (timer_create(CLOCK_REALTIME, &sev, &timerid) == -1) {
-        perror("timer_create");
-        return 1;
-    }
+	/* Live counters for external monitors, the csv log below keeps working without it. */
+	snprintf(shm_name, sizeof(shm_name), "%s.%d", SPDK_LATENCY_SHM_NAME_PREFIX, (int)getpid());
+	if (spdk_latency_shm_init(shm_name) == 0) {
+		SPDK_NOTICELOG("Live latency counters published in /dev/shm%s\n", shm_name);
+	}
 
-    its.it_value.tv_sec = 1;
-    its.it_value.tv_nsec = 0;
-    its.it_interval.tv_sec = 1;
-    its.it_interval.tv_nsec = 0;
+	/* Drop whatever was recorded before the target started running. */
+	latency_module_log_collect(&discard);
 
-    if (timer_settime(timerid, 0, &its, NULL) == -1) {
-        perror("timer_settime");
-        return 1;
-    }
+	g_latency_log_poller = SPDK_POLLER_REGISTER(latency_log_poll, NULL, LATENCY_LOG_PERIOD_US);
+	if (g_latency_log_poller == NULL) {
+		SPDK_ERRLOG("Failed to register latency log poller\n");
+	}
 }
 
 void fini_log_fn(){
-    pthread_mutex_destroy(&log_mutex);
+	spdk_poller_unregister(&g_latency_log_poller);
+	spdk_latency_shm_fini();
 }
 #endif
 
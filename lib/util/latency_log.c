@@ -1,12 +1,168 @@
 #include "spdk/util.h"
-#ifdef TARGET_LATENCY_LOG
+#include "spdk/likely.h"
+
+#if defined(TARGET_LATENCY_LOG) || defined(PERF_LATENCY_LOG)
+/*
+ * Latency samples are accumulated in per-thread slots.  Each slot has a single
+ * writer (its owner thread) and a sequence counter that is odd while the writer
+ * updates it, so the collector can take a consistent copy without a lock and
+ * without stopping the IO threads.  Totals in a slot only grow; the collector
+ * keeps the last value it reported and logs the difference.
+ */
+#define LATENCY_LOG_MAX_SLOTS 128
+
+static inline void
+latency_slot_write_begin(volatile uint64_t *seq)
+{
+	(*seq)++;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
 
-pthread_mutex_t log_mutex;
+static inline void
+latency_slot_write_end(volatile uint64_t *seq)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	(*seq)++;
+}
 
-struct latency_module_log module_log;
+/* Copy len bytes of a slot's totals, retrying while the owner is writing. */
+static void
+latency_slot_read(volatile uint64_t *seq, void *dst, const void *src, size_t len)
+{
+	uint64_t start;
+
+	while (true) {
+		start = *seq;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (start & 1) {
+			continue;
+		}
+		memcpy(dst, src, len);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (*seq == start) {
+			return;
+		}
+	}
+}
+
+static void
+latency_ctx_delta(struct latency_log_ctx *delta, const struct latency_log_ctx *cur,
+		  const struct latency_log_ctx *prev)
+{
+	timespec_sub(&delta->latency_time, &cur->latency_time, &prev->latency_time);
+	delta->io_num = cur->io_num - prev->io_num;
+}
+#endif
+
+#ifdef TARGET_LATENCY_LOG
+#include "spdk/assert.h"
+#include "spdk/latency_shm.h"
+
+SPDK_STATIC_ASSERT((int)LATENCY_MODULE_TARGET == (int)SPDK_LATENCY_SHM_STAGE_TARGET &&
+		   (int)LATENCY_MODULE_BDEV == (int)SPDK_LATENCY_SHM_STAGE_BDEV &&
+		   (int)LATENCY_MODULE_DRIVER == (int)SPDK_LATENCY_SHM_STAGE_DRIVER,
+		   "latency module types must match shm stages");
+
+struct latency_module_slot {
+	volatile uint64_t seq;
+	/* Written by the owner thread only */
+	struct latency_module_log total;
+	/* Written by the collector only */
+	struct latency_module_log reported;
+} __attribute__((aligned(64)));
+
+static struct latency_module_slot g_module_slots[LATENCY_LOG_MAX_SLOTS];
+static uint32_t g_num_module_slots;
+static __thread struct latency_module_slot *t_module_slot;
 
 bool is_io_log = false;
 
+static struct latency_log_ctx *
+latency_module_ctx(struct latency_module_log *log, enum latency_module_type module)
+{
+	switch (module) {
+	case LATENCY_MODULE_TARGET:
+		return &log->target;
+	case LATENCY_MODULE_BDEV:
+		return &log->bdev;
+	case LATENCY_MODULE_DRIVER:
+	default:
+		return &log->driver;
+	}
+}
+
+static struct latency_module_slot *
+latency_module_get_slot(void)
+{
+	uint32_t index;
+
+	if (spdk_likely(t_module_slot != NULL)) {
+		return t_module_slot;
+	}
+
+	index = __atomic_fetch_add(&g_num_module_slots, 1, __ATOMIC_ACQ_REL);
+	if (index >= LATENCY_LOG_MAX_SLOTS) {
+		__atomic_store_n(&g_num_module_slots, LATENCY_LOG_MAX_SLOTS, __ATOMIC_RELEASE);
+		return NULL;
+	}
+
+	t_module_slot = &g_module_slots[index];
+	return t_module_slot;
+}
+
+void latency_module_log_record(enum latency_module_type module, const struct timespec *start_time){
+	struct latency_module_slot *slot;
+	struct latency_log_ctx *ctx;
+	struct timespec end_time;
+	struct timespec sub_time;
+
+	slot = latency_module_get_slot();
+	if (spdk_unlikely(slot == NULL)) {
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &end_time);
+	timespec_sub(&sub_time, &end_time, start_time);
+
+	ctx = latency_module_ctx(&slot->total, module);
+	latency_slot_write_begin(&slot->seq);
+	timespec_add(&ctx->latency_time, &ctx->latency_time, &sub_time);
+	ctx->io_num++;
+	latency_slot_write_end(&slot->seq);
+
+	spdk_latency_shm_record((enum spdk_latency_shm_stage)module,
+				sub_time.tv_sec * SPDK_SEC_TO_NSEC + sub_time.tv_nsec);
+}
+
+bool latency_module_log_collect(struct latency_module_log *log){
+	struct latency_module_log cur, delta;
+	struct latency_module_slot *slot;
+	uint32_t i, num_slots;
+
+	memset(log, 0, sizeof(*log));
+
+	num_slots = spdk_min(__atomic_load_n(&g_num_module_slots, __ATOMIC_ACQUIRE),
+			     LATENCY_LOG_MAX_SLOTS);
+	for (i = 0; i < num_slots; i++) {
+		slot = &g_module_slots[i];
+		latency_slot_read(&slot->seq, &cur, &slot->total, sizeof(cur));
+
+		latency_ctx_delta(&delta.target, &cur.target, &slot->reported.target);
+		latency_ctx_delta(&delta.bdev, &cur.bdev, &slot->reported.bdev);
+		latency_ctx_delta(&delta.driver, &cur.driver, &slot->reported.driver);
+		slot->reported = cur;
+
+		timespec_add(&log->target.latency_time, &log->target.latency_time, &delta.target.latency_time);
+		timespec_add(&log->bdev.latency_time, &log->bdev.latency_time, &delta.bdev.latency_time);
+		timespec_add(&log->driver.latency_time, &log->driver.latency_time, &delta.driver.latency_time);
+		log->target.io_num += delta.target.io_num;
+		log->bdev.io_num += delta.bdev.io_num;
+		log->driver.io_num += delta.driver.io_num;
+	}
+
+	return log->target.io_num != 0 || log->bdev.io_num != 0 || log->driver.io_num != 0;
+}
+
 void write_log_to_file(const char* module, struct timespec latency_time, uint32_t io_num){
     static uint64_t log_num = 0;
     if(!log_num){
@@ -40,8 +196,6 @@ void write_latency_log(void* ctx){
 static int g_print_first_create_time_flag = 1;
 static bool if_open = false;
 
-struct latency_log_msg latency_msg;
-
 bool is_prob_finish = false;
 
 void fprint_log(FILE* file, int i, int num, char* name, struct timespec latency, uint32_t io_num){
@@ -171,89 +325,157 @@ int check_msg_qnum(int msgid)
     return msg_cnt;
 }
 
-pthread_mutex_t log_mutex;
 uint32_t namespace_num;
 int msgid;
 
-void cleanup_log(){
-    for(int i = 0; i < namespace_num; i++){
-        latency_msg.latency_log_namespaces[i].task_complete_latency.io_num = latency_msg.latency_log_namespaces[i].task_queue_latency.io_num = 0;
-        latency_msg.latency_log_namespaces[i].task_complete_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].task_complete_latency.latency_time.tv_nsec = 0;
-        latency_msg.latency_log_namespaces[i].task_queue_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].task_queue_latency.latency_time.tv_nsec = 0;
-        latency_msg.latency_log_namespaces[i].req_send_latency.io_num = latency_msg.latency_log_namespaces[i].req_complete_latency.io_num = 0;
-        latency_msg.latency_log_namespaces[i].req_send_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].req_send_latency.latency_time.tv_nsec = 0;
-        latency_msg.latency_log_namespaces[i].req_complete_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].req_complete_latency.latency_time.tv_nsec = 0;
-        latency_msg.latency_log_namespaces[i].wr_send_latency.io_num = latency_msg.latency_log_namespaces[i].wr_complete_latency.io_num = 0;
-        latency_msg.latency_log_namespaces[i].wr_send_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].wr_send_latency.latency_time.tv_nsec = 0;
-        latency_msg.latency_log_namespaces[i].wr_complete_latency.latency_time.tv_sec = latency_msg.latency_log_namespaces[i].wr_complete_latency.latency_time.tv_nsec = 0;
-    }
+struct latency_ns_slot {
+	volatile uint64_t seq;
+	/* namespace_num entries each, total is written by the owner thread only */
+	struct latency_ns_log *total;
+	struct latency_ns_log *reported;
+} __attribute__((aligned(64)));
+
+static struct latency_ns_slot g_ns_slots[LATENCY_LOG_MAX_SLOTS];
+static uint32_t g_num_ns_slots;
+static __thread struct latency_ns_slot *t_ns_slot;
+
+static struct latency_ns_log *g_ns_log_copy;
+static struct timespec g_last_collect_time;
+
+/* Scratch area for threads that came too late to get a slot, never reported. */
+static __thread struct latency_ns_log *t_ns_log_overflow;
+
+struct latency_ns_log *latency_ns_log_begin(){
+	uint32_t index;
+
+	if (spdk_likely(t_ns_slot != NULL)) {
+		latency_slot_write_begin(&t_ns_slot->seq);
+		return t_ns_slot->total;
+	}
+
+	index = __atomic_fetch_add(&g_num_ns_slots, 1, __ATOMIC_ACQ_REL);
+	if (index < LATENCY_LOG_MAX_SLOTS) {
+		/* total/reported were allocated in init_log_fn() before any IO thread started */
+		t_ns_slot = &g_ns_slots[index];
+		latency_slot_write_begin(&t_ns_slot->seq);
+		return t_ns_slot->total;
+	}
+
+	__atomic_store_n(&g_num_ns_slots, LATENCY_LOG_MAX_SLOTS, __ATOMIC_RELEASE);
+	if (t_ns_log_overflow == NULL) {
+		fprintf(stderr, "Out of latency log slots, samples of this thread are dropped\n");
+		t_ns_log_overflow = calloc(namespace_num, sizeof(struct latency_ns_log));
+		assert(t_ns_log_overflow != NULL);
+	}
+	return t_ns_log_overflow;
 }
 
-void copy_latency_ns_log(struct latency_ns_log* temp){
-    for(int i = 0; i < namespace_num; i++){
-        temp[i] = latency_msg.latency_log_namespaces[i];
-    }
+void latency_ns_log_end(){
+	if (spdk_likely(t_ns_slot != NULL)) {
+		latency_slot_write_end(&t_ns_slot->seq);
+	}
 }
 
-bool is_io_num_not_empty(){
-    bool return_judge = false;
-    for(int i = 0; i < namespace_num; i++){
-        if(latency_msg.latency_log_namespaces[i].task_complete_latency.io_num != 0 || latency_msg.latency_log_namespaces[i].task_queue_latency.io_num != 0 ||
-            latency_msg.latency_log_namespaces[i].req_send_latency.io_num != 0 || latency_msg.latency_log_namespaces[i].req_complete_latency.io_num != 0 ||
-            latency_msg.latency_log_namespaces[i].wr_send_latency.io_num != 0 || latency_msg.latency_log_namespaces[i].wr_complete_latency.io_num != 0){
-            return_judge = true;
-            break;
+static bool is_io_num_not_empty(const struct latency_ns_log *log){
+    for(uint32_t i = 0; i < namespace_num; i++){
+        if(log[i].task_complete_latency.io_num != 0 || log[i].task_queue_latency.io_num != 0 ||
+            log[i].req_send_latency.io_num != 0 || log[i].req_complete_latency.io_num != 0 ||
+            log[i].wr_send_latency.io_num != 0 || log[i].wr_complete_latency.io_num != 0){
+            return true;
         }
     }
-    return return_judge;
+    return false;
 }
 
-void latency_log_1s(union sigval sv){
-	pthread_mutex_lock(&log_mutex);
-	if(is_io_num_not_empty()){
-        struct latency_log_msg latency_msg;
-        latency_msg.mtype = 1;
-        struct latency_ns_log* temp = malloc(namespace_num * sizeof(struct latency_ns_log));
-        latency_msg.latency_log_namespaces = temp;
-        copy_latency_ns_log(temp);
-        msgsnd(msgid, &latency_msg, sizeof(namespace_num * sizeof(struct latency_ns_log)), 0);
-        cleanup_log();
-	}
-	pthread_mutex_unlock(&log_mutex); 
+static void latency_ns_log_accumulate(struct latency_ns_log *sum, const struct latency_ns_log *cur,
+				      const struct latency_ns_log *prev){
+    struct latency_log_ctx delta;
+
+#define LATENCY_NS_LOG_ACCUMULATE(field) \
+    latency_ctx_delta(&delta, &cur->field, &prev->field); \
+    timespec_add(&sum->field.latency_time, &sum->field.latency_time, &delta.latency_time); \
+    sum->field.io_num += delta.io_num;
+
+    LATENCY_NS_LOG_ACCUMULATE(task_queue_latency);
+    LATENCY_NS_LOG_ACCUMULATE(task_complete_latency);
+    LATENCY_NS_LOG_ACCUMULATE(req_send_latency);
+    LATENCY_NS_LOG_ACCUMULATE(req_complete_latency);
+    LATENCY_NS_LOG_ACCUMULATE(wr_send_latency);
+    LATENCY_NS_LOG_ACCUMULATE(wr_complete_latency);
+#undef LATENCY_NS_LOG_ACCUMULATE
 }
 
-void init_log_fn(){
-    pthread_mutex_init(&log_mutex, NULL);
+void latency_log_collect(){
+    struct latency_ns_log *sum;
+    struct latency_ns_slot *slot;
+    uint32_t i, j, num_slots;
 
-    cleanup_log();
+    sum = calloc(namespace_num, sizeof(struct latency_ns_log));
+    if (sum == NULL) {
+        return;
+    }
 
-    timer_t timerid;
-    struct sigevent sev;
-    struct itimerspec its;
+    num_slots = spdk_min(__atomic_load_n(&g_num_ns_slots, __ATOMIC_ACQUIRE), LATENCY_LOG_MAX_SLOTS);
+    for (i = 0; i < num_slots; i++) {
+        slot = &g_ns_slots[i];
+        latency_slot_read(&slot->seq, g_ns_log_copy, slot->total,
+                          namespace_num * sizeof(struct latency_ns_log));
+        for (j = 0; j < namespace_num; j++) {
+            latency_ns_log_accumulate(&sum[j], &g_ns_log_copy[j], &slot->reported[j]);
+        }
+        memcpy(slot->reported, g_ns_log_copy, namespace_num * sizeof(struct latency_ns_log));
+    }
 
-    sev.sigev_notify = SIGEV_THREAD;
-    sev.sigev_notify_function = latency_log_1s;
-    sev.sigev_notify_attributes = NULL;
-    sev.sigev_value.sival_ptr = latency_msg.latency_log_namespaces;
+	if(is_io_num_not_empty(sum)){
+        struct latency_log_msg latency_msg;
+        latency_msg.mtype = 1;
+        latency_msg.latency_log_namespaces = sum;
+        msgsnd(msgid, &latency_msg, sizeof(namespace_num * sizeof(struct latency_ns_log)), 0);
+	} else {
+        free(sum);
+    }
+}
+
+void latency_log_poll(){
+    struct timespec now, elapsed;
 
-    if (timer_create(CLOCK_REALTIME, &sev, &timerid) == -1) {
-        perror("timer_create");
-        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timespec_sub(&elapsed, &now, &g_last_collect_time);
+    if (elapsed.tv_sec < 1) {
+        return;
     }
 
-    its.it_value.tv_sec = 1;
-    its.it_value.tv_nsec = 0;
-    its.it_interval.tv_sec = 1;
-    its.it_interval.tv_nsec = 0;
+    g_last_collect_time = now;
+    latency_log_collect();
+}
 
-    if (timer_settime(timerid, 0, &its, NULL) == -1) {
-        perror("timer_settime");
-        return 1;
+void init_log_fn(){
+    uint32_t i;
+
+    for (i = 0; i < LATENCY_LOG_MAX_SLOTS; i++) {
+        g_ns_slots[i].total = calloc(namespace_num, sizeof(struct latency_ns_log));
+        g_ns_slots[i].reported = calloc(namespace_num, sizeof(struct latency_ns_log));
+        if (g_ns_slots[i].total == NULL || g_ns_slots[i].reported == NULL) {
+            fprintf(stderr, "Failed to allocate latency log slots\n");
+            exit(EXIT_FAILURE);
+        }
     }
+    g_ns_log_copy = calloc(namespace_num, sizeof(struct latency_ns_log));
+    assert(g_ns_log_copy != NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &g_last_collect_time);
 }
 
 void fini_log_fn(){
-    pthread_mutex_destroy(&log_mutex);
+    uint32_t i;
+
+    for (i = 0; i < LATENCY_LOG_MAX_SLOTS; i++) {
+        free(g_ns_slots[i].total);
+        free(g_ns_slots[i].reported);
+        g_ns_slots[i].total = g_ns_slots[i].reported = NULL;
+    }
+    free(g_ns_log_copy);
+    g_ns_log_copy = NULL;
 }
 
 #endif
@@ -0,0 +1,185 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 the nof-rep authors.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/latency_shm.h"
+#include "spdk/util.h"
+
+static int g_latency_shm_fd = -1;
+static char g_latency_shm_name[64];
+static struct spdk_latency_shm_file *g_latency_shm_file;
+/* Serializes slot claims so that a slot is initialized before it's counted. */
+static pthread_mutex_t g_latency_shm_claim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Index + 1 of the slot owned by the calling thread, 0 if none claimed yet. */
+static __thread uint32_t t_latency_shm_slot;
+
+static inline uint64_t
+latency_shm_timespec_to_ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+int
+spdk_latency_shm_init(const char *shm_name)
+{
+	struct spdk_latency_shm_file *file;
+	struct timespec now;
+	uint64_t file_size;
+	uint32_t i;
+	int rc;
+
+	if (g_latency_shm_file != NULL) {
+		return -EALREADY;
+	}
+
+	file_size = SPDK_ALIGN_CEIL(sizeof(struct spdk_latency_shm_file), 64);
+	file_size += SPDK_LATENCY_SHM_MAX_SLOTS * sizeof(struct spdk_latency_shm_slot);
+
+	snprintf(g_latency_shm_name, sizeof(g_latency_shm_name), "%s", shm_name);
+
+	g_latency_shm_fd = shm_open(g_latency_shm_name, O_RDWR | O_CREAT, 0600);
+	if (g_latency_shm_fd == -1) {
+		rc = -errno;
+		fprintf(stderr, "could not shm_open %s: %s\n", g_latency_shm_name, strerror(errno));
+		return rc;
+	}
+
+	if (ftruncate(g_latency_shm_fd, file_size) != 0) {
+		rc = -errno;
+		fprintf(stderr, "could not truncate latency shm\n");
+		goto err;
+	}
+
+	file = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_latency_shm_fd, 0);
+	if (file == MAP_FAILED) {
+		rc = -errno;
+		fprintf(stderr, "could not mmap latency shm\n");
+		goto err;
+	}
+
+	memset(file, 0, file_size);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	file->version = SPDK_LATENCY_SHM_VERSION;
+	file->num_stages = SPDK_LATENCY_SHM_NUM_STAGES;
+	file->file_size = file_size;
+	file->start_ns = latency_shm_timespec_to_ns(&now);
+	file->pid = getpid();
+	file->max_slots = SPDK_LATENCY_SHM_MAX_SLOTS;
+	for (i = 0; i < SPDK_LATENCY_SHM_MAX_SLOTS; i++) {
+		file->slot_offsets[i] = SPDK_ALIGN_CEIL(sizeof(struct spdk_latency_shm_file), 64) +
+					i * sizeof(struct spdk_latency_shm_slot);
+	}
+
+	/* Publish the magic last, readers treat a segment without it as not ready. */
+	__atomic_store_n(&file->magic, SPDK_LATENCY_SHM_MAGIC, __ATOMIC_RELEASE);
+	g_latency_shm_file = file;
+
+	return 0;
+
+err:
+	close(g_latency_shm_fd);
+	g_latency_shm_fd = -1;
+	shm_unlink(g_latency_shm_name);
+	return rc;
+}
+
+void
+spdk_latency_shm_fini(void)
+{
+	if (g_latency_shm_file == NULL) {
+		return;
+	}
+
+	munmap(g_latency_shm_file, g_latency_shm_file->file_size);
+	g_latency_shm_file = NULL;
+	close(g_latency_shm_fd);
+	g_latency_shm_fd = -1;
+	shm_unlink(g_latency_shm_name);
+}
+
+const char *
+spdk_latency_shm_get_name(void)
+{
+	return g_latency_shm_file != NULL ? g_latency_shm_name : NULL;
+}
+
+const struct spdk_latency_shm_file *
+spdk_latency_shm_get_file(void)
+{
+	return g_latency_shm_file;
+}
+
+static struct spdk_latency_shm_slot *
+latency_shm_claim_slot(struct spdk_latency_shm_file *file)
+{
+	struct spdk_latency_shm_slot *slot;
+	uint32_t index, i;
+
+	pthread_mutex_lock(&g_latency_shm_claim_lock);
+	index = file->num_slots;
+	if (index >= file->max_slots) {
+		pthread_mutex_unlock(&g_latency_shm_claim_lock);
+		t_latency_shm_slot = UINT32_MAX;
+		return NULL;
+	}
+
+	slot = spdk_latency_shm_get_slot(file, index);
+	if (pthread_getname_np(pthread_self(), slot->name, sizeof(slot->name)) != 0) {
+		snprintf(slot->name, sizeof(slot->name), "thread%u", index);
+	}
+	for (i = 0; i < SPDK_LATENCY_SHM_NUM_STAGES; i++) {
+		slot->stage[i].min_ns = UINT64_MAX;
+	}
+
+	/* Readers only look at slots below num_slots, publish the slot once it's set up. */
+	__atomic_store_n(&file->num_slots, index + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_latency_shm_claim_lock);
+
+	t_latency_shm_slot = index + 1;
+
+	return slot;
+}
+
+void
+spdk_latency_shm_record(enum spdk_latency_shm_stage stage, uint64_t latency_ns)
+{
+	struct spdk_latency_shm_file *file = g_latency_shm_file;
+	struct spdk_latency_shm_stage_stats *stats;
+	struct spdk_latency_shm_slot *slot;
+
+	if (file == NULL || stage >= SPDK_LATENCY_SHM_NUM_STAGES ||
+	    t_latency_shm_slot == UINT32_MAX) {
+		return;
+	}
+
+	if (t_latency_shm_slot == 0) {
+		slot = latency_shm_claim_slot(file);
+		if (slot == NULL) {
+			return;
+		}
+	} else {
+		slot = spdk_latency_shm_get_slot(file, t_latency_shm_slot - 1);
+	}
+
+	stats = &slot->stage[stage];
+
+	/* Single writer per slot: the seqlock only protects readers from torn copies. */
+	slot->seq++;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	stats->io_num++;
+	stats->total_ns += latency_ns;
+	if (latency_ns < stats->min_ns) {
+		stats->min_ns = latency_ns;
+	}
+	if (latency_ns > stats->max_ns) {
+		stats->max_ns = latency_ns;
+	}
+	stats->buckets[spdk_latency_shm_bucket(latency_ns)]++;
+
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->seq++;
+}
@@ -164,6 +164,20 @@ bdev_null_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_
 		}
 		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
 		break;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		if (bdev_io->u.bdev.zcopy.start) {
+			/* Hand out the shared buffer, written data is dropped just like for
+			 * regular writes. */
+			if (spdk_unlikely(bdev_io->u.bdev.num_blocks * bdev->blocklen >
+					  SPDK_BDEV_LARGE_BUF_MAX_SIZE)) {
+				spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+				return;
+			}
+			spdk_bdev_io_set_buf(bdev_io, g_null_read_buf,
+					     bdev_io->u.bdev.num_blocks * bdev->blocklen);
+		}
+		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
+		break;
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 	case SPDK_BDEV_IO_TYPE_RESET:
 		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
@@ -186,6 +200,8 @@ bdev_null_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_
 static bool
 bdev_null_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
+	struct null_bdev *null_disk = ctx;
+
 	switch (io_type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -193,6 +209,9 @@ bdev_null_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_RESET:
 	case SPDK_BDEV_IO_TYPE_ABORT:
 		return true;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		/* The shared buffer carries no protection information */
+		return null_disk->bdev.dif_type == SPDK_DIF_DISABLE && null_disk->bdev.md_len == 0;
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 	default:
@@ -152,11 +152,23 @@ static struct spdk_bdev_nvme_opts g_opts = {
 	.allow_accel_sequence = false,
 	.dhchap_digests = BDEV_NVME_DEFAULT_DIGESTS,
 	.dhchap_dhgroups = BDEV_NVME_DEFAULT_DHGROUPS,
+	.fast_reconnect = false,
+	.read_ahead_kb = 0,
+	.tcp_cycle_stats = false,
+	.submit_batching = false,
 };
 
 #define NVME_HOTPLUG_POLL_PERIOD_MAX			10000000ULL
 #define NVME_HOTPLUG_POLL_PERIOD_DEFAULT		100000ULL
 
+/* Read-ahead: consecutive sequential reads before a channel starts prefetching,
+ * number of windows kept ahead of the stream, and largest window.
+ */
+#define BDEV_NVME_RA_SEQ_THRESHOLD			2
+#define BDEV_NVME_RA_DEPTH				2
+#define BDEV_NVME_RA_MAX_KB				4096
+#define BDEV_NVME_RA_STAT_FLUSH				1024
+
 static int g_hot_insert_nvme_controller_index = 0;
 static uint64_t g_nvme_hotplug_poll_period_us = NVME_HOTPLUG_POLL_PERIOD_DEFAULT;
 static bool g_nvme_hotplug_enabled = false;
@@ -521,6 +533,8 @@ nvme_ctrlr_delete(struct nvme_ctrlr *nvme_ctrlr)
 
 	/* First, unregister the adminq poller, as the driver will poll adminq if necessary */
 	spdk_poller_unregister(&nvme_ctrlr->adminq_timer_poller);
+	/* Detaching closes the eventfd of the external I/O messages */
+	bdev_nvme_ctrlr_disable_io_msg_intr(nvme_ctrlr);
 
 	/* If we got here, the reset/detach poller cannot be active */
 	assert(nvme_ctrlr->reset_detach_poller == NULL);
@@ -612,6 +626,7 @@ bdev_nvme_clear_current_io_path(struct nvme_bdev_channel *nbdev_ch)
 {
 	nbdev_ch->current_io_path = NULL;
 	nbdev_ch->rr_counter = 0;
+	nbdev_ch->lat_probe_path = NULL;
 }
 
 static struct nvme_io_path *
@@ -761,6 +776,74 @@ _bdev_nvme_delete_io_paths(struct nvme_bdev_channel *nbdev_ch)
 	}
 }
 
+static void
+bdev_nvme_ra_flush_stat(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_ra_stat *stat = &nbdev_ch->nbdev->ra_stat;
+
+	__atomic_fetch_add(&stat->hits, nbdev_ch->ra_stat.hits, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->misses, nbdev_ch->ra_stat.misses, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->prefetches, nbdev_ch->ra_stat.prefetches, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->invalidations, nbdev_ch->ra_stat.invalidations, __ATOMIC_RELAXED);
+	memset(&nbdev_ch->ra_stat, 0, sizeof(nbdev_ch->ra_stat));
+}
+
+static void
+bdev_nvme_ra_channel_fini(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_ra_slot *slot;
+	int i;
+
+	for (i = 0; i < BDEV_NVME_RA_SLOTS; i++) {
+		slot = nbdev_ch->ra_slots[i];
+		if (slot == NULL) {
+			continue;
+		}
+		nbdev_ch->ra_slots[i] = NULL;
+
+		if (slot->state == NVME_RA_SLOT_FILLING) {
+			/* The prefetch completion frees the orphaned slot. */
+			slot->nbdev_ch = NULL;
+			continue;
+		}
+		spdk_free(slot->buf);
+		free(slot);
+	}
+
+	bdev_nvme_ra_flush_stat(nbdev_ch);
+}
+
+static int
+bdev_nvme_ra_channel_init(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev *nbdev)
+{
+	uint32_t blocklen = nbdev->disk.blocklen;
+	int i;
+
+	nbdev_ch->nbdev = nbdev;
+
+	/* Metadata and PI would have to be cached and checked as well. */
+	if (g_opts.read_ahead_kb == 0 || nbdev->disk.md_len != 0) {
+		return 0;
+	}
+
+	nbdev_ch->ra_blocks = (uint32_t)((uint64_t)g_opts.read_ahead_kb * 1024 / blocklen);
+	if (nbdev_ch->ra_blocks == 0) {
+		return 0;
+	}
+
+	/* Buffers are allocated on the first prefetch into a slot. */
+	for (i = 0; i < BDEV_NVME_RA_SLOTS; i++) {
+		nbdev_ch->ra_slots[i] = calloc(1, sizeof(struct nvme_ra_slot));
+		if (nbdev_ch->ra_slots[i] == NULL) {
+			bdev_nvme_ra_channel_fini(nbdev_ch);
+			return -ENOMEM;
+		}
+		nbdev_ch->ra_slots[i]->nbdev_ch = nbdev_ch;
+	}
+
+	return 0;
+}
+
 static int
 bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 {
@@ -772,6 +855,11 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	STAILQ_INIT(&nbdev_ch->io_path_list);
 	TAILQ_INIT(&nbdev_ch->retry_io_list);
 
+	rc = bdev_nvme_ra_channel_init(nbdev_ch, nbdev);
+	if (rc != 0) {
+		return rc;
+	}
+
 	pthread_mutex_lock(&nbdev->mutex);
 
 	nbdev_ch->mp_policy = nbdev->mp_policy;
@@ -784,6 +872,7 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 			pthread_mutex_unlock(&nbdev->mutex);
 
 			_bdev_nvme_delete_io_paths(nbdev_ch);
+			bdev_nvme_ra_channel_fini(nbdev_ch);
 			return rc;
 		}
 	}
@@ -792,6 +881,41 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	return 0;
 }
 
+static inline bool
+bdev_nvme_io_type_modifies_data(enum spdk_bdev_io_type io_type)
+{
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE:
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+	case SPDK_BDEV_IO_TYPE_ZONE_APPEND:
+	case SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT:
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+	case SPDK_BDEV_IO_TYPE_NVME_IO_MD:
+	case SPDK_BDEV_IO_TYPE_COPY:
+		return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
+/* Invalidate the read-ahead buffers of all channels of the bdev. Done at both
+ * submission and completion so that a prefetch racing with the write is dropped.
+ */
+static inline void
+bdev_nvme_ra_write_gen_bump(struct spdk_bdev_io *bdev_io)
+{
+	struct nvme_bdev *nbdev = bdev_io->bdev->ctxt;
+
+	if (g_opts.read_ahead_kb != 0 && bdev_nvme_io_type_modifies_data(bdev_io->type)) {
+		__atomic_fetch_add(&nbdev->ra_write_gen, 1, __ATOMIC_RELEASE);
+	}
+}
+
 /* If cpl != NULL, complete the bdev_io with nvme status based on 'cpl'.
  * If cpl == NULL, complete the bdev_io with bdev status based on 'status'.
  */
@@ -801,16 +925,10 @@ __bdev_nvme_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status s
 {
 	spdk_trace_record(TRACE_BDEV_NVME_IO_DONE, 0, 0, (uintptr_t)bdev_io->driver_ctx,
 			  (uintptr_t)bdev_io);
+	bdev_nvme_ra_write_gen_bump(bdev_io);
 	#ifdef TARGET_LATENCY_LOG
-	pthread_mutex_lock(&log_mutex);
 	struct nvme_bdev_io *nbdev_io = (struct nvme_bdev_io *)bdev_io->driver_ctx;
-	struct timespec end_time;
-	struct timespec sub_time;
-	clock_gettime(CLOCK_REALTIME, &end_time);
-	timespec_sub(&sub_time, &end_time, &nbdev_io->start_time);
-	timespec_add(&(module_log.driver.latency_time), &(module_log.driver.latency_time), &sub_time);
-	module_log.driver.io_num++;
-	pthread_mutex_unlock(&log_mutex);
+	latency_module_log_record(LATENCY_MODULE_DRIVER, &nbdev_io->start_time);
 	#endif
 	if (cpl) {
 		spdk_bdev_io_complete_nvme_status(bdev_io, cpl->cdw0, cpl->status.sct, cpl->status.sc);
@@ -827,6 +945,7 @@ bdev_nvme_destroy_bdev_channel_cb(void *io_device, void *ctx_buf)
 	struct nvme_bdev_channel *nbdev_ch = ctx_buf;
 
 	bdev_nvme_abort_retry_ios(nbdev_ch);
+	bdev_nvme_ra_channel_fini(nbdev_ch);
 	_bdev_nvme_delete_io_paths(nbdev_ch);
 }
 
@@ -889,7 +1008,8 @@ nvme_qpair_is_connected(struct nvme_qpair *nvme_qpair)
 		return false;
 	}
 
-	if (spdk_unlikely(nvme_qpair->ctrlr_ch->reset_iter != NULL)) {
+	if (spdk_unlikely(nvme_qpair->ctrlr_ch->reset_iter != NULL ||
+			  nvme_qpair->ctrlr_ch->connect_started)) {
 		return false;
 	}
 
@@ -1064,6 +1184,109 @@ _bdev_nvme_find_io_path_min_qd(struct nvme_bdev_channel *nbdev_ch)
 	return non_optimized;
 }
 
+/* Send every Nth I/O to another path to refresh its latency estimate. */
+#define BDEV_NVME_MIN_LAT_PROBE_INTERVAL	128
+/* Leave the current path only for a path whose latency is at least 1/8 lower. */
+#define BDEV_NVME_MIN_LAT_HYSTERESIS_SHIFT	3
+/* Weight of a new sample in the latency EWMA is 1/8. */
+#define BDEV_NVME_MIN_LAT_EWMA_SHIFT		3
+
+static struct nvme_io_path *
+_bdev_nvme_find_io_path_min_latency(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_io_path *io_path, *best, *start, *current = nbdev_ch->current_io_path;
+	struct nvme_io_path *optimized = NULL, *non_optimized = NULL;
+	enum spdk_nvme_ana_state current_state = SPDK_NVME_ANA_INACCESSIBLE_STATE;
+	uint64_t threshold;
+
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		if (spdk_unlikely(!nvme_io_path_is_available(io_path))) {
+			continue;
+		}
+
+		if (io_path == current) {
+			current_state = io_path->nvme_ns->ana_state;
+		}
+
+		/* Paths without samples yet have an estimate of 0 and are tried first. */
+		switch (io_path->nvme_ns->ana_state) {
+		case SPDK_NVME_ANA_OPTIMIZED_STATE:
+			if (optimized == NULL || io_path->lat_ewma_ticks < optimized->lat_ewma_ticks) {
+				optimized = io_path;
+			}
+			break;
+		case SPDK_NVME_ANA_NON_OPTIMIZED_STATE:
+			if (non_optimized == NULL || io_path->lat_ewma_ticks < non_optimized->lat_ewma_ticks) {
+				non_optimized = io_path;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	best = optimized != NULL ? optimized : non_optimized;
+	if (spdk_unlikely(best == NULL)) {
+		nbdev_ch->current_io_path = NULL;
+		return NULL;
+	}
+
+	if (current != NULL && current != best && current_state == best->nvme_ns->ana_state) {
+		threshold = current->lat_ewma_ticks - (current->lat_ewma_ticks >> BDEV_NVME_MIN_LAT_HYSTERESIS_SHIFT);
+		if (best->lat_ewma_ticks >= threshold) {
+			best = current;
+		}
+	}
+	nbdev_ch->current_io_path = best;
+
+	/*
+	 * The estimate of a path is only updated while I/O is sent to it, so a path that
+	 *  got slow once would never be chosen again. Probe the other paths now and then.
+	 */
+	if (++nbdev_ch->lat_probe_counter >= BDEV_NVME_MIN_LAT_PROBE_INTERVAL) {
+		nbdev_ch->lat_probe_counter = 0;
+		/* Take turns from where the last probe stopped, so that io_path_list, which
+		 * is also the order of preference of the other selectors, stays as is. */
+		start = nbdev_ch->lat_probe_path != NULL ? nbdev_ch->lat_probe_path : best;
+		io_path = start;
+		do {
+			io_path = nvme_io_path_get_next(nbdev_ch, io_path);
+			if (io_path != best && nvme_io_path_is_available(io_path) &&
+			    io_path->nvme_ns->ana_state == best->nvme_ns->ana_state) {
+				nbdev_ch->lat_probe_path = io_path;
+				return io_path;
+			}
+		} while (io_path != start);
+	}
+
+	return best;
+}
+
+static inline void
+bdev_nvme_update_io_path_latency(struct nvme_bdev_io *bio)
+{
+	struct nvme_io_path *io_path = bio->io_path;
+	uint64_t tsc_diff;
+
+	/* The io_path was deleted but is kept alive for the outstanding I/Os. */
+	if (spdk_unlikely(io_path->nbdev_ch == NULL)) {
+		return;
+	}
+
+	/* Other selectors don't pay for reading the ticks. */
+	if (io_path->nbdev_ch->mp_selector != BDEV_NVME_MP_SELECTOR_MIN_LATENCY) {
+		return;
+	}
+
+	tsc_diff = spdk_get_ticks() - bio->submit_tsc;
+	if (spdk_unlikely(io_path->lat_ewma_ticks == 0)) {
+		io_path->lat_ewma_ticks = tsc_diff;
+	} else {
+		io_path->lat_ewma_ticks += (tsc_diff >> BDEV_NVME_MIN_LAT_EWMA_SHIFT) -
+					   (io_path->lat_ewma_ticks >> BDEV_NVME_MIN_LAT_EWMA_SHIFT);
+	}
+}
+
 static inline struct nvme_io_path *
 bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 {
@@ -1081,6 +1304,8 @@ bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 	if (nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE ||
 	    nbdev_ch->mp_selector == BDEV_NVME_MP_SELECTOR_ROUND_ROBIN) {
 		return _bdev_nvme_find_io_path(nbdev_ch);
+	} else if (nbdev_ch->mp_selector == BDEV_NVME_MP_SELECTOR_MIN_LATENCY) {
+		return _bdev_nvme_find_io_path_min_latency(nbdev_ch);
 	} else {
 		return _bdev_nvme_find_io_path_min_qd(nbdev_ch);
 	}
@@ -1404,6 +1629,7 @@ bdev_nvme_io_complete_nvme_status(struct nvme_bdev_io *bio,
 
 	if (spdk_likely(spdk_nvme_cpl_is_success(cpl))) {
 		bdev_nvme_update_io_path_stat(bio);
+		bdev_nvme_update_io_path_latency(bio);
 		goto complete;
 	}
 
@@ -1581,6 +1807,45 @@ nvme_poll_group_get_qpair(struct nvme_poll_group *group, struct spdk_nvme_qpair
 	return nvme_qpair;
 }
 
+/*
+ * If submit_batching is set, I/O submitted to a qpair is held in a submission
+ * batch until the poll group polls next. All I/O submitted in between then costs
+ * a single doorbell write (PCIe), ibv_post_send() (RDMA) or socket flush (TCP).
+ *
+ * I/O submitted from completion callbacks doesn't open a batch. The transport
+ * already coalesces what is submitted while it processes completions, and a
+ * batch would hold that I/O until the next poll.
+ */
+static inline void
+bdev_nvme_qpair_submit_batch_begin(struct nvme_qpair *nvme_qpair)
+{
+	if (nvme_qpair->in_submit_batch || !g_opts.submit_batching ||
+	    nvme_qpair->group->in_completions) {
+		return;
+	}
+
+	if (spdk_nvme_qpair_submit_batch_begin(nvme_qpair->qpair) == 0) {
+		nvme_qpair->in_submit_batch = true;
+		TAILQ_INSERT_TAIL(&nvme_qpair->group->batch_qpair_list, nvme_qpair, batch_tailq);
+	}
+}
+
+static void
+bdev_nvme_qpair_submit_batch_end(struct nvme_qpair *nvme_qpair)
+{
+	if (!nvme_qpair->in_submit_batch) {
+		return;
+	}
+
+	TAILQ_REMOVE(&nvme_qpair->group->batch_qpair_list, nvme_qpair, batch_tailq);
+	nvme_qpair->in_submit_batch = false;
+
+	/* A failure disconnects the qpair and completes its I/O with an error. */
+	if (nvme_qpair->qpair != NULL) {
+		spdk_nvme_qpair_submit_batch_end(nvme_qpair->qpair);
+	}
+}
+
 static void nvme_qpair_delete(struct nvme_qpair *nvme_qpair);
 
 static void
@@ -1596,6 +1861,8 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 		return;
 	}
 
+	bdev_nvme_qpair_submit_batch_end(nvme_qpair);
+
 	if (nvme_qpair->qpair != NULL) {
 		spdk_nvme_ctrlr_free_io_qpair(nvme_qpair->qpair);
 		nvme_qpair->qpair = NULL;
@@ -1622,6 +1889,12 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 			}
 			spdk_for_each_channel_continue(ctrlr_ch->reset_iter, status);
 			ctrlr_ch->reset_iter = NULL;
+		} else if (ctrlr_ch->connect_started) {
+			/* qpair was failed to connect before the reset sequence started to
+			 * wait for it. The reset sequence will find the qpair freed and abort.
+			 */
+			SPDK_DEBUGLOG(bdev_nvme, "qpair %p was failed to connect in a reset ctrlr sequence.\n",
+				      qpair);
 		} else {
 			/* qpair was disconnected unexpectedly. Reset controller for recovery. */
 			SPDK_NOTICELOG("qpair %p was disconnected and freed. reset controller.\n", qpair);
@@ -1655,14 +1928,22 @@ static int
 bdev_nvme_poll(void *arg)
 {
 	struct nvme_poll_group *group = arg;
+	struct nvme_qpair *nvme_qpair;
 	int64_t num_completions;
 
 	if (group->collect_spin_stat && group->start_ticks == 0) {
 		group->start_ticks = spdk_get_ticks();
 	}
 
+	/* Send everything submitted since the last poll before reaping completions. */
+	while ((nvme_qpair = TAILQ_FIRST(&group->batch_qpair_list)) != NULL) {
+		bdev_nvme_qpair_submit_batch_end(nvme_qpair);
+	}
+
+	group->in_completions = true;
 	num_completions = spdk_nvme_poll_group_process_completions(group->group, 0,
 			  bdev_nvme_disconnected_qpair_cb);
+	group->in_completions = false;
 	if (group->collect_spin_stat) {
 		if (num_completions > 0) {
 			if (group->end_ticks != 0) {
@@ -1722,6 +2003,57 @@ bdev_nvme_poll_adminq(void *arg)
 	return rc == 0 ? SPDK_POLLER_IDLE : SPDK_POLLER_BUSY;
 }
 
+static int
+bdev_nvme_io_msg_intr(void *arg)
+{
+	struct nvme_ctrlr *nvme_ctrlr = arg;
+	eventfd_t val;
+
+	/* Drain first. The driver rearms the producers only once it processes the messages,
+	 * so a not yet ready controller is left to the adminq poller instead of spinning here.
+	 */
+	eventfd_read(nvme_ctrlr->io_msg_fd, &val);
+
+	if (nvme_ctrlr->reconnect_is_delayed || nvme_ctrlr->disabled) {
+		/* The adminq poller is paused, the messages wait until it resumes. */
+		return SPDK_POLLER_IDLE;
+	}
+
+	return bdev_nvme_poll_adminq(nvme_ctrlr);
+}
+
+int
+bdev_nvme_ctrlr_enable_io_msg_intr(struct nvme_ctrlr *nvme_ctrlr)
+{
+	int fd;
+
+	assert(nvme_ctrlr->thread == spdk_get_thread());
+
+	if (!spdk_interrupt_mode_is_enabled() || nvme_ctrlr->io_msg_intr != NULL) {
+		return 0;
+	}
+
+	fd = spdk_nvme_ctrlr_get_io_msg_fd(nvme_ctrlr->ctrlr);
+	if (fd < 0) {
+		return fd;
+	}
+
+	nvme_ctrlr->io_msg_intr = SPDK_INTERRUPT_REGISTER(fd, bdev_nvme_io_msg_intr, nvme_ctrlr);
+	if (nvme_ctrlr->io_msg_intr == NULL) {
+		SPDK_ERRLOG("Failed to register I/O message interrupt\n");
+		return -ENOMEM;
+	}
+	nvme_ctrlr->io_msg_fd = fd;
+
+	return 0;
+}
+
+void
+bdev_nvme_ctrlr_disable_io_msg_intr(struct nvme_ctrlr *nvme_ctrlr)
+{
+	spdk_interrupt_unregister(&nvme_ctrlr->io_msg_intr);
+}
+
 static void
 nvme_bdev_free(void *io_device)
 {
@@ -2169,12 +2501,15 @@ bdev_nvme_reset_destroy_qpair(struct spdk_io_channel_iter *i)
 	nvme_qpair = ctrlr_ch->qpair;
 	assert(nvme_qpair != NULL);
 
+	ctrlr_ch->connect_started = false;
+
 	_bdev_nvme_clear_io_path_cache(nvme_qpair);
 
 	if (nvme_qpair->qpair != NULL) {
 		if (nvme_qpair->ctrlr->dont_retry) {
 			spdk_nvme_qpair_set_abort_dnr(nvme_qpair->qpair, true);
 		}
+		bdev_nvme_qpair_submit_batch_end(nvme_qpair);
 		spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->qpair);
 
 		/* The current full reset sequence will move to the next
@@ -2239,9 +2574,25 @@ bdev_nvme_reset_create_qpair(struct spdk_io_channel_iter *i)
 {
 	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
 	struct nvme_ctrlr_channel *ctrlr_ch = spdk_io_channel_get_ctx(_ch);
-	int rc;
+	int rc = 0;
+
+	if (ctrlr_ch->connect_started) {
+		ctrlr_ch->connect_started = false;
+		if (ctrlr_ch->qpair->qpair == NULL) {
+			/* qpair was already failed to connect. */
+			rc = -1;
+		} else if (spdk_nvme_qpair_is_connected(ctrlr_ch->qpair->qpair)) {
+			if (!g_opts.disable_auto_failback) {
+				_bdev_nvme_clear_io_path_cache(ctrlr_ch->qpair);
+			}
+			spdk_for_each_channel_continue(i, 0);
+			return;
+		}
+	} else {
+		/* The ctrlr_channel was created after the qpairs were started. */
+		rc = bdev_nvme_create_qpair(ctrlr_ch->qpair);
+	}
 
-	rc = bdev_nvme_create_qpair(ctrlr_ch->qpair);
 	if (rc == 0) {
 		ctrlr_ch->connect_poller = SPDK_POLLER_REGISTER(bdev_nvme_reset_check_qpair_connected,
 					   ctrlr_ch, 0);
@@ -2256,6 +2607,42 @@ bdev_nvme_reset_create_qpair(struct spdk_io_channel_iter *i)
 	}
 }
 
+static void
+bdev_nvme_reset_start_qpairs_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct nvme_ctrlr *nvme_ctrlr = spdk_io_channel_iter_get_io_device(i);
+
+	if (status != 0) {
+		bdev_nvme_reset_create_qpairs_done(i, status);
+		return;
+	}
+
+	/* All qpairs are connecting now. Wait for each of them to be connected. */
+	spdk_for_each_channel(nvme_ctrlr,
+			      bdev_nvme_reset_create_qpair,
+			      NULL,
+			      bdev_nvme_reset_create_qpairs_done);
+}
+
+/* Start connecting the qpair of each ctrlr_channel without waiting for it, so
+ * that the connects of all qpairs are in flight at the same time rather than
+ * one after another.
+ */
+static void
+bdev_nvme_reset_start_qpair(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct nvme_ctrlr_channel *ctrlr_ch = spdk_io_channel_get_ctx(_ch);
+	int rc;
+
+	rc = bdev_nvme_create_qpair(ctrlr_ch->qpair);
+	if (rc == 0) {
+		ctrlr_ch->connect_started = true;
+	}
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
 static void
 nvme_ctrlr_check_namespaces(struct nvme_ctrlr *nvme_ctrlr)
 {
@@ -2299,9 +2686,9 @@ bdev_nvme_reconnect_ctrlr_poll(void *arg)
 
 		/* Recreate all of the I/O queue pairs */
 		spdk_for_each_channel(nvme_ctrlr,
-				      bdev_nvme_reset_create_qpair,
+				      bdev_nvme_reset_start_qpair,
 				      NULL,
-				      bdev_nvme_reset_create_qpairs_done);
+				      bdev_nvme_reset_start_qpairs_done);
 	} else {
 		bdev_nvme_reset_ctrlr_complete(nvme_ctrlr, false);
 	}
@@ -2969,11 +3356,230 @@ static int bdev_nvme_copy(struct nvme_bdev_io *bio, uint64_t dst_offset_blocks,
 			  uint64_t src_offset_blocks,
 			  uint64_t num_blocks);
 
+static void
+bdev_nvme_ra_fill_done(void *ref, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_ra_slot *slot = ref;
+	struct nvme_bdev_channel *nbdev_ch = slot->nbdev_ch;
+
+	if (spdk_unlikely(nbdev_ch == NULL)) {
+		spdk_free(slot->buf);
+		free(slot);
+		return;
+	}
+
+	if (spdk_unlikely(spdk_nvme_cpl_is_error(cpl))) {
+		slot->state = NVME_RA_SLOT_EMPTY;
+		nbdev_ch->ra_next_lba = 0;
+		return;
+	}
+
+	if (slot->write_gen != __atomic_load_n(&nbdev_ch->nbdev->ra_write_gen, __ATOMIC_ACQUIRE)) {
+		slot->state = NVME_RA_SLOT_EMPTY;
+		nbdev_ch->ra_stat.invalidations++;
+		nbdev_ch->ra_next_lba = 0;
+		return;
+	}
+
+	slot->state = NVME_RA_SLOT_VALID;
+	slot->last_use = ++nbdev_ch->ra_clock;
+}
+
+static struct nvme_ra_slot *
+bdev_nvme_ra_lookup(struct nvme_bdev_channel *nbdev_ch, uint64_t lba, uint64_t num_blocks)
+{
+	struct nvme_ra_slot *slot;
+	uint64_t write_gen;
+	int i;
+
+	write_gen = __atomic_load_n(&nbdev_ch->nbdev->ra_write_gen, __ATOMIC_ACQUIRE);
+
+	for (i = 0; i < BDEV_NVME_RA_SLOTS; i++) {
+		slot = nbdev_ch->ra_slots[i];
+		if (slot->state != NVME_RA_SLOT_VALID) {
+			continue;
+		}
+
+		if (slot->write_gen != write_gen) {
+			slot->state = NVME_RA_SLOT_EMPTY;
+			nbdev_ch->ra_stat.invalidations++;
+			nbdev_ch->ra_next_lba = 0;
+			continue;
+		}
+
+		if (lba >= slot->offset_blocks &&
+		    lba + num_blocks <= slot->offset_blocks + slot->num_blocks) {
+			slot->last_use = ++nbdev_ch->ra_clock;
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+/* Prefer an empty slot, then the least recently used valid one. */
+static struct nvme_ra_slot *
+bdev_nvme_ra_get_slot(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_ra_slot *slot, *lru = NULL;
+	int i;
+
+	for (i = 0; i < BDEV_NVME_RA_SLOTS; i++) {
+		slot = nbdev_ch->ra_slots[i];
+		if (slot->state == NVME_RA_SLOT_EMPTY) {
+			return slot;
+		}
+		if (slot->state == NVME_RA_SLOT_VALID &&
+		    (lru == NULL || slot->last_use < lru->last_use)) {
+			lru = slot;
+		}
+	}
+
+	return lru;
+}
+
+static void
+bdev_nvme_ra_prefetch(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_path *io_path,
+		      uint64_t lba)
+{
+	struct nvme_bdev *nbdev = nbdev_ch->nbdev;
+	struct nvme_ra_slot *slot;
+	uint64_t num_blocks;
+	int rc;
+
+	if (lba >= nbdev->disk.blockcnt) {
+		return;
+	}
+	num_blocks = spdk_min(nbdev_ch->ra_blocks, nbdev->disk.blockcnt - lba);
+
+	slot = bdev_nvme_ra_get_slot(nbdev_ch);
+	if (slot == NULL) {
+		return;
+	}
+
+	if (slot->buf == NULL) {
+		slot->buf = spdk_zmalloc((size_t)nbdev_ch->ra_blocks * nbdev->disk.blocklen, 0x1000,
+					 NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+		if (slot->buf == NULL) {
+			return;
+		}
+	}
+
+	slot->offset_blocks = lba;
+	slot->num_blocks = num_blocks;
+	slot->write_gen = __atomic_load_n(&nbdev->ra_write_gen, __ATOMIC_ACQUIRE);
+
+	rc = spdk_nvme_ns_cmd_read(io_path->nvme_ns->ns, io_path->qpair->qpair, slot->buf,
+				   lba, num_blocks, bdev_nvme_ra_fill_done, slot, 0);
+	if (rc != 0) {
+		/* Out of requests, the stream is retried on its next read. */
+		slot->state = NVME_RA_SLOT_EMPTY;
+		return;
+	}
+
+	slot->state = NVME_RA_SLOT_FILLING;
+	nbdev_ch->ra_next_lba = lba + num_blocks;
+	nbdev_ch->ra_stat.prefetches++;
+}
+
+/* Detect sequential streams and keep BDEV_NVME_RA_DEPTH windows prefetched ahead. */
+static void
+bdev_nvme_ra_track(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_path *io_path,
+		   uint64_t lba, uint64_t num_blocks)
+{
+	uint64_t end = lba + num_blocks;
+
+	if (lba == nbdev_ch->ra_last_end) {
+		if (nbdev_ch->ra_seq_count < UINT32_MAX) {
+			nbdev_ch->ra_seq_count++;
+		}
+	} else {
+		nbdev_ch->ra_seq_count = 0;
+		nbdev_ch->ra_next_lba = 0;
+	}
+	nbdev_ch->ra_last_end = end;
+
+	if (nbdev_ch->ra_stat.hits + nbdev_ch->ra_stat.misses >= BDEV_NVME_RA_STAT_FLUSH) {
+		bdev_nvme_ra_flush_stat(nbdev_ch);
+	}
+
+	if (nbdev_ch->ra_seq_count < BDEV_NVME_RA_SEQ_THRESHOLD) {
+		return;
+	}
+
+	if (nbdev_ch->ra_next_lba < end) {
+		nbdev_ch->ra_next_lba = end;
+	}
+
+	if (nbdev_ch->ra_next_lba - end < (uint64_t)nbdev_ch->ra_blocks * BDEV_NVME_RA_DEPTH) {
+		bdev_nvme_ra_prefetch(nbdev_ch, io_path, nbdev_ch->ra_next_lba);
+	}
+}
+
+/* Serve a read from the read-ahead buffers if it fits in one of them, otherwise
+ * submit it to the namespace. Either way the read feeds stream detection.
+ */
+static int
+bdev_nvme_ra_readv(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
+		   struct spdk_bdev_io *bdev_io)
+{
+	struct nvme_io_path *io_path = bio->io_path;
+	uint64_t lba = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint32_t blocklen = bdev_io->bdev->blocklen;
+	struct nvme_ra_slot *slot;
+	int rc;
+
+	if (bdev_io->u.bdev.md_buf != NULL ||
+	    bdev_io->u.bdev.memory_domain != NULL ||
+	    bdev_io->u.bdev.accel_sequence != NULL) {
+		return bdev_nvme_readv(bio,
+				       bdev_io->u.bdev.iovs,
+				       bdev_io->u.bdev.iovcnt,
+				       bdev_io->u.bdev.md_buf,
+				       num_blocks,
+				       lba,
+				       bdev_io->u.bdev.dif_check_flags,
+				       bdev_io->u.bdev.memory_domain,
+				       bdev_io->u.bdev.memory_domain_ctx,
+				       bdev_io->u.bdev.accel_sequence);
+	}
+
+	slot = bdev_nvme_ra_lookup(nbdev_ch, lba, num_blocks);
+	if (slot != NULL) {
+		spdk_copy_buf_to_iovs(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+				      (uint8_t *)slot->buf + (lba - slot->offset_blocks) * blocklen,
+				      num_blocks * blocklen);
+		nbdev_ch->ra_stat.hits++;
+		bdev_nvme_ra_track(nbdev_ch, io_path, lba, num_blocks);
+		bdev_nvme_io_complete(bio, 0);
+		return 0;
+	}
+
+	rc = bdev_nvme_readv(bio,
+			     bdev_io->u.bdev.iovs,
+			     bdev_io->u.bdev.iovcnt,
+			     NULL,
+			     num_blocks,
+			     lba,
+			     bdev_io->u.bdev.dif_check_flags,
+			     NULL,
+			     NULL,
+			     NULL);
+	if (rc == 0) {
+		nbdev_ch->ra_stat.misses++;
+		bdev_nvme_ra_track(nbdev_ch, io_path, lba, num_blocks);
+	}
+
+	return rc;
+}
+
 static void
 bdev_nvme_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		     bool success)
 {
 	struct nvme_bdev_io *bio = (struct nvme_bdev_io *)bdev_io->driver_ctx;
+	struct nvme_bdev_channel *nbdev_ch = spdk_io_channel_get_ctx(ch);
 	int ret;
 
 	if (!success) {
@@ -2986,6 +3592,11 @@ bdev_nvme_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		goto exit;
 	}
 
+	if (nbdev_ch->ra_blocks != 0) {
+		ret = bdev_nvme_ra_readv(nbdev_ch, bio, bdev_io);
+		goto exit;
+	}
+
 	ret = bdev_nvme_readv(bio,
 			      bdev_io->u.bdev.iovs,
 			      bdev_io->u.bdev.iovcnt,
@@ -3014,6 +3625,10 @@ _bdev_nvme_submit_request(struct nvme_bdev_channel *nbdev_ch, struct spdk_bdev_i
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 		if (bdev_io->u.bdev.iovs && bdev_io->u.bdev.iovs[0].iov_base) {
+			if (nbdev_ch->ra_blocks != 0) {
+				rc = bdev_nvme_ra_readv(nbdev_ch, nbdev_io, bdev_io);
+				break;
+			}
 
 			rc = bdev_nvme_readv(nbdev_io,
 					     bdev_io->u.bdev.iovs,
@@ -3179,6 +3794,7 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 	}
 
 	spdk_trace_record(TRACE_BDEV_NVME_IO_START, 0, 0, (uintptr_t)nbdev_io, (uintptr_t)bdev_io);
+	bdev_nvme_ra_write_gen_bump(bdev_io);
 	nbdev_io->io_path = bdev_nvme_find_io_path(nbdev_ch);
 	if (spdk_unlikely(!nbdev_io->io_path)) {
 		if (!bdev_nvme_io_type_is_admin(bdev_io->type)) {
@@ -3189,6 +3805,8 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 		/* Admin commands do not use the optimal I/O path.
 		 * Simply fall through even if it is not found.
 		 */
+	} else {
+		bdev_nvme_qpair_submit_batch_begin(nbdev_io->io_path->qpair);
 	}
 
 	_bdev_nvme_submit_request(nbdev_ch, bdev_io);
@@ -3342,6 +3960,8 @@ nvme_qpair_delete(struct nvme_qpair *nvme_qpair)
 
 	assert(nvme_qpair->group != NULL);
 
+	bdev_nvme_qpair_submit_batch_end(nvme_qpair);
+
 	TAILQ_FOREACH_SAFE(io_path, &nvme_qpair->io_path_list, tailq, next) {
 		TAILQ_REMOVE(&nvme_qpair->io_path_list, io_path, tailq);
 		nvme_io_path_free(io_path);
@@ -3369,6 +3989,7 @@ bdev_nvme_destroy_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 
 	if (nvme_qpair->qpair != NULL) {
 		if (ctrlr_ch->reset_iter == NULL) {
+			bdev_nvme_qpair_submit_batch_end(nvme_qpair);
 			spdk_nvme_ctrlr_disconnect_io_qpair(nvme_qpair->qpair);
 		} else {
 			/* Skip current ctrlr_channel in a full reset sequence because
@@ -3483,6 +4104,7 @@ bdev_nvme_create_poll_group_cb(void *io_device, void *ctx_buf)
 	struct nvme_poll_group *group = ctx_buf;
 
 	TAILQ_INIT(&group->qpair_list);
+	TAILQ_INIT(&group->batch_qpair_list);
 
 	group->group = spdk_nvme_poll_group_create(group, &g_bdev_nvme_accel_fn_table);
 	if (group->group == NULL) {
@@ -3805,12 +4427,35 @@ nvme_bdev_get_mp_selector_str(struct nvme_bdev *nbdev)
 		return "round_robin";
 	case BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH:
 		return "queue_depth";
+	case BDEV_NVME_MP_SELECTOR_MIN_LATENCY:
+		return "min_latency";
 	default:
 		assert(false);
 		return "invalid";
 	}
 }
 
+static void
+bdev_nvme_ra_info_json(struct spdk_json_write_ctx *w, struct nvme_bdev *nbdev)
+{
+	uint64_t hits, misses;
+
+	hits = __atomic_load_n(&nbdev->ra_stat.hits, __ATOMIC_RELAXED);
+	misses = __atomic_load_n(&nbdev->ra_stat.misses, __ATOMIC_RELAXED);
+
+	spdk_json_write_named_object_begin(w, "read_ahead");
+	spdk_json_write_named_uint32(w, "window_kb", g_opts.read_ahead_kb);
+	spdk_json_write_named_uint64(w, "hits", hits);
+	spdk_json_write_named_uint64(w, "misses", misses);
+	spdk_json_write_named_uint64(w, "prefetches",
+				     __atomic_load_n(&nbdev->ra_stat.prefetches, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "invalidations",
+				     __atomic_load_n(&nbdev->ra_stat.invalidations, __ATOMIC_RELAXED));
+	spdk_json_write_named_double(w, "hit_ratio",
+				     hits + misses != 0 ? (double)hits / (hits + misses) : 0.0);
+	spdk_json_write_object_end(w);
+}
+
 static int
 bdev_nvme_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 {
@@ -3830,6 +4475,9 @@ bdev_nvme_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 			spdk_json_write_named_uint32(w, "rr_min_io", nvme_bdev->rr_min_io);
 		}
 	}
+	if (g_opts.read_ahead_kb != 0) {
+		bdev_nvme_ra_info_json(w, nvme_bdev);
+	}
 	pthread_mutex_unlock(&nvme_bdev->mutex);
 
 	return 0;
@@ -5180,6 +5828,7 @@ bdev_nvme_set_multipath_policy(const char *name, enum bdev_nvme_multipath_policy
 			}
 			break;
 		case BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH:
+		case BDEV_NVME_MP_SELECTOR_MIN_LATENCY:
 			break;
 		default:
 			rc = -EINVAL;
@@ -5739,6 +6388,12 @@ bdev_nvme_validate_opts(const struct spdk_bdev_nvme_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->read_ahead_kb > BDEV_NVME_RA_MAX_KB) {
+		SPDK_WARNLOG("Invalid option: read_ahead_kb can't be more than %u.\n",
+			     BDEV_NVME_RA_MAX_KB);
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -5761,7 +6416,8 @@ bdev_nvme_set_opts(const struct spdk_bdev_nvme_opts *opts)
 
 	if (opts->rdma_srq_size != 0 ||
 	    opts->rdma_max_cq_size != 0 ||
-	    opts->rdma_cm_event_timeout_ms != 0) {
+	    opts->rdma_cm_event_timeout_ms != 0 ||
+	    opts->tcp_cycle_stats != g_opts.tcp_cycle_stats) {
 		struct spdk_nvme_transport_opts drv_opts;
 
 		spdk_nvme_transport_get_opts(&drv_opts, sizeof(drv_opts));
@@ -5774,6 +6430,7 @@ bdev_nvme_set_opts(const struct spdk_bdev_nvme_opts *opts)
 		if (opts->rdma_cm_event_timeout_ms != 0) {
 			drv_opts.rdma_cm_event_timeout_ms = opts->rdma_cm_event_timeout_ms;
 		}
+		drv_opts.tcp_cycle_stats = opts->tcp_cycle_stats;
 
 		ret = spdk_nvme_transport_set_opts(&drv_opts, sizeof(drv_opts));
 		if (ret) {
@@ -6241,6 +6898,7 @@ bdev_nvme_create(struct spdk_nvme_transport_id *trid,
 	ctx->drv_opts.keep_alive_timeout_ms = g_opts.keep_alive_timeout_ms;
 	ctx->drv_opts.disable_read_ana_log_page = true;
 	ctx->drv_opts.transport_tos = g_opts.transport_tos;
+	ctx->drv_opts.fast_reconnect = g_opts.fast_reconnect;
 
 	if (ctx->bdev_opts.psk[0] != '\0') {
 		/* Try to use the keyring first */
@@ -8362,6 +9020,10 @@ bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_bool(w, "allow_accel_sequence", g_opts.allow_accel_sequence);
 	spdk_json_write_named_uint32(w, "rdma_max_cq_size", g_opts.rdma_max_cq_size);
 	spdk_json_write_named_uint16(w, "rdma_cm_event_timeout_ms", g_opts.rdma_cm_event_timeout_ms);
+	spdk_json_write_named_bool(w, "fast_reconnect", g_opts.fast_reconnect);
+	spdk_json_write_named_uint32(w, "read_ahead_kb", g_opts.read_ahead_kb);
+	spdk_json_write_named_bool(w, "tcp_cycle_stats", g_opts.tcp_cycle_stats);
+	spdk_json_write_named_bool(w, "submit_batching", g_opts.submit_batching);
 	spdk_json_write_named_array_begin(w, "dhchap_digests");
 	for (i = 0; i < 32; ++i) {
 		if (g_opts.dhchap_digests & SPDK_BIT(i)) {
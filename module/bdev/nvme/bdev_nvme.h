@@ -31,6 +31,7 @@ enum bdev_nvme_multipath_policy {
 enum bdev_nvme_multipath_selector {
 	BDEV_NVME_MP_SELECTOR_ROUND_ROBIN = 1,
 	BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH,
+	BDEV_NVME_MP_SELECTOR_MIN_LATENCY,
 };
 
 typedef void (*spdk_bdev_create_nvme_fn)(void *ctx, size_t bdev_count, int rc);
@@ -133,6 +134,9 @@ struct nvme_ctrlr {
 
 	struct spdk_poller			*adminq_timer_poller;
 	struct spdk_thread			*thread;
+	/* Wakes the thread up for I/O of CUSE devices in interrupt mode */
+	struct spdk_interrupt			*io_msg_intr;
+	int					io_msg_fd;
 
 	bdev_nvme_ctrlr_op_cb			ctrlr_op_cb_fn;
 	void					*ctrlr_op_cb_arg;
@@ -175,6 +179,14 @@ struct nvme_error_stat {
 	uint32_t status[4][256];
 };
 
+/* Read-ahead counters, kept per channel and summed into the nvme_bdev. */
+struct nvme_ra_stat {
+	uint64_t	hits;
+	uint64_t	misses;
+	uint64_t	prefetches;
+	uint64_t	invalidations;
+};
+
 struct nvme_bdev {
 	struct spdk_bdev		disk;
 	uint32_t			nsid;
@@ -188,6 +200,9 @@ struct nvme_bdev {
 	bool				opal;
 	TAILQ_ENTRY(nvme_bdev)		tailq;
 	struct nvme_error_stat		*err_stat;
+	/* Bumped on submission and completion of every I/O that modifies data. */
+	uint64_t			ra_write_gen;
+	struct nvme_ra_stat		ra_stat;
 };
 
 struct nvme_qpair {
@@ -200,6 +215,10 @@ struct nvme_qpair {
 	TAILQ_HEAD(, nvme_io_path)	io_path_list;
 
 	TAILQ_ENTRY(nvme_qpair)		tailq;
+
+	/* A submission batch is open until the poll group polls next. */
+	bool				in_submit_batch;
+	TAILQ_ENTRY(nvme_qpair)		batch_tailq;
 };
 
 struct nvme_ctrlr_channel {
@@ -208,6 +227,9 @@ struct nvme_ctrlr_channel {
 
 	struct spdk_io_channel_iter	*reset_iter;
 	struct spdk_poller		*connect_poller;
+
+	/* qpair connect was started in a reset and is not waited for yet. */
+	bool				connect_started;
 };
 
 struct nvme_io_path {
@@ -221,6 +243,29 @@ struct nvme_io_path {
 
 	/* allocation of stat is decided by option io_path_stat of RPC bdev_nvme_set_options */
 	struct spdk_bdev_io_stat	*stat;
+
+	/* EWMA of the completion latency, only updated by the min_latency selector */
+	uint64_t			lat_ewma_ticks;
+};
+
+#define BDEV_NVME_RA_SLOTS	4
+
+enum nvme_ra_slot_state {
+	NVME_RA_SLOT_EMPTY = 0,
+	NVME_RA_SLOT_FILLING,
+	NVME_RA_SLOT_VALID,
+};
+
+/* One read-ahead buffer of a bdev channel. */
+struct nvme_ra_slot {
+	/* NULL if the channel was destroyed while the slot was filling. */
+	struct nvme_bdev_channel	*nbdev_ch;
+	void				*buf;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	uint64_t			write_gen;
+	uint64_t			last_use;
+	enum nvme_ra_slot_state		state;
 };
 
 struct nvme_bdev_channel {
@@ -229,9 +274,23 @@ struct nvme_bdev_channel {
 	enum bdev_nvme_multipath_selector	mp_selector;
 	uint32_t				rr_min_io;
 	uint32_t				rr_counter;
+	/* I/O since the min_latency selector last probed another path */
+	uint32_t				lat_probe_counter;
+	/* Path probed last, the next probe starts after it */
+	struct nvme_io_path			*lat_probe_path;
 	STAILQ_HEAD(, nvme_io_path)		io_path_list;
 	TAILQ_HEAD(retry_io_head, spdk_bdev_io)	retry_io_list;
 	struct spdk_poller			*retry_io_poller;
+
+	/* Read-ahead of sequential streams, disabled if ra_blocks is 0. */
+	struct nvme_bdev			*nbdev;
+	uint32_t				ra_blocks;
+	uint32_t				ra_seq_count;
+	uint64_t				ra_last_end;
+	uint64_t				ra_next_lba;
+	uint64_t				ra_clock;
+	struct nvme_ra_slot			*ra_slots[BDEV_NVME_RA_SLOTS];
+	struct nvme_ra_stat			ra_stat;
 };
 
 struct nvme_poll_group {
@@ -242,7 +301,10 @@ struct nvme_poll_group {
 	uint64_t				spin_ticks;
 	uint64_t				start_ticks;
 	uint64_t				end_ticks;
+	/* Completions are being processed, see bdev_nvme_qpair_submit_batch_begin() */
+	bool					in_completions;
 	TAILQ_HEAD(, nvme_qpair)		qpair_list;
+	TAILQ_HEAD(, nvme_qpair)		batch_qpair_list;
 };
 
 void nvme_io_path_info_json(struct spdk_json_write_ctx *w, struct nvme_io_path *io_path);
@@ -306,6 +368,14 @@ struct spdk_bdev_nvme_opts {
 	uint16_t rdma_cm_event_timeout_ms;
 	uint32_t dhchap_digests;
 	uint32_t dhchap_dhgroups;
+	/* Skip namespace identify on reconnect if the target did not change. */
+	bool fast_reconnect;
+	/* Size of a read-ahead window of bdev channels in KiB, 0 disables read-ahead. */
+	uint32_t read_ahead_kb;
+	/* Account CPU cycles per stage of TCP qpairs, see spdk_nvme_tcp_cycles. */
+	bool tcp_cycle_stats;
+	/* Hold I/O submitted between two polls of a qpair in a submission batch. */
+	bool submit_batching;
 };
 
 struct spdk_nvme_qpair *bdev_nvme_get_io_qpair(struct spdk_io_channel *ctrlr_io_ch);
@@ -361,6 +431,24 @@ typedef void (*bdev_nvme_delete_done_fn)(void *ctx, int rc);
 int bdev_nvme_delete(const char *name, const struct nvme_path_id *path_id,
 		     bdev_nvme_delete_done_fn delete_done, void *delete_done_ctx);
 
+/**
+ * Start waking the thread of the NVMe controller up when its external I/O
+ * message producers (CUSE) submit I/O. No-op unless interrupt mode is enabled.
+ * Must be called on the thread of the NVMe controller.
+ *
+ * \param nvme_ctrlr NVMe controller
+ * \return zero on success or negative errno on failure.
+ */
+int bdev_nvme_ctrlr_enable_io_msg_intr(struct nvme_ctrlr *nvme_ctrlr);
+
+/**
+ * Stop waking the thread of the NVMe controller up for external I/O messages.
+ * Must be called on the thread of the NVMe controller.
+ *
+ * \param nvme_ctrlr NVMe controller
+ */
+void bdev_nvme_ctrlr_disable_io_msg_intr(struct nvme_ctrlr *nvme_ctrlr);
+
 enum nvme_ctrlr_op {
 	NVME_CTRLR_OP_RESET = 1,
 	NVME_CTRLR_OP_ENABLE,
@@ -417,7 +505,7 @@ typedef void (*bdev_nvme_set_multipath_policy_cb)(void *cb_arg, int rc);
  *
  * \param name NVMe bdev name
  * \param policy Multipath policy (active-passive or active-active)
- * \param selector Multipath selector (round_robin, queue_depth)
+ * \param selector Multipath selector (round_robin, queue_depth, min_latency)
  * \param rr_min_io Number of IO to route to a path before switching to another for round-robin
  * \param cb_fn Function to be called back after completion.
  */
@@ -28,13 +28,46 @@ static const struct spdk_json_object_decoder rpc_nvme_cuse_register_decoders[] =
 	{"name", offsetof(struct rpc_nvme_cuse_register, name), spdk_json_decode_string},
 };
 
+struct rpc_nvme_cuse_ctx {
+	struct spdk_jsonrpc_request	*request;
+	struct nvme_ctrlr		*nvme_ctrlr;
+};
+
+static void
+_rpc_nvme_cuse_register(void *_ctx)
+{
+	struct rpc_nvme_cuse_ctx *ctx = _ctx;
+	struct nvme_ctrlr *bdev_ctrlr = ctx->nvme_ctrlr;
+	int rc;
+
+	rc = spdk_nvme_cuse_register(bdev_ctrlr->ctrlr);
+	if (rc) {
+		SPDK_ERRLOG("Failed to register CUSE devices: %s\n", spdk_strerror(-rc));
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	rc = bdev_nvme_ctrlr_enable_io_msg_intr(bdev_ctrlr);
+	if (rc) {
+		SPDK_ERRLOG("Failed to enable CUSE interrupt: %s\n", spdk_strerror(-rc));
+		spdk_nvme_cuse_unregister(bdev_ctrlr->ctrlr);
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(ctx->request, true);
+
+cleanup:
+	free(ctx);
+}
+
 static void
 rpc_nvme_cuse_register(struct spdk_jsonrpc_request *request,
 		       const struct spdk_json_val *params)
 {
 	struct rpc_nvme_cuse_register req = {};
 	struct nvme_ctrlr *bdev_ctrlr = NULL;
-	int rc;
+	struct rpc_nvme_cuse_ctx *ctx;
 
 	if (spdk_json_decode_object(params, rpc_nvme_cuse_register_decoders,
 				    SPDK_COUNTOF(rpc_nvme_cuse_register_decoders),
@@ -52,14 +85,16 @@ rpc_nvme_cuse_register(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
-	rc = spdk_nvme_cuse_register(bdev_ctrlr->ctrlr);
-	if (rc) {
-		SPDK_ERRLOG("Failed to register CUSE devices: %s\n", spdk_strerror(-rc));
-		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
 		goto cleanup;
 	}
+	ctx->request = request;
+	ctx->nvme_ctrlr = bdev_ctrlr;
 
-	spdk_jsonrpc_send_bool_response(request, true);
+	/* The I/O message interrupt belongs to the thread of the controller. */
+	spdk_thread_send_msg(bdev_ctrlr->thread, _rpc_nvme_cuse_register, ctx);
 
 cleanup:
 	free_rpc_nvme_cuse_register(&req);
@@ -80,13 +115,35 @@ static const struct spdk_json_object_decoder rpc_nvme_cuse_unregister_decoders[]
 	{"name", offsetof(struct rpc_nvme_cuse_unregister, name), spdk_json_decode_string, true},
 };
 
+static void
+_rpc_nvme_cuse_unregister(void *_ctx)
+{
+	struct rpc_nvme_cuse_ctx *ctx = _ctx;
+	struct nvme_ctrlr *bdev_ctrlr = ctx->nvme_ctrlr;
+	int rc;
+
+	/* Unregistering the last CUSE device closes the eventfd. */
+	bdev_nvme_ctrlr_disable_io_msg_intr(bdev_ctrlr);
+
+	rc = spdk_nvme_cuse_unregister(bdev_ctrlr->ctrlr);
+	if (rc) {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(ctx->request, true);
+
+cleanup:
+	free(ctx);
+}
+
 static void
 rpc_nvme_cuse_unregister(struct spdk_jsonrpc_request *request,
 			 const struct spdk_json_val *params)
 {
 	struct rpc_nvme_cuse_unregister req = {};
 	struct nvme_ctrlr *bdev_ctrlr = NULL;
-	int rc;
+	struct rpc_nvme_cuse_ctx *ctx;
 
 	if (spdk_json_decode_object(params, rpc_nvme_cuse_unregister_decoders,
 				    SPDK_COUNTOF(rpc_nvme_cuse_unregister_decoders),
@@ -104,13 +161,15 @@ rpc_nvme_cuse_unregister(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
-	rc = spdk_nvme_cuse_unregister(bdev_ctrlr->ctrlr);
-	if (rc) {
-		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
 		goto cleanup;
 	}
+	ctx->request = request;
+	ctx->nvme_ctrlr = bdev_ctrlr;
 
-	spdk_jsonrpc_send_bool_response(request, true);
+	spdk_thread_send_msg(bdev_ctrlr->thread, _rpc_nvme_cuse_unregister, ctx);
 
 cleanup:
 	free_rpc_nvme_cuse_unregister(&req);
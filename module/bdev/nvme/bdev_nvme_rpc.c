@@ -139,6 +139,10 @@ static const struct spdk_json_object_decoder rpc_bdev_nvme_options_decoders[] =
 	{"rdma_cm_event_timeout_ms", offsetof(struct spdk_bdev_nvme_opts, rdma_cm_event_timeout_ms), spdk_json_decode_uint16, true},
 	{"dhchap_digests", offsetof(struct spdk_bdev_nvme_opts, dhchap_digests), rpc_decode_digest_array, true},
 	{"dhchap_dhgroups", offsetof(struct spdk_bdev_nvme_opts, dhchap_dhgroups), rpc_decode_dhgroup_array, true},
+	{"fast_reconnect", offsetof(struct spdk_bdev_nvme_opts, fast_reconnect), spdk_json_decode_bool, true},
+	{"read_ahead_kb", offsetof(struct spdk_bdev_nvme_opts, read_ahead_kb), spdk_json_decode_uint32, true},
+	{"tcp_cycle_stats", offsetof(struct spdk_bdev_nvme_opts, tcp_cycle_stats), spdk_json_decode_bool, true},
+	{"submit_batching", offsetof(struct spdk_bdev_nvme_opts, submit_batching), spdk_json_decode_bool, true},
 };
 
 static void
@@ -1211,16 +1215,50 @@ rpc_bdev_nvme_pcie_stats(struct spdk_json_write_ctx *w,
 				     stat->pcie.sq_shadow_doorbell_updates);
 }
 
+static void
+rpc_bdev_nvme_tcp_cycles(struct spdk_json_write_ctx *w, const struct spdk_nvme_tcp_cycles *cycles)
+{
+	spdk_json_write_named_object_begin(w, "cycles");
+	spdk_json_write_named_uint64(w, "pdu_build", cycles->pdu_build);
+	spdk_json_write_named_uint64(w, "digest", cycles->digest);
+	spdk_json_write_named_uint64(w, "sock_write", cycles->sock_write);
+	spdk_json_write_named_uint64(w, "sock_read", cycles->sock_read);
+	spdk_json_write_named_uint64(w, "pdu_parse", cycles->pdu_parse);
+	spdk_json_write_named_uint64(w, "completion", cycles->completion);
+	spdk_json_write_object_end(w);
+}
+
 static void
 rpc_bdev_nvme_tcp_stats(struct spdk_json_write_ctx *w,
 			struct spdk_nvme_transport_poll_group_stat *stat)
 {
+	struct spdk_nvme_tcp_qpair_stat *qpair_stat;
+	uint32_t i;
+
 	spdk_json_write_named_uint64(w, "polls", stat->tcp.polls);
 	spdk_json_write_named_uint64(w, "idle_polls", stat->tcp.idle_polls);
 	spdk_json_write_named_uint64(w, "socket_completions", stat->tcp.socket_completions);
 	spdk_json_write_named_uint64(w, "nvme_completions", stat->tcp.nvme_completions);
 	spdk_json_write_named_uint64(w, "queued_requests", stat->tcp.queued_requests);
 	spdk_json_write_named_uint64(w, "submitted_requests", stat->tcp.submitted_requests);
+	spdk_json_write_named_uint64(w, "submitted_ios", stat->tcp.submitted_ios);
+	spdk_json_write_named_uint64(w, "submit_batches", stat->tcp.submit_batches);
+	spdk_json_write_named_uint64(w, "sock_flushes", stat->tcp.sock_flushes);
+	spdk_json_write_named_uint64(w, "in_capsule_writes", stat->tcp.in_capsule_writes);
+	spdk_json_write_named_uint64(w, "r2t_writes", stat->tcp.r2t_writes);
+	rpc_bdev_nvme_tcp_cycles(w, &stat->tcp.cycles);
+
+	spdk_json_write_named_array_begin(w, "qpairs");
+	for (i = 0; i < stat->tcp.num_qpairs; i++) {
+		qpair_stat = &stat->tcp.qpair_stats[i];
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint32(w, "qid", qpair_stat->qid);
+		spdk_json_write_named_uint64(w, "submitted_ios", qpair_stat->submitted_ios);
+		spdk_json_write_named_uint64(w, "completed_ios", qpair_stat->completed_ios);
+		rpc_bdev_nvme_tcp_cycles(w, &qpair_stat->cycles);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
 }
 
 static void
@@ -2329,6 +2367,8 @@ rpc_decode_mp_selector(const struct spdk_json_val *val, void *out)
 		*selector = BDEV_NVME_MP_SELECTOR_ROUND_ROBIN;
 	} else if (spdk_json_strequal(val, "queue_depth") == true) {
 		*selector = BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH;
+	} else if (spdk_json_strequal(val, "min_latency") == true) {
+		*selector = BDEV_NVME_MP_SELECTOR_MIN_LATENCY;
 	} else {
 		SPDK_NOTICELOG("Invalid parameter value: selector\n");
 		return -EINVAL;
@@ -0,0 +1,944 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Target-side replicated namespace. A replica bdev sits on top of one local
+ * bdev and N replica bdevs (normally NVMe-oF bdevs from bdev_nvme). Reads go
+ * to the local bdev only, writes fan out to every leg in parallel and
+ * succeed on a configurable quorum, so the replication fan-out happens on the
+ * target instead of the host NIC. Since reads never leave the local bdev, a
+ * write only succeeds if the local leg succeeded.
+ *
+ * All legs of a write share one payload. A write is forwarded straight from the
+ * caller's iovecs, which have to stay valid until the last leg is done, so it is
+ * completed only then, with the quorum deciding its status. A zero-copy write is
+ * received into a forwarding buffer owned by the replica and completes as soon
+ * as the quorum is reached.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_replica.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* This namespace UUID was generated using uuid_generate() method. */
+#define BDEV_REPLICA_NAMESPACE_UUID "5d3c3a1e-58a4-4b0e-9f3b-7d0c2f6a8e41"
+
+#define REPLICA_IOBUF_SMALL_CACHE_SIZE	32
+#define REPLICA_IOBUF_LARGE_CACHE_SIZE	16
+
+static int vbdev_replica_init(void);
+static int vbdev_replica_get_ctx_size(void);
+static void vbdev_replica_finish(void);
+static int vbdev_replica_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module replica_if = {
+	.name = "replica",
+	.module_init = vbdev_replica_init,
+	.get_ctx_size = vbdev_replica_get_ctx_size,
+	.module_fini = vbdev_replica_finish,
+	.config_json = vbdev_replica_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(replica, &replica_if)
+
+struct replica_leg {
+	struct spdk_bdev		*bdev;
+	struct spdk_bdev_desc		*desc;
+};
+
+struct vbdev_replica {
+	struct spdk_bdev		bdev;
+	/* legs[0] is the local bdev, the rest are replicas */
+	struct replica_leg		legs[REPLICA_MAX_LEGS];
+	uint32_t			num_legs;
+	uint32_t			write_quorum;
+	struct spdk_thread		*thread;    /* thread where the legs are opened */
+	TAILQ_ENTRY(vbdev_replica)	link;
+};
+static TAILQ_HEAD(, vbdev_replica) g_replica_nodes = TAILQ_HEAD_INITIALIZER(g_replica_nodes);
+
+/* Tracks the legs of one fanned-out IO. Lives outside of the bdev_io because it
+ * may outlive it when the IO is completed on quorum.
+ */
+struct replica_write {
+	struct spdk_bdev_io		*orig_io;
+	struct spdk_io_channel		*ch;
+	struct replica_io_channel	*rch;
+
+	/* Legs not resolved yet, plus one reference held while submitting */
+	uint32_t			outstanding;
+	uint32_t			succeeded;
+	uint32_t			failed;
+	uint32_t			quorum;
+	uint32_t			next_leg;
+	/* The quorum is only evaluated once all legs have been submitted */
+	bool				submitting;
+	bool				orig_completed;
+	/* Holds an extra reference on ch while legs outlive orig_io */
+	bool				ch_ref;
+	/* The legs write from orig_io's iovecs, so it can't complete before them */
+	bool				caller_payload;
+	/* Status of legs[0], the leg reads are served from */
+	bool				local_succeeded;
+	bool				local_failed;
+
+	/* Staged payload shared by all legs, NULL when the caller's iovecs are used */
+	void				*buf;
+	uint64_t			buf_len;
+	struct iovec			iov;
+
+	struct spdk_iobuf_entry		iobuf_entry;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+	STAILQ_ENTRY(replica_write)	link;
+};
+
+struct replica_io_channel {
+	struct spdk_io_channel		*leg_ch[REPLICA_MAX_LEGS];
+	struct spdk_iobuf_channel	iobuf;
+	STAILQ_HEAD(, replica_write)	free_writes;
+};
+
+struct replica_bdev_io {
+	struct spdk_io_channel		*ch;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+	/* Forwarding buffer handed out by a zero-copy write start, NULL when the
+	 * buffer came from the bdev layer */
+	struct replica_write		*zcopy_write;
+};
+
+static void vbdev_replica_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+static void replica_write_submit_legs(struct replica_write *w);
+
+/* Leg index used to drop the submission reference */
+#define REPLICA_SUBMIT_REF	UINT32_MAX
+
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_replica *node = io_device;
+
+	free(node->bdev.name);
+	free(node);
+}
+
+static void
+_vbdev_replica_close_legs(void *ctx)
+{
+	struct vbdev_replica *node = ctx;
+	uint32_t i;
+
+	for (i = 0; i < node->num_legs; i++) {
+		spdk_bdev_close(node->legs[i].desc);
+	}
+
+	spdk_io_device_unregister(node, _device_unregister_cb);
+}
+
+static int
+vbdev_replica_destruct(void *ctx)
+{
+	struct vbdev_replica *node = ctx;
+	uint32_t i;
+
+	TAILQ_REMOVE(&g_replica_nodes, node, link);
+
+	for (i = 0; i < node->num_legs; i++) {
+		spdk_bdev_module_release_bdev(node->legs[i].bdev);
+	}
+
+	/* Close the legs on the thread they were opened on. */
+	if (node->thread && node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(node->thread, _vbdev_replica_close_legs, node);
+	} else {
+		_vbdev_replica_close_legs(node);
+	}
+
+	return 0;
+}
+
+static struct replica_write *
+replica_write_get(struct replica_io_channel *rch)
+{
+	struct replica_write *w;
+
+	w = STAILQ_FIRST(&rch->free_writes);
+	if (spdk_likely(w != NULL)) {
+		STAILQ_REMOVE_HEAD(&rch->free_writes, link);
+	} else {
+		/* The free list grows to the channel's peak queue depth and stays there. */
+		w = calloc(1, sizeof(*w));
+		if (w == NULL) {
+			return NULL;
+		}
+	}
+
+	return w;
+}
+
+static void
+replica_write_put(struct replica_write *w)
+{
+	struct replica_io_channel *rch = w->rch;
+	struct spdk_io_channel *ch = w->ch;
+	bool ch_ref = w->ch_ref;
+
+	if (w->buf != NULL) {
+		spdk_iobuf_put(&rch->iobuf, w->buf, w->buf_len);
+		w->buf = NULL;
+	}
+
+	STAILQ_INSERT_HEAD(&rch->free_writes, w, link);
+
+	if (ch_ref) {
+		spdk_put_io_channel(ch);
+	}
+}
+
+static void
+replica_write_complete_orig(struct replica_write *w, enum spdk_bdev_io_status status)
+{
+	w->orig_completed = true;
+
+	if (w->outstanding > 0) {
+		/* Some legs are still running on the staged payload; keep the
+		 * channel (and thus the leg channels) alive until they finish.
+		 */
+		w->ch = spdk_get_io_channel(spdk_io_channel_get_io_device(w->ch));
+		w->ch_ref = true;
+	}
+
+	spdk_bdev_io_complete(w->orig_io, status);
+	w->orig_io = NULL;
+}
+
+/* One leg is done (or could not be submitted). Complete the original IO once
+ * the quorum is reached or can no longer be reached, or, if the legs use the
+ * caller's payload, once all legs are resolved. Release the tracker when all legs
+ * are resolved.
+ */
+static void
+replica_write_leg_resolved(struct replica_write *w, uint32_t leg, bool success)
+{
+	struct vbdev_replica *node;
+
+	assert(w->outstanding > 0);
+	w->outstanding--;
+
+	if (leg != REPLICA_SUBMIT_REF) {
+		if (success) {
+			w->succeeded++;
+		} else {
+			w->failed++;
+		}
+		if (leg == 0) {
+			w->local_succeeded = success;
+			w->local_failed = !success;
+		}
+	}
+
+	if (!w->orig_completed && !w->submitting &&
+	    (w->outstanding == 0 || !w->caller_payload)) {
+		node = SPDK_CONTAINEROF(w->orig_io->bdev, struct vbdev_replica, bdev);
+		if (w->local_failed || w->failed > node->num_legs - w->quorum) {
+			replica_write_complete_orig(w, SPDK_BDEV_IO_STATUS_FAILED);
+		} else if (w->local_succeeded && w->succeeded >= w->quorum) {
+			replica_write_complete_orig(w, SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+	}
+
+	if (w->outstanding == 0) {
+		assert(w->orig_completed);
+		replica_write_put(w);
+	}
+}
+
+#define REPLICA_LEG_CB(n)								\
+static void										\
+_replica_leg##n##_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)	\
+{											\
+	spdk_bdev_free_io(bdev_io);							\
+	replica_write_leg_resolved(cb_arg, n, success);					\
+}
+
+REPLICA_LEG_CB(0)
+REPLICA_LEG_CB(1)
+REPLICA_LEG_CB(2)
+REPLICA_LEG_CB(3)
+REPLICA_LEG_CB(4)
+REPLICA_LEG_CB(5)
+REPLICA_LEG_CB(6)
+REPLICA_LEG_CB(7)
+
+static const spdk_bdev_io_completion_cb g_replica_leg_cb[REPLICA_MAX_LEGS] = {
+	_replica_leg0_complete, _replica_leg1_complete, _replica_leg2_complete, _replica_leg3_complete,
+	_replica_leg4_complete, _replica_leg5_complete, _replica_leg6_complete, _replica_leg7_complete,
+};
+
+static int
+replica_submit_leg(struct replica_write *w, uint32_t leg)
+{
+	struct spdk_bdev_io *orig_io = w->orig_io;
+	struct vbdev_replica *node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_replica, bdev);
+	struct spdk_bdev_desc *desc = node->legs[leg].desc;
+	struct spdk_io_channel *leg_ch = w->rch->leg_ch[leg];
+	spdk_bdev_io_completion_cb cb = g_replica_leg_cb[leg];
+
+	switch (orig_io->type) {
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		if (w->buf != NULL) {
+			return spdk_bdev_writev_blocks(desc, leg_ch, &w->iov, 1,
+						       orig_io->u.bdev.offset_blocks,
+						       orig_io->u.bdev.num_blocks, cb, w);
+		}
+		return spdk_bdev_writev_blocks_with_md(desc, leg_ch, orig_io->u.bdev.iovs,
+						       orig_io->u.bdev.iovcnt, orig_io->u.bdev.md_buf,
+						       orig_io->u.bdev.offset_blocks,
+						       orig_io->u.bdev.num_blocks, cb, w);
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return spdk_bdev_write_zeroes_blocks(desc, leg_ch, orig_io->u.bdev.offset_blocks,
+						     orig_io->u.bdev.num_blocks, cb, w);
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		return spdk_bdev_unmap_blocks(desc, leg_ch, orig_io->u.bdev.offset_blocks,
+					      orig_io->u.bdev.num_blocks, cb, w);
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return spdk_bdev_flush_blocks(desc, leg_ch, orig_io->u.bdev.offset_blocks,
+					      orig_io->u.bdev.num_blocks, cb, w);
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_reset(desc, leg_ch, cb, w);
+	default:
+		assert(false);
+		return -EINVAL;
+	}
+}
+
+static void
+replica_write_resubmit_legs(void *arg)
+{
+	replica_write_submit_legs(arg);
+}
+
+static void
+replica_write_submit_legs(struct replica_write *w)
+{
+	struct vbdev_replica *node;
+	uint32_t leg, num_legs;
+	int rc;
+
+	/* orig_io can't be completed while the legs are being submitted. */
+	node = SPDK_CONTAINEROF(w->orig_io->bdev, struct vbdev_replica, bdev);
+	num_legs = node->num_legs;
+
+	while (w->next_leg < num_legs) {
+		leg = w->next_leg;
+		rc = replica_submit_leg(w, leg);
+		if (spdk_unlikely(rc == -ENOMEM)) {
+			w->bdev_io_wait.bdev = node->legs[leg].bdev;
+			w->bdev_io_wait.cb_fn = replica_write_resubmit_legs;
+			w->bdev_io_wait.cb_arg = w;
+			rc = spdk_bdev_queue_io_wait(node->legs[leg].bdev, w->rch->leg_ch[leg],
+						     &w->bdev_io_wait);
+			if (rc == 0) {
+				return;
+			}
+		}
+
+		w->next_leg++;
+		if (spdk_unlikely(rc != 0)) {
+			SPDK_ERRLOG("replica: failed to submit to leg %s, rc=%d\n",
+				    spdk_bdev_get_name(node->legs[leg].bdev), rc);
+			replica_write_leg_resolved(w, leg, false);
+		}
+	}
+
+	/* Drop the submission reference; this may complete and release everything. */
+	w->submitting = false;
+	replica_write_leg_resolved(w, REPLICA_SUBMIT_REF, true);
+}
+
+static void
+replica_write_start(struct replica_write *w)
+{
+	w->submitting = true;
+	replica_write_submit_legs(w);
+}
+
+static void
+replica_write_init(struct replica_write *w, struct spdk_io_channel *ch,
+		   struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_replica *node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_replica, bdev);
+
+	w->orig_io = bdev_io;
+	w->ch = ch;
+	w->rch = spdk_io_channel_get_ctx(ch);
+	w->outstanding = node->num_legs + 1;
+	w->succeeded = 0;
+	w->failed = 0;
+	w->quorum = node->write_quorum;
+	w->next_leg = 0;
+	w->orig_completed = false;
+	w->ch_ref = false;
+	w->caller_payload = false;
+	w->local_succeeded = false;
+	w->local_failed = false;
+}
+
+static void
+vbdev_replica_fan_out(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_replica *node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_replica, bdev);
+	struct replica_io_channel *rch = spdk_io_channel_get_ctx(ch);
+	struct replica_write *w;
+
+	w = replica_write_get(rch);
+	if (spdk_unlikely(w == NULL)) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		return;
+	}
+
+	replica_write_init(w, ch, bdev_io);
+	w->buf = NULL;
+
+	/* Resets and flushes always wait for every leg. */
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_RESET || bdev_io->type == SPDK_BDEV_IO_TYPE_FLUSH) {
+		w->quorum = node->num_legs;
+	}
+
+	w->caller_payload = bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE;
+
+	replica_write_start(w);
+}
+
+static void
+_replica_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+vbdev_replica_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct replica_bdev_io *io_ctx = (struct replica_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_replica_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_replica_queue_io(struct spdk_bdev_io *bdev_io, struct spdk_io_channel *ch)
+{
+	struct replica_bdev_io *io_ctx = (struct replica_bdev_io *)bdev_io->driver_ctx;
+	struct replica_io_channel *rch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_replica *node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_replica, bdev);
+	int rc;
+
+	io_ctx->ch = ch;
+	io_ctx->bdev_io_wait.bdev = node->legs[0].bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_replica_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	rc = spdk_bdev_queue_io_wait(node->legs[0].bdev, rch->leg_ch[0], &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_replica_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+replica_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_replica *node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_replica, bdev);
+	struct replica_io_channel *rch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Reads are served locally. */
+	rc = spdk_bdev_readv_blocks_with_md(node->legs[0].desc, rch->leg_ch[0], bdev_io->u.bdev.iovs,
+					    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.md_buf,
+					    bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
+					    _replica_complete_io, bdev_io);
+	if (rc == -ENOMEM) {
+		vbdev_replica_queue_io(bdev_io, ch);
+	} else if (rc != 0) {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+replica_zcopy_get_fwd_buf_cb(struct spdk_iobuf_entry *entry, void *buf)
+{
+	struct replica_write *w = SPDK_CONTAINEROF(entry, struct replica_write, iobuf_entry);
+
+	w->buf = buf;
+	w->iov.iov_base = buf;
+	w->iov.iov_len = w->buf_len;
+	spdk_bdev_io_set_buf(w->orig_io, buf, w->buf_len);
+	spdk_bdev_io_complete(w->orig_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+replica_zcopy_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	spdk_bdev_io_complete(bdev_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+/* Hand out the buffer a zero-copy write is received into. Whenever possible it's a
+ * forwarding buffer owned by the replica, so the legs can keep writing from it
+ * after the write was completed on quorum and the caller released the bdev_io.
+ */
+static void
+vbdev_replica_zcopy_start_write(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct replica_bdev_io *io_ctx = (struct replica_bdev_io *)bdev_io->driver_ctx;
+	struct replica_io_channel *rch = spdk_io_channel_get_ctx(ch);
+	struct replica_write *w;
+	uint64_t len;
+	void *buf;
+
+	io_ctx->zcopy_write = NULL;
+	len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+	if (len > rch->iobuf.large.bufsize) {
+		spdk_bdev_io_get_buf(bdev_io, replica_zcopy_get_buf_cb, len);
+		return;
+	}
+
+	w = replica_write_get(rch);
+	if (spdk_unlikely(w == NULL)) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		return;
+	}
+
+	replica_write_init(w, ch, bdev_io);
+	w->buf = NULL;
+	w->buf_len = len;
+	io_ctx->zcopy_write = w;
+
+	buf = spdk_iobuf_get(&rch->iobuf, len, &w->iobuf_entry, replica_zcopy_get_fwd_buf_cb);
+	if (buf != NULL) {
+		replica_zcopy_get_fwd_buf_cb(&w->iobuf_entry, buf);
+	}
+}
+
+static void
+vbdev_replica_zcopy_end(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct replica_bdev_io *io_ctx = (struct replica_bdev_io *)bdev_io->driver_ctx;
+	struct replica_write *w = io_ctx->zcopy_write;
+
+	if (bdev_io->u.bdev.zcopy.populate) {
+		/* Zero-copy read, the buffer is released with the bdev_io */
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	io_ctx->zcopy_write = NULL;
+	if (!bdev_io->u.bdev.zcopy.commit) {
+		if (w != NULL) {
+			replica_write_put(w);
+		}
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	if (w == NULL) {
+		/* The buffer belongs to the bdev_io, every leg has to finish with it
+		 * before the caller may release it. */
+		w = replica_write_get(spdk_io_channel_get_ctx(ch));
+		if (spdk_unlikely(w == NULL)) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+			return;
+		}
+		replica_write_init(w, ch, bdev_io);
+		w->buf = NULL;
+		w->caller_payload = true;
+	} else {
+		replica_write_init(w, ch, bdev_io);
+	}
+
+	replica_write_start(w);
+}
+
+static void
+vbdev_replica_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, replica_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		break;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		if (!bdev_io->u.bdev.zcopy.start) {
+			vbdev_replica_zcopy_end(ch, bdev_io);
+		} else if (bdev_io->u.bdev.zcopy.populate) {
+			/* Served locally, just like reads */
+			spdk_bdev_io_get_buf(bdev_io, replica_read_get_buf_cb,
+					     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		} else {
+			vbdev_replica_zcopy_start_write(ch, bdev_io);
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		vbdev_replica_fan_out(ch, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("replica: unsupported I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static bool
+vbdev_replica_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_replica *node = ctx;
+	uint32_t i;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		return spdk_bdev_io_type_supported(node->legs[0].bdev, io_type);
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		/* Every leg has to support it, otherwise the replicas diverge. */
+		for (i = 0; i < node->num_legs; i++) {
+			if (!spdk_bdev_io_type_supported(node->legs[i].bdev, io_type)) {
+				return false;
+			}
+		}
+		return true;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		/* Zero-copy buffers don't carry separate metadata */
+		if (node->bdev.md_len != 0 && !node->bdev.md_interleave) {
+			return false;
+		}
+		if (!spdk_bdev_io_type_supported(node->legs[0].bdev, SPDK_BDEV_IO_TYPE_READ)) {
+			return false;
+		}
+		for (i = 0; i < node->num_legs; i++) {
+			if (!spdk_bdev_io_type_supported(node->legs[i].bdev, SPDK_BDEV_IO_TYPE_WRITE)) {
+				return false;
+			}
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_replica_get_io_channel(void *ctx)
+{
+	return spdk_get_io_channel(ctx);
+}
+
+static void
+vbdev_replica_dump_legs_json(struct vbdev_replica *node, struct spdk_json_write_ctx *w)
+{
+	uint32_t i;
+
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(node->legs[0].bdev));
+	spdk_json_write_named_array_begin(w, "replica_bdev_names");
+	for (i = 1; i < node->num_legs; i++) {
+		spdk_json_write_string(w, spdk_bdev_get_name(node->legs[i].bdev));
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_named_uint32(w, "write_quorum", node->write_quorum);
+}
+
+static int
+vbdev_replica_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_replica *node = ctx;
+
+	spdk_json_write_name(w, "replica");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&node->bdev));
+	vbdev_replica_dump_legs_json(node, w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_replica_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_replica *node;
+
+	TAILQ_FOREACH(node, &g_replica_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_replica_create");
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&node->bdev));
+		vbdev_replica_dump_legs_json(node, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static void
+vbdev_replica_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	/* No config per bdev needed */
+}
+
+static int
+replica_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct replica_io_channel *rch = ctx_buf;
+	struct vbdev_replica *node = io_device;
+	uint32_t i;
+	int rc;
+
+	STAILQ_INIT(&rch->free_writes);
+
+	rc = spdk_iobuf_channel_init(&rch->iobuf, "replica", REPLICA_IOBUF_SMALL_CACHE_SIZE,
+				     REPLICA_IOBUF_LARGE_CACHE_SIZE);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to create iobuf channel: %s\n", spdk_strerror(-rc));
+		return rc;
+	}
+
+	for (i = 0; i < node->num_legs; i++) {
+		rch->leg_ch[i] = spdk_bdev_get_io_channel(node->legs[i].desc);
+		if (rch->leg_ch[i] == NULL) {
+			SPDK_ERRLOG("Failed to get channel of %s\n", spdk_bdev_get_name(node->legs[i].bdev));
+			while (i-- > 0) {
+				spdk_put_io_channel(rch->leg_ch[i]);
+			}
+			spdk_iobuf_channel_fini(&rch->iobuf);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void
+replica_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct replica_io_channel *rch = ctx_buf;
+	struct vbdev_replica *node = io_device;
+	struct replica_write *w;
+	uint32_t i;
+
+	while ((w = STAILQ_FIRST(&rch->free_writes))) {
+		STAILQ_REMOVE_HEAD(&rch->free_writes, link);
+		free(w);
+	}
+
+	for (i = 0; i < node->num_legs; i++) {
+		spdk_put_io_channel(rch->leg_ch[i]);
+	}
+
+	spdk_iobuf_channel_fini(&rch->iobuf);
+}
+
+static int
+vbdev_replica_init(void)
+{
+	return spdk_iobuf_register_module("replica");
+}
+
+static void
+vbdev_replica_finish(void)
+{
+	spdk_iobuf_unregister_module("replica");
+}
+
+static int
+vbdev_replica_get_ctx_size(void)
+{
+	return sizeof(struct replica_bdev_io);
+}
+
+static const struct spdk_bdev_fn_table vbdev_replica_fn_table = {
+	.destruct		= vbdev_replica_destruct,
+	.submit_request		= vbdev_replica_submit_request,
+	.io_type_supported	= vbdev_replica_io_type_supported,
+	.get_io_channel		= vbdev_replica_get_io_channel,
+	.dump_info_json		= vbdev_replica_dump_info_json,
+	.write_config_json	= vbdev_replica_write_config_json,
+};
+
+static void
+vbdev_replica_leg_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			   void *event_ctx)
+{
+	struct vbdev_replica *node = event_ctx;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		/* Losing any leg makes the namespace unsafe to keep writing to. */
+		SPDK_NOTICELOG("Leg %s of replica bdev %s removed\n", spdk_bdev_get_name(bdev),
+			       spdk_bdev_get_name(&node->bdev));
+		spdk_bdev_unregister(&node->bdev, NULL, NULL);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+int
+bdev_replica_create(const char *name, const char *base_bdev_name,
+		    const char *const *replica_bdev_names, uint32_t num_replicas,
+		    uint32_t write_quorum)
+{
+	struct vbdev_replica *node;
+	struct spdk_bdev *base, *bdev;
+	struct spdk_uuid ns_uuid;
+	const char *leg_name;
+	uint32_t i, num_claimed = 0;
+	int rc;
+
+	if (num_replicas == 0 || num_replicas + 1 > REPLICA_MAX_LEGS) {
+		SPDK_ERRLOG("replica bdev needs 1 to %u replicas\n", REPLICA_MAX_LEGS - 1);
+		return -EINVAL;
+	}
+
+	if (write_quorum == 0) {
+		write_quorum = num_replicas + 1;
+	} else if (write_quorum > num_replicas + 1) {
+		SPDK_ERRLOG("write quorum %u exceeds number of legs %u\n", write_quorum, num_replicas + 1);
+		return -EINVAL;
+	}
+
+	node = calloc(1, sizeof(*node));
+	if (node == NULL) {
+		return -ENOMEM;
+	}
+
+	node->bdev.name = strdup(name);
+	if (node->bdev.name == NULL) {
+		free(node);
+		return -ENOMEM;
+	}
+	node->bdev.product_name = "replica";
+	node->write_quorum = write_quorum;
+
+	for (i = 0; i < num_replicas + 1; i++) {
+		leg_name = i == 0 ? base_bdev_name : replica_bdev_names[i - 1];
+		rc = spdk_bdev_open_ext(leg_name, true, vbdev_replica_leg_event_cb, node,
+					&node->legs[i].desc);
+		if (rc != 0) {
+			SPDK_ERRLOG("could not open bdev %s: %s\n", leg_name, spdk_strerror(-rc));
+			goto err_close;
+		}
+		node->legs[i].bdev = spdk_bdev_desc_get_bdev(node->legs[i].desc);
+		node->num_legs++;
+	}
+
+	base = node->legs[0].bdev;
+	for (i = 1; i < node->num_legs; i++) {
+		bdev = node->legs[i].bdev;
+		if (bdev->blocklen != base->blocklen || bdev->blockcnt < base->blockcnt ||
+		    bdev->md_len != base->md_len) {
+			SPDK_ERRLOG("replica %s does not match the geometry of %s\n",
+				    spdk_bdev_get_name(bdev), spdk_bdev_get_name(base));
+			rc = -EINVAL;
+			goto err_close;
+		}
+	}
+
+	for (i = 0; i < node->num_legs; i++) {
+		rc = spdk_bdev_module_claim_bdev(node->legs[i].bdev, node->legs[i].desc, &replica_if);
+		if (rc != 0) {
+			SPDK_ERRLOG("could not claim bdev %s\n", spdk_bdev_get_name(node->legs[i].bdev));
+			goto err_release;
+		}
+		num_claimed++;
+	}
+
+	/* Generate UUID based on namespace UUID + local bdev UUID. */
+	spdk_uuid_parse(&ns_uuid, BDEV_REPLICA_NAMESPACE_UUID);
+	rc = spdk_uuid_generate_sha1(&node->bdev.uuid, &ns_uuid, (const char *)&base->uuid,
+				     sizeof(struct spdk_uuid));
+	if (rc != 0) {
+		SPDK_ERRLOG("Unable to generate new UUID for replica bdev\n");
+		goto err_release;
+	}
+
+	node->bdev.write_cache = base->write_cache;
+	node->bdev.required_alignment = base->required_alignment;
+	node->bdev.optimal_io_boundary = base->optimal_io_boundary;
+	node->bdev.blocklen = base->blocklen;
+	node->bdev.blockcnt = base->blockcnt;
+	node->bdev.md_interleave = base->md_interleave;
+	node->bdev.md_len = base->md_len;
+	node->bdev.dif_type = base->dif_type;
+	node->bdev.dif_is_head_of_md = base->dif_is_head_of_md;
+	node->bdev.dif_check_flags = base->dif_check_flags;
+
+	node->bdev.ctxt = node;
+	node->bdev.fn_table = &vbdev_replica_fn_table;
+	node->bdev.module = &replica_if;
+	node->thread = spdk_get_thread();
+
+	spdk_io_device_register(node, replica_bdev_ch_create_cb, replica_bdev_ch_destroy_cb,
+				sizeof(struct replica_io_channel), name);
+	TAILQ_INSERT_TAIL(&g_replica_nodes, node, link);
+
+	rc = spdk_bdev_register(&node->bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not register replica bdev %s\n", name);
+		TAILQ_REMOVE(&g_replica_nodes, node, link);
+		spdk_io_device_unregister(node, NULL);
+		goto err_release;
+	}
+
+	SPDK_NOTICELOG("created replica bdev %s: %u legs, write quorum %u\n", name,
+		       node->num_legs, node->write_quorum);
+	return 0;
+
+err_release:
+	for (i = 0; i < num_claimed; i++) {
+		spdk_bdev_module_release_bdev(node->legs[i].bdev);
+	}
+err_close:
+	for (i = 0; i < node->num_legs; i++) {
+		spdk_bdev_close(node->legs[i].desc);
+	}
+	free(node->bdev.name);
+	free(node);
+	return rc;
+}
+
+void
+bdev_replica_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	int rc;
+
+	/* Legs are released and closed in the destruct callback. */
+	rc = spdk_bdev_unregister_by_name(name, &replica_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_replica)
@@ -0,0 +1,46 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SPDK_VBDEV_REPLICA_H
+#define SPDK_VBDEV_REPLICA_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+/* Local leg plus remote replicas. */
+#define REPLICA_MAX_LEGS	8
+
+/**
+ * Create a replicated bdev.
+ *
+ * Reads are served by the local base bdev. Writes, write zeroes, unmap and flush
+ * are sent in parallel to the base bdev and to every replica bdev (typically
+ * NVMe-oF bdevs attached with bdev_nvme_attach_controller). They succeed if
+ * write_quorum legs including the base bdev succeeded. Writes complete once
+ * every leg is done with the caller's buffer, zero-copy writes and the other
+ * operations complete as soon as the quorum is reached.
+ *
+ * \param name Name of the replicated bdev.
+ * \param base_bdev_name Local bdev that serves reads.
+ * \param replica_bdev_names Names of the replica bdevs.
+ * \param num_replicas Number of entries in replica_bdev_names.
+ * \param write_quorum Number of legs, including the base bdev, that have to
+ * complete a write successfully, 0 means all legs.
+ * \return 0 on success, negative errno on failure.
+ */
+int bdev_replica_create(const char *name, const char *base_bdev_name,
+			const char *const *replica_bdev_names, uint32_t num_replicas,
+			uint32_t write_quorum);
+
+/**
+ * Delete a replicated bdev.
+ *
+ * \param name Name of the replicated bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_replica_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_REPLICA_H */
@@ -0,0 +1,132 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "vbdev_replica.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_bdev_replica_names {
+	size_t	num_names;
+	char	*names[REPLICA_MAX_LEGS - 1];
+};
+
+/* Structure to hold the parameters for this RPC method. */
+struct rpc_bdev_replica_create {
+	char				*name;
+	char				*base_bdev_name;
+	struct rpc_bdev_replica_names	replica_bdev_names;
+	uint32_t			write_quorum;
+};
+
+static int
+decode_replica_bdev_names(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_bdev_replica_names *names = out;
+
+	return spdk_json_decode_array(val, spdk_json_decode_string, names->names,
+				      REPLICA_MAX_LEGS - 1, &names->num_names, sizeof(char *));
+}
+
+/* Free the allocated memory resource after the RPC handling. */
+static void
+free_rpc_bdev_replica_create(struct rpc_bdev_replica_create *r)
+{
+	size_t i;
+
+	free(r->name);
+	free(r->base_bdev_name);
+	for (i = 0; i < r->replica_bdev_names.num_names; i++) {
+		free(r->replica_bdev_names.names[i]);
+	}
+}
+
+/* Structure to decode the input parameters for this RPC method. */
+static const struct spdk_json_object_decoder rpc_bdev_replica_create_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_replica_create, name), spdk_json_decode_string},
+	{"base_bdev_name", offsetof(struct rpc_bdev_replica_create, base_bdev_name), spdk_json_decode_string},
+	{"replica_bdev_names", offsetof(struct rpc_bdev_replica_create, replica_bdev_names), decode_replica_bdev_names},
+	{"write_quorum", offsetof(struct rpc_bdev_replica_create, write_quorum), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_replica_create(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_replica_create req = {NULL};
+	struct spdk_json_write_ctx *w;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_replica_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_replica_create_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(vbdev_replica, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_replica_create(req.name, req.base_bdev_name,
+				 (const char *const *)req.replica_bdev_names.names,
+				 req.replica_bdev_names.num_names, req.write_quorum);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_string(w, req.name);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_replica_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_replica_create", rpc_bdev_replica_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_replica_delete {
+	char *name;
+};
+
+static void
+free_rpc_bdev_replica_delete(struct rpc_bdev_replica_delete *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_replica_delete_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_replica_delete, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_replica_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_replica_delete(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_replica_delete req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_bdev_replica_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_replica_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev_replica_delete(req.name, rpc_bdev_replica_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_replica_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_replica_delete", rpc_bdev_replica_delete, SPDK_RPC_RUNTIME)